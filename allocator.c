@@ -0,0 +1,253 @@
+/*
+ * File:   allocator.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "allocator.h"
+#include "stats.h"
+
+
+/*
+ * Private types
+ */
+
+
+/* Prepended to every block of the tracking allocator */
+typedef union {
+    struct {
+        size_t size;
+        int site;                /* index into tracker->sites, or -1 */
+    } info;
+    max_align_t align;
+} block_header_t;
+
+
+/*
+ * Default allocator
+ */
+
+
+static void*
+default_calloc(void* ctx, size_t count, size_t size, const char* file, int line)
+{
+    return calloc(count, size);
+}
+
+static void
+default_free(void* ctx, void* ptr, const char* file, int line)
+{
+    free(ptr);
+}
+
+static mpls_allocator_t current_allocator = { default_calloc, default_free, NULL };
+
+
+/*
+ * Tracking allocator
+ */
+
+
+static int
+find_site(alloc_tracker_t* tracker, const char* file, int line)
+{
+    int i;
+
+    // Sites are few (one per MPLS_CALLOC in the source) and file is a string
+    // literal, so a linear scan comparing pointers is enough
+    for (i = 0; i < tracker->site_count; i++)
+    {
+        if (tracker->sites[i].line == line && tracker->sites[i].file == file)
+            return i;
+    }
+
+    if (tracker->site_count == ALLOC_TRACKER_MAX_SITES)
+        return -1;
+
+    tracker->sites[i].file = file;
+    tracker->sites[i].line = line;
+    tracker->site_count++;
+    return i;
+}
+
+static void*
+tracking_calloc(void* ctx, size_t count, size_t size, const char* file, int line)
+{
+    alloc_tracker_t* tracker = (alloc_tracker_t*) ctx;
+    size_t bytes = count * size;
+    block_header_t* header = (block_header_t*) calloc(1, sizeof(block_header_t) + bytes);
+    long long live;
+    long long peak;
+
+    if (header == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&tracker->sites_lock);
+    header->info.size = bytes;
+    header->info.site = find_site(tracker, file, line);
+    if (header->info.site >= 0)
+    {
+        alloc_site_t* site = &tracker->sites[header->info.site];
+        site->allocs++;
+        site->live_allocs++;
+        site->total_bytes += bytes;
+        site->live_bytes += bytes;
+    }
+    pthread_mutex_unlock(&tracker->sites_lock);
+
+    atomic_fetch_add(&tracker->allocs, 1);
+    live = atomic_fetch_add(&tracker->live_bytes, (long long) bytes) + (long long) bytes;
+    peak = atomic_load(&tracker->peak_bytes);
+    while (live > peak && !atomic_compare_exchange_weak(&tracker->peak_bytes, &peak, live))
+        ;
+
+    return header + 1;
+}
+
+static void
+tracking_free(void* ctx, void* ptr, const char* file, int line)
+{
+    alloc_tracker_t* tracker = (alloc_tracker_t*) ctx;
+    block_header_t* header;
+
+    if (ptr == NULL)
+        return;
+
+    header = (block_header_t*) ptr - 1;
+
+    if (header->info.site >= 0)
+    {
+        pthread_mutex_lock(&tracker->sites_lock);
+        tracker->sites[header->info.site].live_allocs--;
+        tracker->sites[header->info.site].live_bytes -= header->info.size;
+        pthread_mutex_unlock(&tracker->sites_lock);
+    }
+
+    atomic_fetch_add(&tracker->frees, 1);
+    atomic_fetch_sub(&tracker->live_bytes, (long long) header->info.size);
+    free(header);
+}
+
+static int
+compare_sites(const void* a, const void* b)
+{
+    const alloc_site_t* x = (const alloc_site_t*) a;
+    const alloc_site_t* y = (const alloc_site_t*) b;
+    if (x->live_bytes != y->live_bytes)
+        return x->live_bytes < y->live_bytes ? 1 : -1;
+    if (x->total_bytes != y->total_bytes)
+        return x->total_bytes < y->total_bytes ? 1 : -1;
+    return 0;
+}
+
+
+/*
+ * Functions
+ */
+
+
+void
+mpls_set_allocator(const mpls_allocator_t* allocator)
+{
+    if (allocator == NULL)
+    {
+        current_allocator.calloc = default_calloc;
+        current_allocator.free = default_free;
+        current_allocator.ctx = NULL;
+    }
+    else
+    {
+        current_allocator = *allocator;
+    }
+}
+
+void*
+mpls_calloc_at(size_t count, size_t size, const char* file, int line)
+{
+    if (size != 0 && count > SIZE_MAX / size)
+        return NULL;
+
+    STATS_ADD(STATS_ALLOCS, 1);
+    STATS_ADD(STATS_ALLOC_BYTES, count * size);
+    return current_allocator.calloc(current_allocator.ctx, count, size, file, line);
+}
+
+void
+mpls_free_at(void* ptr, const char* file, int line)
+{
+    if (ptr != NULL)
+        current_allocator.free(current_allocator.ctx, ptr, file, line);
+}
+
+char*
+mpls_strdup_at(const char* str, const char* file, int line)
+{
+    size_t len = strlen(str);
+    char* copy = (char*) mpls_calloc_at(len + 1, sizeof(char), file, line);
+    if (copy != NULL)
+        memcpy(copy, str, len);
+    return copy;
+}
+
+void
+init_alloc_tracker_t(alloc_tracker_t* tracker)
+{
+    atomic_init(&tracker->live_bytes, 0);
+    atomic_init(&tracker->peak_bytes, 0);
+    atomic_init(&tracker->allocs, 0);
+    atomic_init(&tracker->frees, 0);
+    memset(tracker->sites, 0, sizeof(tracker->sites));
+    tracker->site_count = 0;
+    pthread_mutex_init(&tracker->sites_lock, NULL);
+}
+
+void
+free_alloc_tracker_members(alloc_tracker_t* tracker)
+{
+    pthread_mutex_destroy(&tracker->sites_lock);
+}
+
+mpls_allocator_t
+alloc_tracker_allocator(alloc_tracker_t* tracker)
+{
+    mpls_allocator_t allocator = { tracking_calloc, tracking_free, tracker };
+    return allocator;
+}
+
+void
+alloc_tracker_reset_peak(alloc_tracker_t* tracker)
+{
+    atomic_store(&tracker->peak_bytes, atomic_load(&tracker->live_bytes));
+}
+
+void
+alloc_tracker_print_sites(alloc_tracker_t* tracker, FILE* out, bool live_only)
+{
+    alloc_site_t sites[ALLOC_TRACKER_MAX_SITES];
+    int count;
+    int i;
+
+    pthread_mutex_lock(&tracker->sites_lock);
+    count = tracker->site_count;
+    memcpy(sites, tracker->sites, count * sizeof(alloc_site_t));
+    pthread_mutex_unlock(&tracker->sites_lock);
+
+    qsort(sites, count, sizeof(alloc_site_t), compare_sites);
+
+    fprintf(out, "\t site                          allocs     total bytes    live allocs     live bytes\n");
+    fprintf(out, "\t -------------------------   --------   -------------   ------------   ------------\n");
+    for (i = 0; i < count; i++)
+    {
+        char location[64];
+
+        if (live_only && sites[i].live_allocs == 0)
+            continue;
+
+        snprintf(location, sizeof(location), "%s:%i", sites[i].file, sites[i].line);
+        fprintf(out, "\t %-25s   %8lli   %13lli   %12lli   %12lli\n", location,
+                sites[i].allocs, sites[i].total_bytes, sites[i].live_allocs, sites[i].live_bytes);
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,138 @@
+/*
+ * File:   allocator.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Pluggable allocator for the parser.  Everything the parser allocates
+ * (file data, paths, stream clips, chapters, marks, strings) goes through
+ * MPLS_CALLOC() / MPLS_FREE(), which forward to the installed allocator.
+ *
+ * The default allocator is calloc()/free().  The tracking allocator keeps
+ * live and peak byte counts and a per-site (file:line) table, for
+ * --mem-report and for leak checks in CI.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef ALLOCATOR_H
+#define	ALLOCATOR_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+#define ALLOC_TRACKER_MAX_SITES 64
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    /* Must return zeroed memory (like calloc), or NULL */
+    void* (*calloc)(void* ctx, size_t count, size_t size, const char* file, int line);
+    void  (*free)(void* ctx, void* ptr, const char* file, int line);
+    void* ctx;
+} mpls_allocator_t;
+
+typedef struct {
+    const char* file;
+    int line;
+    long long allocs;
+    long long live_allocs;
+    long long total_bytes;
+    long long live_bytes;
+} alloc_site_t;
+
+typedef struct {
+    atomic_llong live_bytes;
+    atomic_llong peak_bytes;
+    atomic_llong allocs;
+    atomic_llong frees;
+    alloc_site_t sites[ALLOC_TRACKER_MAX_SITES];
+    int site_count;
+    pthread_mutex_t sites_lock;
+} alloc_tracker_t;
+
+
+/*
+ * Macros
+ */
+
+
+#define MPLS_CALLOC(count, size) mpls_calloc_at(count, size, __FILE__, __LINE__)
+#define MPLS_FREE(ptr)           mpls_free_at(ptr, __FILE__, __LINE__)
+#define MPLS_STRDUP(str)         mpls_strdup_at(str, __FILE__, __LINE__)
+
+
+/*
+ * Functions
+ */
+
+
+/**
+ * Installs an allocator.  Must be called before the parser allocates
+ * anything, since memory has to be freed by the allocator that made it.
+ * @param allocator copied; NULL restores calloc()/free()
+ */
+void
+mpls_set_allocator(const mpls_allocator_t* allocator);
+
+void*
+mpls_calloc_at(size_t count, size_t size, const char* file, int line);
+
+void
+mpls_free_at(void* ptr, const char* file, int line);
+
+char*
+mpls_strdup_at(const char* str, const char* file, int line);
+
+void
+init_alloc_tracker_t(alloc_tracker_t* tracker);
+
+void
+free_alloc_tracker_members(alloc_tracker_t* tracker);
+
+/**
+ * @param tracker must outlive every allocation made through the result
+ * @return An allocator that records into tracker.
+ */
+mpls_allocator_t
+alloc_tracker_allocator(alloc_tracker_t* tracker);
+
+/**
+ * Starts a new peak measurement at the current live byte count.
+ * @param tracker
+ */
+void
+alloc_tracker_reset_peak(alloc_tracker_t* tracker);
+
+/**
+ * Prints the allocation sites, busiest first.
+ * @param tracker
+ * @param out
+ * @param live_only only sites that still have live allocations (leaks)
+ */
+void
+alloc_tracker_print_sites(alloc_tracker_t* tracker, FILE* out, bool live_only);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* ALLOCATOR_H */
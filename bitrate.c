@@ -0,0 +1,393 @@
+/*
+ * File:   bitrate.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "bitrate.h"
+#include "disc.h"
+#include "scheduler.h"
+
+#include <unistd.h>
+
+
+/*
+ * Constants
+ */
+
+
+#define WINDOW_BUCKETS 16 /* buckets a chunk accumulates locally before adding them to the timeline */
+#define COLUMN_UNSET   0xFF
+
+
+/*
+ * Private types
+ */
+
+
+typedef struct {
+    bitrate_series_t* series;
+    char path[PATH_MAX];
+    sched_file_t file;           /* the read of path */
+    int64_t in_ticks;            /* IN_time, 27 MHz */
+    int64_t out_ticks;           /* OUT_time, 27 MHz */
+    int64_t start_ticks;         /* start within the playlist, 27 MHz */
+} bitrate_clip_t;
+
+typedef struct {
+    bitrate_series_t* series;
+    int64_t first;               /* bucket of bytes[0], or -1 while empty */
+    uint64_t* bytes;             /* WINDOW_BUCKETS x stream_count */
+} bitrate_window_t;
+
+
+/*
+ * Private functions
+ */
+
+
+static const char*
+kind_name(uint8_t kind)
+{
+    static const char* names[MPLS_STREAM_KIND_COUNT] = {
+        "video", "audio", "pg", "ig", "secondary_audio", "secondary_video"
+    };
+    return kind < MPLS_STREAM_KIND_COUNT ? names[kind] : "other";
+}
+
+static void
+flush_window(bitrate_window_t* window)
+{
+    bitrate_series_t* series = window->series;
+    size_t cells = (size_t) WINDOW_BUCKETS * series->stream_count;
+    size_t i;
+
+    if (window->first < 0)
+        return;
+
+    for (i = 0; i < cells; i++)
+    {
+        size_t bucket = window->first + i / series->stream_count;
+
+        if (window->bytes[i] != 0 && bucket < series->bucket_count)
+            atomic_fetch_add(&series->bytes[bucket * series->stream_count + i % series->stream_count], window->bytes[i]);
+    }
+
+    memset(window->bytes, 0, cells * sizeof(uint64_t));
+    window->first = -1;
+}
+
+static inline void
+add_bytes(bitrate_window_t* window, int64_t bucket, int column, uint64_t n)
+{
+    if (window->first < 0 || bucket < window->first || bucket >= window->first + WINDOW_BUCKETS)
+    {
+        flush_window(window);
+        window->first = bucket;
+    }
+    window->bytes[(bucket - window->first) * window->series->stream_count + column] += n;
+}
+
+/**
+ * Times every packet of a chunk and adds it to the window.  Packets are
+ * timed from the most recent PCR in the chunk, and those before the first
+ * PCR backwards from it.  A chunk without any PCR cannot be timed and is
+ * skipped.
+ * @param clip
+ * @param data starts at a packet boundary
+ * @param size
+ * @param window
+ */
+static void
+scan_chunk(const bitrate_clip_t* clip, const uint8_t* data, size_t size, bitrate_window_t* window)
+{
+    const bitrate_series_t* series = clip->series;
+    int64_t interval = series->interval_ticks * M2TS_TICKS_PER_TIMECODE;
+    int64_t duration = clip->out_ticks - clip->in_ticks;
+    size_t whole = size - size % M2TS_PACKET_SIZE;
+    int64_t elapsed = 0;         /* ATS ticks since the first packet of the chunk */
+    int64_t anchor_pcr = -1;
+    int64_t anchor_elapsed = 0;
+    int64_t pcr;
+    uint32_t last_ats;
+    size_t pos;
+
+    if (whole == 0)
+        return;
+
+    last_ats = m2ts_packet_ats(data);
+    for (pos = 0; pos < whole && anchor_pcr < 0; pos += M2TS_PACKET_SIZE)
+    {
+        const uint8_t* packet = data + pos;
+        uint32_t ats = m2ts_packet_ats(packet);
+
+        elapsed += (ats - last_ats) & M2TS_ATS_MASK;
+        last_ats = ats;
+        if (packet[4] == TS_SYNC_BYTE && m2ts_packet_pcr(packet, &pcr))
+        {
+            anchor_pcr = pcr;
+            anchor_elapsed = elapsed;
+        }
+    }
+    if (anchor_pcr < 0)
+        return;
+
+    elapsed = 0;
+    last_ats = m2ts_packet_ats(data);
+    for (pos = 0; pos < whole; pos += M2TS_PACKET_SIZE)
+    {
+        const uint8_t* packet = data + pos;
+        uint32_t ats = m2ts_packet_ats(packet);
+        int64_t clip_time;
+
+        // The ATS wraps every 2^30 ticks (about 40 s); consecutive packets are never that far apart
+        elapsed += (ats - last_ats) & M2TS_ATS_MASK;
+        last_ats = ats;
+        if (packet[4] != TS_SYNC_BYTE)
+            continue;
+        if (m2ts_packet_pcr(packet, &pcr))
+        {
+            anchor_pcr = pcr;
+            anchor_elapsed = elapsed;
+        }
+
+        clip_time = anchor_pcr + (elapsed - anchor_elapsed) - clip->in_ticks;
+        if (clip_time < 0 || clip_time >= duration)
+            continue;
+
+        add_bytes(window, (clip->start_ticks + clip_time) / interval, series->columns[m2ts_packet_pid(packet)],
+                  TS_PACKET_SIZE);
+    }
+}
+
+static void
+count_chunk(sched_file_t* file, size_t index, const uint8_t* data, size_t size)
+{
+    bitrate_clip_t* clip = (bitrate_clip_t*) file->arg;
+    bitrate_window_t window;
+
+    window.series = clip->series;
+    window.first = -1;
+    window.bytes = (uint64_t*) calloc((size_t) WINDOW_BUCKETS * clip->series->stream_count, sizeof(uint64_t));
+    scan_chunk(clip, data, size, &window);
+    flush_window(&window);
+    free(window.bytes);
+}
+
+
+/*
+ * Functions
+ */
+
+
+void
+init_bitrate_series_t(bitrate_series_t* series, const mpls_file_t* mpls_file, const playlist_t* playlist,
+                      int64_t interval_ticks)
+{
+    mpls_view_t view;
+    mpls_play_item_iter_t item;
+    mpls_stream_iter_t stream;
+    bool has_item;
+    bool has_stream;
+    int i;
+
+    memset(series, 0, sizeof(*series));
+    memset(series->columns, COLUMN_UNSET, sizeof(series->columns));
+    series->interval_ticks = interval_ticks;
+    series->duration_ticks = sec_to_timecode(playlist->duration_sec);
+    series->bucket_count = (series->duration_ticks + interval_ticks - 1) / interval_ticks;
+
+    // One column per PID, in STN order of the first PlayItem that names it
+    mpls_view_init(&view, mpls_file);
+    for (has_item = mpls_view_play_items(&view, &item); has_item; has_item = mpls_play_item_next(&item))
+    {
+        for (has_stream = mpls_play_item_streams(&item, &stream); has_stream; has_stream = mpls_stream_next(&stream))
+        {
+            uint16_t pid = mpls_stream_pid(&stream);
+
+            if (pid >= ARRAY_SIZE(series->columns) || series->columns[pid] != COLUMN_UNSET ||
+                series->stream_count == BITRATE_MAX_STREAMS - 1)
+                continue;
+
+            series->columns[pid] = series->stream_count;
+            series->streams[series->stream_count].pid = pid;
+            series->streams[series->stream_count].kind = stream.kind;
+            series->stream_count++;
+        }
+    }
+
+    series->streams[series->stream_count].pid = BITRATE_PID_OTHER;
+    series->streams[series->stream_count].kind = MPLS_STREAM_KIND_COUNT;
+    for (i = 0; i < (int) ARRAY_SIZE(series->columns); i++)
+    {
+        if (series->columns[i] == COLUMN_UNSET)
+            series->columns[i] = series->stream_count;
+    }
+    series->stream_count++;
+
+    series->bytes = (atomic_ullong*) calloc(series->bucket_count * series->stream_count + 1, sizeof(atomic_ullong));
+    if (series->bytes == NULL)
+    {
+        DIE("Out of memory.");
+    }
+}
+
+void
+free_bitrate_series_members(bitrate_series_t* series)
+{
+    free(series->bytes);
+    series->bytes = NULL;
+    series->bucket_count = 0;
+}
+
+bool
+bitrate_scan(bitrate_series_t* series, const char* playlist_path, const playlist_t* playlist, int jobs)
+{
+    bitrate_clip_t* clips = (bitrate_clip_t*) calloc(playlist->stream_clip_list.count + 1, sizeof(bitrate_clip_t));
+    stream_clip_t* stream_clip;
+    sched_t sched;
+    bool ok = true;
+    int i = 0;
+
+    init_sched_t(&sched, jobs);
+
+    for (stream_clip = playlist->stream_clip_list.first; stream_clip != NULL; stream_clip = stream_clip->next, i++)
+    {
+        bitrate_clip_t* clip = &clips[i];
+
+        clip->series = series;
+        init_sched_file_t(&clip->file, clip->path, BITRATE_CHUNK_SIZE, sizeof(void*), count_chunk, clip);
+        clip->in_ticks = sec_to_timecode(stream_clip->time_in_sec) * M2TS_TICKS_PER_TIMECODE;
+        clip->out_ticks = sec_to_timecode(stream_clip->time_out_sec) * M2TS_TICKS_PER_TIMECODE;
+        clip->start_ticks = sec_to_timecode(stream_clip->relative_time_in_sec) * M2TS_TICKS_PER_TIMECODE;
+
+        if (!disc_find_clip_file(playlist_path, stream_clip->filename, "STREAM", "m2ts", clip->path, sizeof(clip->path), NULL))
+        {
+            fprintf(stderr, "%s: stream file %s not found.\n", playlist_path, stream_clip->filename);
+            ok = false;
+            continue;
+        }
+        sched_read_file(&sched, &clip->file);
+    }
+
+    sched_run(&sched);
+    free_sched_members(&sched);
+
+    for (i = 0; i < playlist->stream_clip_list.count; i++)
+    {
+        int error = atomic_load(&clips[i].file.read_errno);
+        if (error != 0)
+        {
+            fprintf(stderr, "%s: %s\n", clips[i].path, strerror(error));
+            ok = false;
+        }
+    }
+
+    free(clips);
+    return ok;
+}
+
+void
+bitrate_write_csv(const bitrate_series_t* series, FILE* out)
+{
+    size_t b;
+    int s;
+
+    fprintf(out, "time,total");
+    for (s = 0; s < series->stream_count; s++)
+    {
+        if (series->streams[s].pid == BITRATE_PID_OTHER)
+            fprintf(out, ",other");
+        else
+            fprintf(out, ",%s_0x%04x", kind_name(series->streams[s].kind), series->streams[s].pid);
+    }
+    fprintf(out, "\n");
+
+    for (b = 0; b < series->bucket_count; b++)
+    {
+        int64_t start = (int64_t) b * series->interval_ticks;
+        // The last bucket may be shorter than the interval
+        int64_t length = series->duration_ticks - start < series->interval_ticks
+                       ? series->duration_ticks - start : series->interval_ticks;
+        const atomic_ullong* row = series->bytes + b * series->stream_count;
+        uint64_t total = 0;
+
+        for (s = 0; s < series->stream_count; s++)
+            total += atomic_load(&row[s]);
+
+        fprintf(out, "%.3f,%llu", timecode_to_sec(start), (unsigned long long) (total * 8 * 45000 / length));
+        for (s = 0; s < series->stream_count; s++)
+            fprintf(out, ",%llu", (unsigned long long) (atomic_load(&row[s]) * 8 * 45000 / length));
+        fprintf(out, "\n");
+    }
+}
+
+bool
+bitrate_write_bin(const bitrate_series_t* series, FILE* out)
+{
+    bitrate_header_t header;
+    uint64_t* row = (uint64_t*) calloc(series->stream_count, sizeof(uint64_t));
+    bool ok;
+    size_t b;
+    int s;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BITRATE_MAGIC, sizeof(header.magic));
+    header.version = BITRATE_VERSION;
+    header.header_size = sizeof(header);
+    header.stream_count = series->stream_count;
+    header.bucket_count = series->bucket_count;
+    header.interval_ticks = series->interval_ticks;
+    header.duration_ticks = series->duration_ticks;
+
+    ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+         fwrite(series->streams, sizeof(bitrate_stream_t), series->stream_count, out) == (size_t) series->stream_count;
+
+    for (b = 0; b < series->bucket_count && ok; b++)
+    {
+        for (s = 0; s < series->stream_count; s++)
+            row[s] = atomic_load(&series->bytes[b * series->stream_count + s]);
+        ok = fwrite(row, sizeof(uint64_t), series->stream_count, out) == (size_t) series->stream_count;
+    }
+
+    free(row);
+    return ok && fflush(out) == 0;
+}
+
+bool
+bitrate_run(char* path, double interval_sec, bool bin, int jobs)
+{
+    mpls_file_t mpls_file;
+    playlist_t playlist = create_playlist_t();
+    bitrate_series_t* series = (bitrate_series_t*) malloc(sizeof(bitrate_series_t));
+    bool ok;
+
+    if (bin && isatty(STDOUT_FILENO))
+    {
+        DIE("Refusing to write binary output to a terminal; redirect stdout to a file.");
+    }
+
+    mpls_file = init_mpls(path);
+    parse_playlist(&mpls_file, &playlist, FIELD_CLIPS);
+
+    init_bitrate_series_t(series, &mpls_file, &playlist, sec_to_timecode(interval_sec));
+    ok = bitrate_scan(series, path, &playlist, jobs);
+
+    if (bin)
+    {
+        if (!bitrate_write_bin(series, stdout))
+        {
+            DIE("Error writing binary output.");
+        }
+    }
+    else
+        bitrate_write_csv(series, stdout);
+
+    free_bitrate_series_members(series);
+    free(series);
+    free_playlist_members(&playlist);
+    free_mpls_file_members(&mpls_file);
+    return ok;
+}
@@ -0,0 +1,159 @@
+/*
+ * File:   bitrate.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Bitrate time series (--bitrate): scans the stream files of a playlist and
+ * counts the bytes of every stream in fixed-length buckets of playlist time.
+ *
+ * Packets are timed by the program clock: the most recent PCR plus the
+ * arrival time (ATS) elapsed since it.  The time is taken relative to the
+ * PlayItem's IN_time, packets outside IN/OUT are dropped, and the PlayItem's
+ * start within the playlist (relative_time_in_sec) is added, so clips are
+ * stitched in playlist order.
+ *
+ * Files are read in chunks by sched_read_file(), as by --verify.  A chunk is
+ * timed from its own PCRs, so chunks of one clip are scanned in parallel;
+ * each accumulates into a small window of buckets that is added to the
+ * shared timeline with atomics.  Memory depends on the playlist duration
+ * and stream count only, not on the size of the stream files.
+ *
+ * Columns are the PIDs named by the STN tables of the PlayItems, in order
+ * of first appearance, plus one for every other PID (PAT, PMT, PCR, ...).
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef BITRATE_H
+#define	BITRATE_H
+
+#include "parse_mpls.h"
+#include "m2ts.h"
+#include "mpls_view.h"
+
+#include <stdatomic.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+#define BITRATE_MAGIC       "MPLSBPS"   /* 8 bytes including the NUL */
+#define BITRATE_VERSION     1
+#define BITRATE_CHUNK_SIZE  (M2TS_ALIGNED_UNIT_SIZE * 512) /* 3 MiB */
+#define BITRATE_PID_OTHER   0xFFFF      /* column for PIDs outside the STN tables */
+#define BITRATE_MAX_STREAMS 256
+
+
+/*
+ * Structs - on-disk records (--format=bin)
+ *
+ * header | streams | bytes[bucket_count][stream_count] (uint64_t)
+ *
+ * Little-endian, 8-byte aligned, like mplsbin.h.  Bucket i covers playlist
+ * time [i, i + 1) * interval_ticks.
+ */
+
+
+typedef struct {
+    char magic[8];               /* BITRATE_MAGIC */
+    uint16_t version;            /* BITRATE_VERSION */
+    uint16_t header_size;        /* sizeof(bitrate_header_t) */
+    uint32_t stream_count;
+    uint64_t bucket_count;
+    int64_t interval_ticks;      /* 45 kHz */
+    int64_t duration_ticks;      /* of the playlist */
+} bitrate_header_t;
+
+typedef struct {
+    uint16_t pid;                /* BITRATE_PID_OTHER for the last column */
+    uint8_t kind;                /* mpls_stream_kind_t; MPLS_STREAM_KIND_COUNT for "other" */
+    uint8_t reserved[5];
+} bitrate_stream_t;
+
+
+/*
+ * Structs - in memory
+ */
+
+
+typedef struct {
+    int64_t interval_ticks;
+    int64_t duration_ticks;
+    size_t bucket_count;
+    bitrate_stream_t streams[BITRATE_MAX_STREAMS];
+    int stream_count;
+    uint8_t columns[8192];       /* column of each PID */
+    atomic_ullong* bytes;        /* bucket_count x stream_count TS bytes */
+} bitrate_series_t;
+
+
+/*
+ * Functions
+ */
+
+
+/**
+ * Sets up an empty timeline for a playlist: its duration and its columns.
+ * @param series
+ * @param mpls_file must have passed check_mpls()
+ * @param playlist parsed with at least FIELD_CLIPS
+ * @param interval_ticks bucket length in 45 kHz ticks (> 0)
+ */
+void
+init_bitrate_series_t(bitrate_series_t* series, const mpls_file_t* mpls_file, const playlist_t* playlist,
+                      int64_t interval_ticks);
+
+void
+free_bitrate_series_members(bitrate_series_t* series);
+
+/**
+ * Scans the stream file of every PlayItem into the timeline.  Missing
+ * files are reported on stderr and leave a gap.
+ * @param series
+ * @param playlist_path path of the .mpls file, to locate BDMV/STREAM
+ * @param playlist
+ * @param jobs number of worker threads
+ * @return false if a stream file was missing or unreadable.
+ */
+bool
+bitrate_scan(bitrate_series_t* series, const char* playlist_path, const playlist_t* playlist, int jobs);
+
+/**
+ * Writes "time,total,<column>..." rows in bits per second.
+ * @param series
+ * @param out
+ */
+void
+bitrate_write_csv(const bitrate_series_t* series, FILE* out);
+
+/**
+ * @param series
+ * @param out
+ * @return false on a write error.
+ */
+bool
+bitrate_write_bin(const bitrate_series_t* series, FILE* out);
+
+/**
+ * Builds and prints the bitrate time series of one playlist.
+ * @param path .mpls file
+ * @param interval_sec bucket length
+ * @param bin write the binary form instead of CSV
+ * @param jobs
+ * @return false if a stream file could not be read.
+ */
+bool
+bitrate_run(char* path, double interval_sec, bool bin, int jobs);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* BITRATE_H */
@@ -0,0 +1,423 @@
+/*
+ * File:   catalog.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "catalog.h"
+
+
+static const char* column_names[CATALOG_COL_COUNT] = {
+    "duration",
+    "clips",
+    "chapters",
+    "tracks",
+    "video",
+    "audio",
+    "subtitles"
+};
+
+
+/*
+ * Private functions
+ */
+
+
+static void
+grow_rows(catalog_t* catalog)
+{
+    int c;
+    size_t capacity = catalog->row_capacity ? catalog->row_capacity * 2 : 64;
+    catalog->names = (char**) realloc(catalog->names, capacity * sizeof(char*));
+    catalog->chapter_start = (size_t*) realloc(catalog->chapter_start, capacity * sizeof(size_t));
+    catalog->clip_start = (size_t*) realloc(catalog->clip_start, capacity * sizeof(size_t));
+    for (c = 0; c < CATALOG_COL_COUNT; c++)
+        catalog->columns[c] = (int64_t*) realloc(catalog->columns[c], capacity * sizeof(int64_t));
+    catalog->row_capacity = capacity;
+}
+
+static void
+reserve_chapters(catalog_t* catalog, size_t count)
+{
+    size_t capacity = catalog->chapter_capacity ? catalog->chapter_capacity : 256;
+    while (capacity < catalog->chapter_total + count)
+        capacity *= 2;
+    if (capacity != catalog->chapter_capacity)
+    {
+        catalog->chapter_ticks = (int64_t*) realloc(catalog->chapter_ticks, capacity * sizeof(int64_t));
+        catalog->chapter_capacity = capacity;
+    }
+}
+
+static void
+reserve_clips(catalog_t* catalog, size_t count)
+{
+    size_t capacity = catalog->clip_capacity ? catalog->clip_capacity : 256;
+    while (capacity < catalog->clip_total + count)
+        capacity *= 2;
+    if (capacity != catalog->clip_capacity)
+    {
+        catalog->clip_ids = (int32_t*) realloc(catalog->clip_ids, capacity * sizeof(int32_t));
+        catalog->clip_capacity = capacity;
+    }
+}
+
+static void
+free_clip_index(catalog_t* catalog)
+{
+    free(catalog->clip_index_keys); catalog->clip_index_keys = NULL;
+    free(catalog->clip_index_offsets); catalog->clip_index_offsets = NULL;
+    free(catalog->clip_index_rows); catalog->clip_index_rows = NULL;
+    catalog->clip_index_key_count = 0;
+    catalog->clip_index_valid = false;
+}
+
+/**
+ * Converts "00800.M2TS" to 800.
+ */
+static int32_t
+clip_id_from_filename(const char* filename)
+{
+    char digits[6];
+    strncpy(digits, filename, 5);
+    digits[5] = '\0';
+    return (int32_t) strtol(digits, NULL, 10);
+}
+
+static int
+compare_clip_pairs(const void* a, const void* b)
+{
+    const int64_t x = *(const int64_t*) a;
+    const int64_t y = *(const int64_t*) b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Each predicate is a separate loop over a single column so that the compiler
+ * can vectorize the comparison; the AND with the selection is branch-free.
+ */
+#define FILTER_LOOP(cmp) \
+    for (i = 0; i < n; i++) \
+        selection[i] &= (uint8_t)(col[i] cmp value);
+
+
+/*
+ * Lifecycle
+ */
+
+
+void
+init_catalog_t(catalog_t* catalog)
+{
+    memset(catalog, 0, sizeof(catalog_t));
+}
+
+void
+free_catalog_members(catalog_t* catalog)
+{
+    size_t i;
+    int c;
+    for (i = 0; i < catalog->row_count; i++)
+        free(catalog->names[i]);
+    free(catalog->names);
+    for (c = 0; c < CATALOG_COL_COUNT; c++)
+        free(catalog->columns[c]);
+    free(catalog->chapter_start);
+    free(catalog->chapter_ticks);
+    free(catalog->clip_start);
+    free(catalog->clip_ids);
+    free_clip_index(catalog);
+    init_catalog_t(catalog);
+}
+
+size_t
+catalog_add_playlist(catalog_t* catalog, const char* name, const playlist_t* playlist)
+{
+    size_t row = catalog->row_count;
+    size_t i;
+    const stream_clip_t* first_clip = playlist->stream_clip_list.first;
+    const stream_clip_t* clip;
+
+    if (row == catalog->row_capacity)
+        grow_rows(catalog);
+
+    catalog->names[row] = strdup(name);
+    catalog->columns[CATALOG_COL_DURATION][row] = sec_to_timecode(playlist->duration_sec);
+    catalog->columns[CATALOG_COL_CLIP_COUNT][row] = playlist->stream_clip_list.count;
+    catalog->columns[CATALOG_COL_CHAPTER_COUNT][row] = playlist->chapter_count;
+    catalog->columns[CATALOG_COL_TRACK_COUNT][row] = first_clip ? first_clip->track_count : 0;
+    catalog->columns[CATALOG_COL_VIDEO_COUNT][row] = first_clip ? first_clip->video_count : 0;
+    catalog->columns[CATALOG_COL_AUDIO_COUNT][row] = first_clip ? first_clip->audio_count : 0;
+    catalog->columns[CATALOG_COL_SUBTITLE_COUNT][row] = first_clip ? first_clip->subtitle_count : 0;
+
+    reserve_chapters(catalog, playlist->chapter_count);
+    catalog->chapter_start[row] = catalog->chapter_total;
+    for (i = 0; i < playlist->chapter_count; i++)
+        catalog->chapter_ticks[catalog->chapter_total++] = sec_to_timecode(playlist->chapters[i]);
+
+    reserve_clips(catalog, playlist->stream_clip_list.count);
+    catalog->clip_start[row] = catalog->clip_total;
+    for (clip = first_clip; clip != NULL; clip = clip->next)
+        catalog->clip_ids[catalog->clip_total++] = clip_id_from_filename(clip->filename);
+
+    catalog->row_count++;
+    catalog->clip_index_valid = false;
+
+    return row;
+}
+
+void
+catalog_build_clip_index(catalog_t* catalog)
+{
+    size_t row, i, k;
+    size_t n = catalog->clip_total;
+
+    free_clip_index(catalog);
+
+    // Sort (clip ID, row) pairs packed into one int64 so a single qsort groups
+    // rows by clip and keeps each group in row order.
+    int64_t* pairs = (int64_t*) calloc(n ? n : 1, sizeof(int64_t));
+    for (row = 0; row < catalog->row_count; row++)
+    {
+        size_t end = (row + 1 < catalog->row_count) ? catalog->clip_start[row + 1] : catalog->clip_total;
+        for (i = catalog->clip_start[row]; i < end; i++)
+            pairs[i] = ((int64_t) catalog->clip_ids[i] << 32) | (int64_t) row;
+    }
+    qsort(pairs, n, sizeof(int64_t), compare_clip_pairs);
+
+    catalog->clip_index_keys = (int32_t*) calloc(n ? n : 1, sizeof(int32_t));
+    catalog->clip_index_offsets = (size_t*) calloc(n + 1, sizeof(size_t));
+    catalog->clip_index_rows = (size_t*) calloc(n ? n : 1, sizeof(size_t));
+
+    k = 0;
+    for (i = 0; i < n; i++)
+    {
+        int32_t clip_id = (int32_t) (pairs[i] >> 32);
+        size_t pair_row = (size_t) (pairs[i] & 0xFFFFFFFF);
+
+        // A playlist may reference the same clip more than once; index it once.
+        if (k > 0 && catalog->clip_index_keys[k - 1] == clip_id)
+        {
+            size_t last = catalog->clip_index_offsets[k] - 1;
+            if (catalog->clip_index_rows[last] == pair_row)
+                continue;
+        }
+        else
+        {
+            catalog->clip_index_keys[k] = clip_id;
+            catalog->clip_index_offsets[k + 1] = catalog->clip_index_offsets[k];
+            k++;
+        }
+        catalog->clip_index_rows[catalog->clip_index_offsets[k]++] = pair_row;
+    }
+
+    catalog->clip_index_key_count = k;
+    catalog->clip_index_valid = true;
+    free(pairs);
+}
+
+
+/*
+ * Accessors
+ */
+
+
+const char*
+catalog_column_name(catalog_column_t column)
+{
+    return (column >= 0 && column < CATALOG_COL_COUNT) ? column_names[column] : NULL;
+}
+
+const size_t*
+catalog_rows_with_clip(catalog_t* catalog, int32_t clip_id, size_t* count)
+{
+    size_t lo = 0;
+    size_t hi;
+
+    if (!catalog->clip_index_valid)
+        catalog_build_clip_index(catalog);
+
+    hi = catalog->clip_index_key_count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (catalog->clip_index_keys[mid] < clip_id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == catalog->clip_index_key_count || catalog->clip_index_keys[lo] != clip_id)
+    {
+        *count = 0;
+        return NULL;
+    }
+
+    *count = catalog->clip_index_offsets[lo + 1] - catalog->clip_index_offsets[lo];
+    return catalog->clip_index_rows + catalog->clip_index_offsets[lo];
+}
+
+
+/*
+ * Queries
+ */
+
+
+void
+catalog_filter(const catalog_t* catalog, const catalog_predicate_t* predicate, uint8_t* selection)
+{
+    size_t i;
+    const size_t n = catalog->row_count;
+    const int64_t* col = catalog->columns[predicate->column];
+    const int64_t value = predicate->value;
+
+    switch (predicate->op)
+    {
+        case CATALOG_OP_EQ: FILTER_LOOP(==); break;
+        case CATALOG_OP_NE: FILTER_LOOP(!=); break;
+        case CATALOG_OP_LT: FILTER_LOOP(<);  break;
+        case CATALOG_OP_LE: FILTER_LOOP(<=); break;
+        case CATALOG_OP_GT: FILTER_LOOP(>);  break;
+        case CATALOG_OP_GE: FILTER_LOOP(>=); break;
+    }
+}
+
+size_t
+catalog_run_query(catalog_t* catalog, const catalog_query_t* query, uint8_t* selection)
+{
+    size_t i;
+    size_t selected = 0;
+
+    if (query->clip_id == CATALOG_NO_CLIP)
+    {
+        memset(selection, 1, catalog->row_count);
+    }
+    else
+    {
+        size_t count;
+        const size_t* rows = catalog_rows_with_clip(catalog, query->clip_id, &count);
+        memset(selection, 0, catalog->row_count);
+        for (i = 0; i < count; i++)
+            selection[rows[i]] = 1;
+    }
+
+    for (i = 0; i < query->predicate_count; i++)
+        catalog_filter(catalog, &query->predicates[i], selection);
+
+    for (i = 0; i < catalog->row_count; i++)
+        selected += selection[i];
+
+    return selected;
+}
+
+int64_t
+catalog_aggregate(const catalog_t* catalog, catalog_column_t column, catalog_agg_t agg, const uint8_t* selection)
+{
+    size_t i;
+    const size_t n = catalog->row_count;
+    const int64_t* col = catalog->columns[column];
+    int64_t result = 0;
+    bool any = false;
+
+    switch (agg)
+    {
+        case CATALOG_AGG_COUNT:
+            if (selection == NULL)
+                return (int64_t) n;
+            for (i = 0; i < n; i++)
+                result += selection[i];
+            break;
+        case CATALOG_AGG_SUM:
+            // Multiply by the 0/1 selection instead of branching
+            for (i = 0; i < n; i++)
+                result += col[i] * (selection ? selection[i] : 1);
+            break;
+        case CATALOG_AGG_MIN:
+        case CATALOG_AGG_MAX:
+            for (i = 0; i < n; i++)
+            {
+                if (selection != NULL && !selection[i])
+                    continue;
+                if (!any ||
+                    (agg == CATALOG_AGG_MIN && col[i] < result) ||
+                    (agg == CATALOG_AGG_MAX && col[i] > result))
+                    result = col[i];
+                any = true;
+            }
+            break;
+    }
+
+    return result;
+}
+
+bool
+catalog_parse_query(const char* text, catalog_query_t* query)
+{
+    const char* p = text;
+
+    query->predicate_count = 0;
+    query->clip_id = CATALOG_NO_CLIP;
+
+    while (*p != '\0')
+    {
+        char name[32];
+        size_t len = 0;
+        catalog_op_t op;
+        char* end;
+        double value;
+        int c;
+
+        while (*p == ' ' || *p == ',')
+            p++;
+        if (*p == '\0')
+            break;
+
+        while ((*p >= 'a' && *p <= 'z') || *p == '_')
+        {
+            if (len + 1 >= sizeof(name))
+                return false;
+            name[len++] = *p++;
+        }
+        name[len] = '\0';
+
+        if      (strncmp(p, "<=", 2) == 0) { op = CATALOG_OP_LE; p += 2; }
+        else if (strncmp(p, ">=", 2) == 0) { op = CATALOG_OP_GE; p += 2; }
+        else if (strncmp(p, "!=", 2) == 0) { op = CATALOG_OP_NE; p += 2; }
+        else if (strncmp(p, "==", 2) == 0) { op = CATALOG_OP_EQ; p += 2; }
+        else if (*p == '=')                { op = CATALOG_OP_EQ; p += 1; }
+        else if (*p == '<')                { op = CATALOG_OP_LT; p += 1; }
+        else if (*p == '>')                { op = CATALOG_OP_GT; p += 1; }
+        else return false;
+
+        value = strtod(p, &end);
+        if (end == p)
+            return false;
+        p = end;
+
+        if (strcmp(name, "clip") == 0)
+        {
+            if (op != CATALOG_OP_EQ || query->clip_id != CATALOG_NO_CLIP)
+                return false;
+            query->clip_id = (int32_t) value;
+            continue;
+        }
+
+        for (c = 0; c < CATALOG_COL_COUNT; c++)
+        {
+            if (strcmp(name, column_names[c]) == 0)
+                break;
+        }
+        if (c == CATALOG_COL_COUNT || query->predicate_count == CATALOG_MAX_PREDICATES)
+            return false;
+
+        query->predicates[query->predicate_count].column = (catalog_column_t) c;
+        query->predicates[query->predicate_count].op = op;
+        query->predicates[query->predicate_count].value =
+            (c == CATALOG_COL_DURATION) ? sec_to_timecode(value) : (int64_t) value;
+        query->predicate_count++;
+    }
+
+    return true;
+}
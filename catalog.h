@@ -0,0 +1,215 @@
+/*
+ * File:   catalog.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Columnar in-memory catalog of parsed playlists.
+ *
+ * Every playlist added to the catalog becomes one row.  Scalar properties are
+ * stored column-wise (one contiguous int64_t array per column) so that filters
+ * and aggregates run as tight, branch-free loops over a single array.
+ * Variable-length properties (chapter start times and clip IDs) are stored
+ * flattened, with a per-row start offset into the flat array.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef CATALOG_H
+#define	CATALOG_H
+
+#include "parse_mpls.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+#define CATALOG_MAX_PREDICATES 16
+
+#define CATALOG_NO_CLIP -1 /* catalog_query_t.clip_id when no clip filter is set */
+
+
+/*
+ * Enums
+ */
+
+
+typedef enum {
+    CATALOG_COL_DURATION,       /* playlist duration in 45 kHz ticks */
+    CATALOG_COL_CLIP_COUNT,
+    CATALOG_COL_CHAPTER_COUNT,
+    CATALOG_COL_TRACK_COUNT,
+    CATALOG_COL_VIDEO_COUNT,
+    CATALOG_COL_AUDIO_COUNT,
+    CATALOG_COL_SUBTITLE_COUNT,
+    CATALOG_COL_COUNT           /* number of columns (not a column) */
+} catalog_column_t;
+
+typedef enum {
+    CATALOG_OP_EQ,
+    CATALOG_OP_NE,
+    CATALOG_OP_LT,
+    CATALOG_OP_LE,
+    CATALOG_OP_GT,
+    CATALOG_OP_GE
+} catalog_op_t;
+
+typedef enum {
+    CATALOG_AGG_COUNT,
+    CATALOG_AGG_SUM,
+    CATALOG_AGG_MIN,
+    CATALOG_AGG_MAX
+} catalog_agg_t;
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    size_t row_count;
+    size_t row_capacity;
+
+    char** names;                        /* one strdup'd name (usually the path) per row */
+    int64_t* columns[CATALOG_COL_COUNT]; /* one value per row in each column */
+
+    size_t* chapter_start;               /* row -> first index into chapter_ticks */
+    int64_t* chapter_ticks;              /* relative chapter start times of all rows */
+    size_t chapter_total;
+    size_t chapter_capacity;
+
+    size_t* clip_start;                  /* row -> first index into clip_ids */
+    int32_t* clip_ids;                   /* numeric clip IDs (e.g., 800 for "00800.M2TS") of all rows */
+    size_t clip_total;
+    size_t clip_capacity;
+
+    /* Inverted index (clip ID -> rows), built on demand by catalog_build_clip_index().
+     * Compressed sparse row layout: the rows referencing clip_index_keys[k] are
+     * clip_index_rows[clip_index_offsets[k] .. clip_index_offsets[k + 1]). */
+    bool clip_index_valid;
+    size_t clip_index_key_count;
+    int32_t* clip_index_keys;            /* sorted, unique */
+    size_t* clip_index_offsets;          /* clip_index_key_count + 1 entries */
+    size_t* clip_index_rows;
+} catalog_t;
+
+typedef struct {
+    catalog_column_t column;
+    catalog_op_t op;
+    int64_t value;
+} catalog_predicate_t;
+
+typedef struct {
+    catalog_predicate_t predicates[CATALOG_MAX_PREDICATES];
+    size_t predicate_count;
+    int32_t clip_id; /* CATALOG_NO_CLIP, or only match rows that reference this clip */
+} catalog_query_t;
+
+
+/*
+ * Lifecycle
+ */
+
+
+void
+init_catalog_t(catalog_t* catalog);
+
+void
+free_catalog_members(catalog_t* catalog);
+
+/**
+ * Appends a parsed playlist to the catalog as a new row.
+ * @param catalog
+ * @param name copied into the catalog (typically the path of the .mpls file)
+ * @param playlist fully parsed playlist (stream clips and chapters)
+ * @return Index of the new row.
+ */
+size_t
+catalog_add_playlist(catalog_t* catalog, const char* name, const playlist_t* playlist);
+
+/**
+ * (Re)builds the clip ID -> rows inverted index.  Called implicitly by
+ * catalog_rows_with_clip() and catalog_run_query() when the index is stale.
+ * @param catalog
+ */
+void
+catalog_build_clip_index(catalog_t* catalog);
+
+
+/*
+ * Accessors
+ */
+
+
+const char*
+catalog_column_name(catalog_column_t column);
+
+/**
+ * Returns the rows that reference the given clip ID.
+ * @param catalog
+ * @param clip_id numeric clip ID (e.g., 800 for "00800.M2TS")
+ * @param count receives the number of rows
+ * @return Pointer into the inverted index (valid until the catalog changes), or NULL if no row references the clip.
+ */
+const size_t*
+catalog_rows_with_clip(catalog_t* catalog, int32_t clip_id, size_t* count);
+
+
+/*
+ * Queries
+ */
+
+
+/**
+ * ANDs the given predicate into a selection vector (one byte per row, 1 = selected).
+ * @param catalog
+ * @param predicate
+ * @param selection array of catalog->row_count bytes
+ */
+void
+catalog_filter(const catalog_t* catalog, const catalog_predicate_t* predicate, uint8_t* selection);
+
+/**
+ * Evaluates a query into a selection vector.
+ * @param catalog
+ * @param query
+ * @param selection array of catalog->row_count bytes; overwritten
+ * @return Number of selected rows.
+ */
+size_t
+catalog_run_query(catalog_t* catalog, const catalog_query_t* query, uint8_t* selection);
+
+/**
+ * Aggregates a column over the selected rows.
+ * @param catalog
+ * @param column
+ * @param agg
+ * @param selection selection vector, or NULL for all rows
+ * @return The aggregate; 0 for MIN/MAX when no row is selected.
+ */
+int64_t
+catalog_aggregate(const catalog_t* catalog, catalog_column_t column, catalog_agg_t agg, const uint8_t* selection);
+
+/**
+ * Parses a comma-separated query such as "chapters>30,audio>=8,clip=800".
+ * Column names are those returned by catalog_column_name(); "duration" is
+ * given in seconds.  "clip=N" selects rows that reference clip N.
+ * @param text
+ * @param query receives the parsed query
+ * @return false if the text is not a valid query.
+ */
+bool
+catalog_parse_query(const char* text, catalog_query_t* query);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CATALOG_H */
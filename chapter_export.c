@@ -0,0 +1,489 @@
+/*
+ * File:   chapter_export.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "chapter_export.h"
+#include "catalog.h"
+#include "disc.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <unistd.h>
+
+
+/*
+ * Constants
+ */
+
+
+#define CHAPTER_ENTRY_MAX_SIZE 256 /* upper bound of one rendered chapter, in any format */
+#define CHAPTER_HEADER_MAX_SIZE 256
+
+#define APPEND_LITERAL(buffer, text) append(buffer, text, sizeof(text) - 1)
+
+
+/*
+ * Private types
+ */
+
+
+typedef struct {
+    char* path;                  /* .mpls file, resolved */
+    char* output;                /* output path without extension, relative to the export directory */
+    bool has_disc;               /* output is "DISC/NNNNN" rather than "NNNNN" */
+    playlist_t playlist;
+} export_entry_t;
+
+typedef struct {
+    export_entry_t* entries;
+    size_t count;
+    size_t capacity;
+    int fields;
+} export_list_t;
+
+
+/*
+ * Private functions
+ */
+
+
+static void
+reserve(chapter_buffer_t* buffer, size_t size)
+{
+    if (buffer->size + size <= buffer->capacity)
+        return;
+
+    while (buffer->capacity < buffer->size + size)
+        buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+    buffer->data = (char*) realloc(buffer->data, buffer->capacity);
+    if (buffer->data == NULL)
+    {
+        DIE("Out of memory.");
+    }
+}
+
+static void
+append(chapter_buffer_t* buffer, const char* text, size_t len)
+{
+    reserve(buffer, len);
+    memcpy(buffer->data + buffer->size, text, len);
+    buffer->size += len;
+}
+
+static void
+append_ticks(chapter_buffer_t* buffer, int64_t ticks, int decimals)
+{
+    reserve(buffer, 32);
+    buffer->size += format_ticks_to(ticks, decimals, buffer->data + buffer->size);
+}
+
+static void
+append_int(chapter_buffer_t* buffer, int64_t value, int width)
+{
+    reserve(buffer, 24);
+    buffer->size += sprintf(buffer->data + buffer->size, "%0*lli", width, (long long) value);
+}
+
+/**
+ * @return Start of chapter i in ticks; chapters before the start of the playlist are moved to it.
+ */
+static int64_t
+chapter_ticks(const playlist_t* playlist, size_t i)
+{
+    int64_t ticks = sec_to_timecode(playlist->chapters[i]);
+    return ticks > 0 ? ticks : 0;
+}
+
+static void
+render_matroska(chapter_buffer_t* buffer, const playlist_t* playlist, int width)
+{
+    size_t i;
+
+    APPEND_LITERAL(buffer, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                           "<!DOCTYPE Chapters SYSTEM \"matroskachapters.dtd\">\n"
+                           "<Chapters>\n"
+                           "  <EditionEntry>\n");
+    for (i = 0; i < playlist->chapter_count; i++)
+    {
+        APPEND_LITERAL(buffer, "    <ChapterAtom>\n"
+                               "      <ChapterTimeStart>");
+        append_ticks(buffer, chapter_ticks(playlist, i), 9);
+        APPEND_LITERAL(buffer, "</ChapterTimeStart>\n"
+                               "      <ChapterDisplay>\n"
+                               "        <ChapterString>Chapter ");
+        append_int(buffer, i + 1, width);
+        APPEND_LITERAL(buffer, "</ChapterString>\n"
+                               "      </ChapterDisplay>\n"
+                               "    </ChapterAtom>\n");
+    }
+    APPEND_LITERAL(buffer, "  </EditionEntry>\n"
+                           "</Chapters>\n");
+}
+
+static void
+render_ogm(chapter_buffer_t* buffer, const playlist_t* playlist, int width)
+{
+    size_t i;
+
+    for (i = 0; i < playlist->chapter_count; i++)
+    {
+        APPEND_LITERAL(buffer, "CHAPTER");
+        append_int(buffer, i + 1, width);
+        APPEND_LITERAL(buffer, "=");
+        append_ticks(buffer, chapter_ticks(playlist, i), 3);
+        APPEND_LITERAL(buffer, "\nCHAPTER");
+        append_int(buffer, i + 1, width);
+        APPEND_LITERAL(buffer, "NAME=Chapter ");
+        append_int(buffer, i + 1, width);
+        APPEND_LITERAL(buffer, "\n");
+    }
+}
+
+static void
+render_ffmetadata(chapter_buffer_t* buffer, const playlist_t* playlist, int width)
+{
+    int64_t duration = sec_to_timecode(playlist->duration_sec);
+    size_t i;
+
+    APPEND_LITERAL(buffer, ";FFMETADATA1\n");
+    for (i = 0; i < playlist->chapter_count; i++)
+    {
+        int64_t start = chapter_ticks(playlist, i);
+        int64_t end = i + 1 < playlist->chapter_count ? chapter_ticks(playlist, i + 1) : duration;
+
+        APPEND_LITERAL(buffer, "\n[CHAPTER]\n"
+                               "TIMEBASE=1/45000\n"
+                               "START=");
+        append_int(buffer, start, 0);
+        APPEND_LITERAL(buffer, "\nEND=");
+        append_int(buffer, end > start ? end : start, 0);
+        APPEND_LITERAL(buffer, "\ntitle=Chapter ");
+        append_int(buffer, i + 1, width);
+        APPEND_LITERAL(buffer, "\n");
+    }
+}
+
+/**
+ * Writes the whole buffer with as few write() calls as the kernel allows.
+ * @return false on error (errno is set).
+ */
+static bool
+write_file(const char* path, const chapter_buffer_t* buffer)
+{
+    size_t written = 0;
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+        return false;
+
+    while (written < buffer->size)
+    {
+        ssize_t n = write(fd, buffer->data + written, buffer->size - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            int error = errno;
+            close(fd);
+            errno = error;
+            return false;
+        }
+        written += n;
+    }
+    return close(fd) == 0;
+}
+
+static int
+compare_entry_outputs(const void* a, const void* b)
+{
+    return strcmp((*(const export_entry_t* const*) a)->output, (*(const export_entry_t* const*) b)->output);
+}
+
+/**
+ * @param path resolved path of a playlist
+ * @return Length of the name of the disc directory in ".../DISC/BDMV/PLAYLIST/00000.mpls",
+ *         or 0 for a playlist outside a disc; *name receives its start.
+ */
+static size_t
+find_disc_name(const char* path, const char** name)
+{
+    size_t bdmv_len = disc_bdmv_length(path);
+    const char* bdmv;
+    const char* start;
+
+    if (bdmv_len < 6 || strncasecmp(path + bdmv_len - 5, "/BDMV", 5) != 0)
+        return 0;
+
+    bdmv = path + bdmv_len - 5;
+    start = bdmv;
+    while (start > path && *(start - 1) != '/')
+        start--;
+    *name = start;
+    return bdmv - start;
+}
+
+/**
+ * Parses a playlist into a new entry; invalid ones are reported on stderr and skipped.
+ * @return false if the playlist could not be read.
+ */
+static bool
+add_entry(const char* path, void* arg)
+{
+    export_list_t* list = (export_list_t*) arg;
+    mpls_file_t mpls_file = create_mpls_file_t();
+    export_entry_t* entry;
+    const char* disc = NULL;
+    size_t disc_len;
+    char output[PATH_MAX];
+    char error[256];
+
+    if (!load_mpls(&mpls_file, (char*) path, error, sizeof(error)) ||
+        !check_mpls(&mpls_file, error, sizeof(error)))
+    {
+        fprintf(stderr, "%s\n", error);
+        free_mpls_file_members(&mpls_file);
+        return false;
+    }
+
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity ? list->capacity * 2 : 64;
+        list->entries = (export_entry_t*) realloc(list->entries, list->capacity * sizeof(export_entry_t));
+        if (list->entries == NULL)
+        {
+            DIE("Out of memory.");
+        }
+    }
+
+    // Every disc uses the same playlist numbers, so each disc gets a directory of its own
+    disc_len = find_disc_name(mpls_file.path, &disc);
+    if (disc_len > 0)
+        snprintf(output, sizeof(output), "%.*s/%.5s", (int) disc_len, disc, mpls_file.name);
+    else
+        snprintf(output, sizeof(output), "%.5s", mpls_file.name);
+
+    entry = &list->entries[list->count++];
+    entry->path = strdup(mpls_file.path);
+    entry->output = strdup(output);
+    entry->has_disc = disc_len > 0;
+    entry->playlist = create_playlist_t();
+    parse_playlist(&mpls_file, &entry->playlist, list->fields);
+
+    free_mpls_file_members(&mpls_file);
+    return true;
+}
+
+/**
+ * Creates the disc directory of an entry inside the export directory.
+ * @return false on error (reported on stderr).
+ */
+static bool
+make_disc_dir(const char* dir, const export_entry_t* entry)
+{
+    char path[PATH_MAX];
+
+    if (!entry->has_disc)
+        return true;
+
+    snprintf(path, sizeof(path), "%s/%.*s", dir, (int) (strrchr(entry->output, '/') - entry->output), entry->output);
+    if (mkdir(path, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Unable to create \"%s\": %s\n", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+
+/*
+ * Functions
+ */
+
+
+int
+chapter_parse_formats(const char* list)
+{
+    static const struct {
+        const char* name;
+        int format;
+    } format_names[] = {
+        { "matroska",   CHAPTER_FORMAT_MATROSKA   },
+        { "ogm",        CHAPTER_FORMAT_OGM        },
+        { "ffmetadata", CHAPTER_FORMAT_FFMETADATA },
+        { "all",        CHAPTER_FORMAT_MATROSKA | CHAPTER_FORMAT_OGM | CHAPTER_FORMAT_FFMETADATA }
+    };
+
+    int formats = 0;
+    const char* p = list;
+
+    while (*p != '\0')
+    {
+        size_t len = strcspn(p, ",");
+        size_t i;
+
+        for (i = 0; i < ARRAY_SIZE(format_names); i++)
+        {
+            if (strlen(format_names[i].name) == len && strncmp(p, format_names[i].name, len) == 0)
+                break;
+        }
+        if (i == ARRAY_SIZE(format_names))
+            return -1;
+
+        formats |= format_names[i].format;
+        p += len;
+        if (*p == ',')
+            p++;
+    }
+
+    return formats;
+}
+
+void
+chapter_render(chapter_buffer_t* buffer, const playlist_t* playlist, int format)
+{
+    // Chapter numbers are zero-padded to the width of the largest one, at least 2
+    int width = playlist->chapter_count >= 100 ? (playlist->chapter_count >= 1000 ? 4 : 3) : 2;
+
+    // Sized up front, so rendering does not reallocate
+    buffer->size = 0;
+    reserve(buffer, CHAPTER_HEADER_MAX_SIZE + playlist->chapter_count * CHAPTER_ENTRY_MAX_SIZE);
+
+    if (format == CHAPTER_FORMAT_MATROSKA)
+        render_matroska(buffer, playlist, width);
+    else if (format == CHAPTER_FORMAT_OGM)
+        render_ogm(buffer, playlist, width);
+    else if (format == CHAPTER_FORMAT_FFMETADATA)
+        render_ffmetadata(buffer, playlist, width);
+}
+
+bool
+chapter_export_run(char** paths, int path_count, int formats, const char* dir, const char* query)
+{
+    static const struct {
+        int format;
+        const char* extension;
+    } extensions[] = {
+        { CHAPTER_FORMAT_MATROSKA,   "xml"        },
+        { CHAPTER_FORMAT_OGM,        "ogm.txt"    },
+        { CHAPTER_FORMAT_FFMETADATA, "ffmetadata" }
+    };
+
+    export_list_t list = { NULL, 0, 0, query != NULL ? FIELD_ALL : CHAPTER_EXPORT_FIELDS };
+    export_entry_t* entries;
+    export_entry_t** selected;
+    size_t entry_count;
+    size_t selected_count = 0;
+    uint8_t* selection = NULL;
+    chapter_buffer_t buffer = { NULL, 0, 0 };
+    catalog_query_t catalog_query;
+    bool ok = true;
+    size_t kept;
+    size_t i;
+    size_t f;
+    int p;
+
+    if (query != NULL && !catalog_parse_query(query, &catalog_query))
+    {
+        DIE("Invalid query: \"%s\".", query);
+    }
+
+    // A corrupt disc is reported and skipped, so it does not end the batch
+    for (p = 0; p < path_count; p++)
+        ok = disc_for_each_playlist(paths[p], add_entry, &list) && ok;
+    entries = list.entries;
+    entry_count = list.count;
+
+    // With --query, the catalog rows line up with the entries
+    selection = (uint8_t*) malloc(entry_count ? entry_count : 1);
+    memset(selection, 1, entry_count ? entry_count : 1);
+    if (query != NULL)
+    {
+        catalog_t catalog;
+
+        init_catalog_t(&catalog);
+        for (i = 0; i < entry_count; i++)
+            catalog_add_playlist(&catalog, entries[i].path, &entries[i].playlist);
+        catalog_run_query(&catalog, &catalog_query, selection);
+        free_catalog_members(&catalog);
+    }
+
+    selected = (export_entry_t**) calloc(entry_count ? entry_count : 1, sizeof(export_entry_t*));
+    for (i = 0; i < entry_count; i++)
+    {
+        if (selection[i] && entries[i].playlist.chapter_count > 0)
+            selected[selected_count++] = &entries[i];
+    }
+
+    // A playlist given twice is exported once; two playlists that map to the
+    // same files (discs in equally named directories) keep the first
+    qsort(selected, selected_count, sizeof(export_entry_t*), compare_entry_outputs);
+    for (i = 0, kept = 0; i < selected_count; i++)
+    {
+        export_entry_t* previous = kept > 0 ? selected[kept - 1] : NULL;
+
+        if (previous != NULL && strcmp(previous->output, selected[i]->output) == 0)
+        {
+            if (strcmp(previous->path, selected[i]->path) != 0)
+            {
+                fprintf(stderr, "\"%s\" would overwrite the chapters of \"%s\"; skipped.\n",
+                        selected[i]->path, previous->path);
+                ok = false;
+            }
+            continue;
+        }
+        selected[kept++] = selected[i];
+    }
+    selected_count = kept;
+
+    for (i = 0; i < selected_count; i++)
+    {
+        if (!make_disc_dir(dir, selected[i]))
+        {
+            ok = false;
+            continue;
+        }
+
+        for (f = 0; f < ARRAY_SIZE(extensions); f++)
+        {
+            char path[PATH_MAX];
+
+            if (!(formats & extensions[f].format))
+                continue;
+
+            STATS_BEGIN(format_mark);
+            chapter_render(&buffer, &selected[i]->playlist, extensions[f].format);
+            STATS_END(format_mark, STATS_PHASE_FORMAT);
+
+            snprintf(path, sizeof(path), "%s/%s.%s", dir, selected[i]->output, extensions[f].extension);
+
+            STATS_BEGIN(output_mark);
+            if (write_file(path, &buffer))
+                printf("%s\n", path);
+            else
+            {
+                fprintf(stderr, "Unable to write \"%s\": %s\n", path, strerror(errno));
+                ok = false;
+            }
+            STATS_END(output_mark, STATS_PHASE_OUTPUT);
+        }
+    }
+    fflush(stdout);
+
+    for (i = 0; i < entry_count; i++)
+    {
+        free(entries[i].path);
+        free(entries[i].output);
+        free_playlist_members(&entries[i].playlist);
+    }
+    free(entries);
+    free(selected);
+    free(selection);
+    free(buffer.data);
+    return ok;
+}
@@ -0,0 +1,101 @@
+/*
+ * File:   chapter_export.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Chapter export (--export-chapters): writes the chapters of every selected
+ * playlist as files for muxers, in one run over any number of discs.
+ *
+ *  - Matroska XML (mkvmerge --chapters): "NNNNN.xml", nanosecond times;
+ *  - OGM (mkvmerge, many players): "NNNNN.ogm.txt", millisecond times;
+ *  - FFmetadata (ffmpeg -i FILE -map_metadata 1): "NNNNN.ffmetadata",
+ *    START/END in 45 kHz ticks (TIMEBASE=1/45000), so times are exact.
+ *
+ * The files of a playlist on a disc go to a subdirectory named after the disc
+ * ("DISC/00800.xml" for ".../DISC/BDMV/PLAYLIST/00800.mpls"), so discs in one
+ * run do not overwrite each other; loose playlists go to the directory itself.
+ *
+ * Times are formatted from integer ticks (format_ticks_to()).  Each file is
+ * rendered into one buffer, reused across files, and written with a single
+ * write().  Playlists without chapters are skipped; unreadable playlists are
+ * reported and skipped, so one bad disc does not end the batch.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef CHAPTER_EXPORT_H
+#define	CHAPTER_EXPORT_H
+
+#include "parse_mpls.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+#define CHAPTER_FORMAT_MATROSKA   0x1
+#define CHAPTER_FORMAT_OGM        0x2
+#define CHAPTER_FORMAT_FFMETADATA 0x4
+
+#define CHAPTER_EXPORT_FIELDS     (FIELD_DURATION | FIELD_CHAPTERS)
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} chapter_buffer_t;
+
+
+/*
+ * Functions
+ */
+
+
+/**
+ * Parses a comma-separated --export-chapters list (e.g., "matroska,ffmetadata").
+ * @param list
+ * @return CHAPTER_FORMAT_* flags, or -1 if the list contains an unknown format.
+ */
+int
+chapter_parse_formats(const char* list);
+
+/**
+ * Renders the chapters of a playlist in one format, replacing the contents
+ * of the buffer.
+ * @param buffer
+ * @param playlist parsed with at least CHAPTER_EXPORT_FIELDS
+ * @param format one CHAPTER_FORMAT_* flag
+ */
+void
+chapter_render(chapter_buffer_t* buffer, const playlist_t* playlist, int format);
+
+/**
+ * Writes the chapter files of every playlist of the given discs (or of the
+ * given playlists) to a directory and prints the path of each file written.
+ * @param paths
+ * @param path_count
+ * @param formats CHAPTER_FORMAT_* flags
+ * @param dir output directory
+ * @param query if not NULL, only playlists matching this --query expression are exported
+ * @return false if a playlist could not be read or a file could not be written.
+ */
+bool
+chapter_export_run(char** paths, int path_count, int formats, const char* dir, const char* query);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CHAPTER_EXPORT_H */
@@ -0,0 +1,146 @@
+/*
+ * File:   clpi.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "clpi.h"
+
+
+/*
+ * Constants
+ */
+
+
+/**
+ * Writes a formatted message to the `error` buffer and returns false.
+ * Expects `char* error` and `size_t error_size` to be in scope.
+ */
+#define FAIL(...) do { snprintf(error, error_size, __VA_ARGS__); return false; } while (0)
+
+
+/*
+ * Private functions
+ */
+
+
+/**
+ * Reads the STC sequences of every ATC sequence from the SequenceInfo block.
+ */
+static bool
+read_sequence_info(FILE* file, const char* path, int32_t pos, clpi_info_t* info, char* error, size_t error_size)
+{
+    char length_bytes[4];
+    char* data;
+    int32_t length;
+    int cursor = 0;
+    int atc_count;
+    int a;
+
+    if (fseek(file, pos, SEEK_SET) != 0 || fread(length_bytes, 1, 4, file) != 4)
+    {
+        FAIL("Invalid SequenceInfo offset in \"%s\": %i.", path, pos);
+    }
+    length = get_int32(length_bytes);
+    if (length < 2 || length > 65536)
+    {
+        FAIL("Invalid SequenceInfo length in \"%s\": %i.", path, length);
+    }
+
+    data = (char*) malloc(length);
+    if (data == NULL)
+    {
+        DIE("Out of memory.");
+    }
+    if (fread(data, 1, length, file) != (size_t) length)
+    {
+        free(data);
+        FAIL("Truncated SequenceInfo in \"%s\".", path);
+    }
+
+    // reserved (1), number_of_ATC_sequences (1)
+    atc_count = (uint8_t) data[1];
+    cursor = 2;
+    for (a = 0; a < atc_count && cursor + 6 <= length; a++)
+    {
+        // SPN_ATC_start (4), number_of_STC_sequences (1), offset_STC_id (1)
+        int stc_count = (uint8_t) data[cursor + 4];
+        int s;
+
+        cursor += 6;
+        for (s = 0; s < stc_count && cursor + 14 <= length; s++, cursor += 14)
+        {
+            clpi_stc_sequence_t* sequence;
+
+            if (info->stc_sequence_count == CLPI_MAX_STC_SEQUENCES)
+                break;
+            sequence = &info->stc_sequences[info->stc_sequence_count++];
+            sequence->pcr_pid = (uint16_t) get_int16(data + cursor);
+            sequence->spn_start = (uint32_t) get_int32(data + cursor + 2);
+            sequence->presentation_start = (uint32_t) get_int32(data + cursor + 6);
+            sequence->presentation_end = (uint32_t) get_int32(data + cursor + 10);
+        }
+    }
+
+    free(data);
+    return true;
+}
+
+
+/*
+ * Functions
+ */
+
+
+bool
+clpi_read_file(FILE* file, const char* path, clpi_info_t* info, char* error, size_t error_size)
+{
+    char data[CLPI_CLIP_INFO_POS + CLPI_CLIP_INFO_SIZE];
+    char* clip_info = data + CLPI_CLIP_INFO_POS;
+    int32_t sequence_info_pos;
+
+    memset(info, 0, sizeof(*info));
+
+    if (fread(data, 1, sizeof(data), file) < sizeof(data))
+    {
+        FAIL("Invalid clip info file (too small): \"%s\".", path);
+    }
+
+    memcpy(info->header, data, 8);
+    info->header[8] = '\0';
+    if (strncmp(info->header, "HDMV0", 5) != 0 || info->header[6] != '0' || info->header[7] != '0')
+    {
+        FAIL("Invalid header in \"%s\": expected HDMV0100, HDMV0200 or HDMV0300, found \"%s\".", path, info->header);
+    }
+
+    info->clip_stream_type = (uint8_t) clip_info[6];
+    info->application_type = (uint8_t) clip_info[7];
+    info->ts_recording_rate = (uint32_t) get_int32(clip_info + 12);
+    info->source_packet_count = (uint32_t) get_int32(clip_info + 16);
+
+    // The section offsets start at byte 8; SequenceInfo comes after ClipInfo
+    sequence_info_pos = get_int32(data + 8);
+    if (sequence_info_pos < (int32_t) sizeof(data))
+    {
+        FAIL("Invalid SequenceInfo offset in \"%s\": %i.", path, sequence_info_pos);
+    }
+    return read_sequence_info(file, path, sequence_info_pos, info, error, error_size);
+}
+
+bool
+clpi_read(const char* path, clpi_info_t* info, char* error, size_t error_size)
+{
+    FILE* file = fopen(path, "rb");
+    bool ok;
+
+    if (file == NULL)
+    {
+        memset(info, 0, sizeof(*info));
+        FAIL("Unable to open \"%s\" for reading.", path);
+    }
+    ok = clpi_read_file(file, path, info, error, error_size);
+    fclose(file);
+    return ok;
+}
@@ -0,0 +1,92 @@
+/*
+ * File:   clpi.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Minimal reader for clip information files (BDMV/CLIPINF/NNNNN.clpi): the
+ * ClipInfo block, which describes the stream file as a whole, and the
+ * SequenceInfo block, which lists its STC sequences (runs of packets with a
+ * continuous program clock).
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef CLPI_H
+#define	CLPI_H
+
+#include "parse_mpls.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+#define CLPI_CLIP_INFO_POS 40  /* ClipInfo follows the header and its 5 section offsets */
+#define CLPI_CLIP_INFO_SIZE 20 /* length (4), reserved (2), stream type (1), application type (1),
+                                  flags (4), TS_recording_rate (4), number_of_source_packets (4) */
+#define CLPI_MAX_STC_SEQUENCES 64
+
+#define CLPI_APPLICATION_MAIN_MOVIE 1 /* application_type of a movie clip (2-7: slideshows, menus, sub-paths) */
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    uint32_t spn_start;          /* first source packet of the sequence */
+    uint16_t pcr_pid;
+    uint32_t presentation_start; /* 45 kHz, on the sequence's clock */
+    uint32_t presentation_end;
+} clpi_stc_sequence_t;
+
+typedef struct {
+    char header[9];              /* "HDMV0100", "HDMV0200" or "HDMV0300" */
+    uint8_t clip_stream_type;
+    uint8_t application_type;    /* 1 = main movie, 2 = time-based slideshow, ... */
+    uint32_t ts_recording_rate;  /* bytes per second */
+    uint32_t source_packet_count;/* 192-byte packets in the stream file */
+    clpi_stc_sequence_t stc_sequences[CLPI_MAX_STC_SEQUENCES]; /* of every ATC sequence, in file order */
+    int stc_sequence_count;
+} clpi_info_t;
+
+
+/*
+ * Functions
+ */
+
+
+/**
+ * @param path .clpi file
+ * @param info receives the ClipInfo and SequenceInfo fields
+ * @param error receives a message on failure
+ * @param error_size
+ * @return false if the file cannot be read or is not a clip information file.
+ */
+bool
+clpi_read(const char* path, clpi_info_t* info, char* error, size_t error_size);
+
+/**
+ * Like clpi_read(), from an already open file, e.g., one from fmemopen().
+ * @param file read from its start; not closed
+ * @param path used in error messages
+ * @param info
+ * @param error
+ * @param error_size
+ * @return false if the data is not a clip information file.
+ */
+bool
+clpi_read_file(FILE* file, const char* path, clpi_info_t* info, char* error, size_t error_size);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CLPI_H */
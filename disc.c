@@ -0,0 +1,374 @@
+/*
+ * File:   disc.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "disc.h"
+#include "stats.h"
+
+#include <strings.h>
+
+
+/*
+ * Private types
+ */
+
+
+typedef struct {
+    disc_playlist_t* disc_playlist;
+    stream_clip_t* clip;
+} clip_task_arg_t;
+
+
+/*
+ * Private functions
+ */
+
+
+static int
+is_mpls_entry(const struct dirent* entry)
+{
+    size_t len = strlen(entry->d_name);
+    return len > 5 && strcasecmp(entry->d_name + len - 5, ".mpls") == 0;
+}
+
+static bool
+is_directory(const char* path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+/**
+ * Called once by the playlist task and once by each of its clip tasks; the
+ * last one to finish formats the report.
+ */
+static void
+finish_playlist_ref(disc_playlist_t* disc_playlist)
+{
+    if (atomic_fetch_sub(&disc_playlist->pending, 1) != 1)
+        return;
+
+    if (!disc_playlist->failed)
+    {
+        FILE* out = open_memstream(&disc_playlist->output, &disc_playlist->output_size);
+        format_playlist(out, &disc_playlist->mpls_file, &disc_playlist->playlist);
+        fclose(out);
+    }
+
+    free_playlist_members(&disc_playlist->playlist);
+    free_mpls_file_members(&disc_playlist->mpls_file);
+}
+
+static void
+clip_task(sched_t* sched, void* arg)
+{
+    clip_task_arg_t* task = (clip_task_arg_t*) arg;
+    disc_playlist_t* disc_playlist = task->disc_playlist;
+
+    disc_find_clip_size(disc_playlist->mpls_file.path, task->clip);
+
+    free(task);
+    finish_playlist_ref(disc_playlist);
+}
+
+static void
+playlist_task(sched_t* sched, void* arg)
+{
+    disc_playlist_t* disc_playlist = (disc_playlist_t*) arg;
+    mpls_file_t* mpls_file = &disc_playlist->mpls_file;
+    char* error = disc_playlist->error;
+    size_t error_size = sizeof(disc_playlist->error);
+    stream_clip_t* clip;
+
+    if (!load_mpls(mpls_file, disc_playlist->path, error, error_size) ||
+        !check_mpls(mpls_file, error, error_size))
+    {
+        disc_playlist->failed = true;
+        finish_playlist_ref(disc_playlist);
+        return;
+    }
+
+    parse_playlist(mpls_file, &disc_playlist->playlist, disc_playlist->fields);
+
+    // Per-clip work: look up the clip's stream and clip info files
+    if (disc_playlist->fields & FIELD_CLIPS)
+    {
+        disc_playlist->playlist.fields |= FIELD_FILE_SIZES;
+        for (clip = disc_playlist->playlist.stream_clip_list.first; clip != NULL; clip = clip->next)
+        {
+            clip_task_arg_t* task = (clip_task_arg_t*) calloc(1, sizeof(clip_task_arg_t));
+            task->disc_playlist = disc_playlist;
+            task->clip = clip;
+            atomic_fetch_add(&disc_playlist->pending, 1);
+            sched_spawn(sched, clip_task, task);
+        }
+    }
+
+    finish_playlist_ref(disc_playlist);
+}
+
+static void
+disc_task(sched_t* sched, void* arg)
+{
+    disc_t* disc = (disc_t*) arg;
+    char** paths = NULL;
+    int count;
+    int i;
+
+    if (is_directory(disc->root))
+    {
+        count = disc_list_playlists(disc->root, &paths);
+        if (count <= 0)
+        {
+            snprintf(disc->error, sizeof(disc->error), "No playlists found in \"%s\".", disc->root);
+            disc->failed = true;
+            free(paths);
+            return;
+        }
+    }
+    else
+    {
+        count = 1;
+        paths = (char**) calloc(1, sizeof(char*));
+        paths[0] = strdup(disc->root);
+    }
+
+    disc->playlist_count = count;
+    disc->playlists = (disc_playlist_t*) calloc(count, sizeof(disc_playlist_t));
+
+    for (i = 0; i < count; i++)
+    {
+        disc_playlist_t* disc_playlist = &disc->playlists[i];
+        disc_playlist->path = paths[i];
+        disc_playlist->fields = disc->fields;
+        disc_playlist->mpls_file = create_mpls_file_t();
+        disc_playlist->playlist = create_playlist_t();
+        atomic_init(&disc_playlist->pending, 1);
+        sched_spawn(sched, playlist_task, disc_playlist);
+    }
+
+    free(paths);
+}
+
+
+/*
+ * Functions
+ */
+
+
+int
+disc_list_playlists(const char* root, char*** paths)
+{
+    static const char* candidates[] = { "%s/BDMV/PLAYLIST", "%s/PLAYLIST", "%s" };
+    char dir[PATH_MAX];
+    struct dirent** entries = NULL;
+    int count = -1;
+    size_t c;
+    int i;
+
+    for (c = 0; c < ARRAY_SIZE(candidates); c++)
+    {
+        snprintf(dir, sizeof(dir), candidates[c], root);
+        if (is_directory(dir))
+        {
+            count = scandir(dir, &entries, is_mpls_entry, alphasort);
+            if (count > 0)
+                break;
+            free(entries); entries = NULL;
+        }
+    }
+
+    if (count <= 0)
+    {
+        *paths = NULL;
+        return count;
+    }
+
+    *paths = (char**) calloc(count, sizeof(char*));
+    for (i = 0; i < count; i++)
+    {
+        size_t len = strlen(dir) + strlen(entries[i]->d_name) + 2;
+        (*paths)[i] = (char*) calloc(len, sizeof(char));
+        snprintf((*paths)[i], len, "%s/%s", dir, entries[i]->d_name);
+        free(entries[i]);
+    }
+    free(entries);
+
+    return count;
+}
+
+bool
+disc_for_each_playlist(const char* path, disc_playlist_fn fn, void* ctx)
+{
+    char** paths = NULL;
+    bool ok = true;
+    int count;
+    int i;
+
+    if (!is_directory(path))
+        return fn(path, ctx);
+
+    count = disc_list_playlists(path, &paths);
+    if (count <= 0)
+    {
+        fprintf(stderr, "No playlists found in \"%s\".\n", path);
+        ok = false;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ok = fn(paths[i], ctx) && ok;
+        free(paths[i]);
+    }
+    free(paths);
+    return ok;
+}
+
+size_t
+disc_bdmv_length(const char* path)
+{
+    const char* file = strrchr(path, '/');
+    const char* dir = file;
+
+    while (dir > path && *(dir - 1) != '/')
+        dir--;
+    return dir > path ? (size_t) (dir - 1 - path) : 0;
+}
+
+bool
+disc_is_disc_file(const char* path, const char* dir, const char* ext)
+{
+    size_t len = strlen(path);
+    size_t ext_len = strlen(ext);
+    size_t dir_len = strlen(dir);
+    const char* file = strrchr(path, '/');
+    const char* component = path;
+    const char* parent = NULL;
+
+    if (file == NULL || len <= ext_len || strcasecmp(path + len - ext_len, ext) != 0)
+        return false;
+
+    // The parent directory is the last component before the file name
+    while (component < file)
+    {
+        size_t component_len = strcspn(component, "/");
+        if (component_len == 6 && strncasecmp(component, "BACKUP", 6) == 0)
+            return false;
+        parent = component;
+        component += component_len + 1;
+    }
+    return parent != NULL && (size_t) (file - parent) == dir_len && strncasecmp(parent, dir, dir_len) == 0;
+}
+
+bool
+disc_find_clip_file(const char* playlist_path, const char* clip_filename, const char* dir, const char* ext,
+                    char* dest, size_t dest_size, struct stat* st)
+{
+    // BDMV/PLAYLIST/00000.mpls -> BDMV
+    size_t bdmv_len = disc_bdmv_length(playlist_path);
+    char upper_ext[16];
+    struct stat tmp;
+    size_t i;
+    int up;
+
+    if (bdmv_len == 0)
+        return false;
+
+    for (i = 0; ext[i] != '\0' && i < sizeof(upper_ext) - 1; i++)
+        upper_ext[i] = toupper((unsigned char) ext[i]);
+    upper_ext[i] = '\0';
+
+    if (st == NULL)
+        st = &tmp;
+
+    for (up = 0; up < 2; up++)
+    {
+        snprintf(dest, dest_size, "%.*s/%s/%.5s.%s", (int) bdmv_len, playlist_path, dir, clip_filename,
+                 up ? upper_ext : ext);
+        if (stat(dest, st) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+void
+disc_find_clip_size(const char* playlist_path, stream_clip_t* clip)
+{
+    char path[PATH_MAX];
+    struct stat st;
+
+    if (disc_find_clip_file(playlist_path, clip->filename, "STREAM", "m2ts", path, sizeof(path), &st))
+        clip->stream_file_size = st.st_size;
+    if (disc_find_clip_file(playlist_path, clip->filename, "CLIPINF", "clpi", path, sizeof(path), &st))
+        clip->clip_info_size = st.st_size;
+}
+
+void
+disc_find_clip_sizes(const char* playlist_path, playlist_t* playlist)
+{
+    stream_clip_t* clip;
+
+    if (!(playlist->fields & FIELD_CLIPS))
+        return;
+
+    playlist->fields |= FIELD_FILE_SIZES;
+    for (clip = playlist->stream_clip_list.first; clip != NULL; clip = clip->next)
+        disc_find_clip_size(playlist_path, clip);
+}
+
+void
+disc_run(char** paths, int path_count, int fields, int jobs)
+{
+    sched_t sched;
+    disc_t* discs = (disc_t*) calloc(path_count, sizeof(disc_t));
+    int i;
+    size_t p;
+
+    init_sched_t(&sched, jobs);
+
+    for (i = 0; i < path_count; i++)
+    {
+        discs[i].root = paths[i];
+        discs[i].fields = fields;
+        sched_spawn(&sched, disc_task, &discs[i]);
+    }
+
+    sched_run(&sched);
+
+    for (i = 0; i < path_count; i++)
+    {
+        disc_t* disc = &discs[i];
+
+        if (disc->failed)
+        {
+            fflush(stdout);
+            DIE("%s", disc->error);
+        }
+
+        for (p = 0; p < disc->playlist_count; p++)
+        {
+            disc_playlist_t* disc_playlist = &disc->playlists[p];
+
+            if (disc_playlist->failed)
+            {
+                fflush(stdout);
+                DIE("%s", disc_playlist->error);
+            }
+
+            STATS_BEGIN(output);
+            fwrite(disc_playlist->output, 1, disc_playlist->output_size, stdout);
+            STATS_END(output, STATS_PHASE_OUTPUT);
+            free(disc_playlist->output);
+            free(disc_playlist->path);
+        }
+
+        free(disc->playlists);
+    }
+
+    free(discs);
+    free_sched_members(&sched);
+}
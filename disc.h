@@ -0,0 +1,157 @@
+/*
+ * File:   disc.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Whole-disc parsing.  A disc root (the directory containing BDMV, or BDMV
+ * itself) is expanded into all of its playlists, and each playlist into
+ * per-clip tasks, all scheduled on the work-stealing scheduler.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef DISC_H
+#define	DISC_H
+
+#include "parse_mpls.h"
+#include "scheduler.h"
+
+#include <dirent.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    char* path;
+    int fields;
+    mpls_file_t mpls_file;
+    playlist_t playlist;
+    atomic_int pending;          /* clip tasks still running, +1 for the playlist task itself */
+    char* output;                /* formatted report */
+    size_t output_size;
+    bool failed;
+    char error[256];
+} disc_playlist_t;
+
+/* Called for each playlist by disc_for_each_playlist(); returns false if the playlist failed */
+typedef bool (*disc_playlist_fn)(const char* path, void* ctx);
+
+typedef struct {
+    char* root;                  /* as given on the command line */
+    int fields;
+    disc_playlist_t* playlists;  /* sorted by file name */
+    size_t playlist_count;
+    bool failed;
+    char error[256];
+} disc_t;
+
+
+/*
+ * Functions
+ */
+
+
+/**
+ * Lists the .mpls files of a disc, sorted by name.
+ * @param root disc root, its BDMV directory, or a PLAYLIST directory
+ * @param paths receives a malloc'd array of malloc'd paths
+ * @return Number of playlists found, or -1 if no PLAYLIST directory exists.
+ */
+int
+disc_list_playlists(const char* root, char*** paths);
+
+/**
+ * Calls fn for every playlist of a disc, in name order, or once for a path
+ * that is not a directory (a single playlist).  A disc without playlists is
+ * reported on stderr.
+ * @param path disc root (see disc_list_playlists()) or .mpls file
+ * @param fn
+ * @param ctx passed to fn
+ * @return false if the disc has no playlists or fn failed for any of them.
+ */
+bool
+disc_for_each_playlist(const char* path, disc_playlist_fn fn, void* ctx);
+
+/**
+ * @param path file inside a BDMV subdirectory, e.g., ".../BDMV/PLAYLIST/00000.mpls"
+ *        or ".../BDMV/CLIPINF/00800.clpi"
+ * @return Length of its BDMV directory prefix (".../BDMV"), or 0 if the path
+ *         has no parent directory.
+ */
+size_t
+disc_bdmv_length(const char* path);
+
+/**
+ * Matches files by their parent directory and extension (case-insensitive);
+ * copies in a BACKUP directory (BDMV/BACKUP/PLAYLIST/...) never match.
+ * @param path e.g., ".../BDMV/PLAYLIST/00000.mpls"
+ * @param dir parent directory name, e.g., "PLAYLIST"
+ * @param ext extension with the dot, e.g., ".mpls"
+ * @return false if the path has no parent directory.
+ */
+bool
+disc_is_disc_file(const char* path, const char* dir, const char* ext);
+
+/**
+ * Locates a file that belongs to a stream clip, next to the playlist that
+ * references it (e.g., BDMV/STREAM/00800.m2ts for BDMV/PLAYLIST/00000.mpls).
+ * Both lowercase and uppercase extensions are tried.
+ * @param playlist_path path of the .mpls file (e.g., BDMV/PLAYLIST/00000.mpls)
+ * @param clip_filename e.g., "00800.M2TS"
+ * @param dir "STREAM" or "CLIPINF"
+ * @param ext extension without the dot, e.g., "m2ts" or "clpi"
+ * @param dest receives the path
+ * @param dest_size
+ * @param st if not NULL, receives the stat() result
+ * @return false if the file does not exist.
+ */
+bool
+disc_find_clip_file(const char* playlist_path, const char* clip_filename, const char* dir, const char* ext,
+                    char* dest, size_t dest_size, struct stat* st);
+
+/**
+ * Looks up the stream and clip info file sizes of one clip (see
+ * disc_find_clip_file()); sizes of missing files are left unchanged.
+ * @param playlist_path path of the .mpls file
+ * @param clip
+ */
+void
+disc_find_clip_size(const char* playlist_path, stream_clip_t* clip);
+
+/**
+ * Looks up the stream and clip info file sizes of every clip of a parsed
+ * playlist (see disc_find_clip_file()).  Does nothing unless the playlist
+ * was parsed with FIELD_CLIPS; sets FIELD_FILE_SIZES otherwise.
+ * @param playlist_path path of the .mpls file
+ * @param playlist
+ */
+void
+disc_find_clip_sizes(const char* playlist_path, playlist_t* playlist);
+
+/**
+ * Parses and prints every playlist of every given disc, in order.  Paths
+ * that are regular files are treated as single playlists.  Like parse_mpls(),
+ * exits via DIE() at the first invalid playlist, after printing all earlier ones.
+ * @param paths
+ * @param path_count
+ * @param fields FIELD_* flags
+ * @param jobs number of worker threads
+ */
+void
+disc_run(char** paths, int path_count, int fields, int jobs);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DISC_H */
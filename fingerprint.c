@@ -0,0 +1,269 @@
+/*
+ * File:   fingerprint.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "fingerprint.h"
+#include "disc.h"
+#include "xxh64.h"
+
+
+/*
+ * Constants
+ */
+
+
+/* Seeds that keep the three kinds of set elements apart */
+#define ELEMENT_PLAYLIST  1
+#define ELEMENT_PLAY_ITEM 2
+#define ELEMENT_CLIP_INFO 3
+
+
+/*
+ * Private functions
+ */
+
+
+/* Values are hashed as 8 little-endian bytes, so hashes match across hosts */
+static void
+update_int(xxh64_state_t* state, int64_t value)
+{
+    uint8_t le[8];
+    int b;
+
+    for (b = 0; b < 8; b++)
+        le[b] = (uint8_t) ((uint64_t) value >> (8 * b));
+    xxh64_update(state, le, sizeof(le));
+}
+
+/* splitmix64 finalizer over the element and the slot: one cheap hash function per slot */
+static inline uint32_t
+slot_hash(uint64_t element, int slot)
+{
+    uint64_t z = element + (uint64_t) (slot + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (uint32_t) ((z ^ (z >> 31)) >> 32);
+}
+
+static void
+add_element(fingerprint_t* fingerprint, uint64_t element)
+{
+    int i;
+
+    for (i = 0; i < FINGERPRINT_MINHASH_SIZE; i++)
+    {
+        uint32_t h = slot_hash(element, i);
+        if (h < fingerprint->minhash[i])
+            fingerprint->minhash[i] = h;
+    }
+}
+
+static int
+compare_hashes(const void* a, const void* b)
+{
+    const uint64_t x = *(const uint64_t*) a;
+    const uint64_t y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+static void
+print_fingerprint(const fingerprint_t* fingerprint, const char* path)
+{
+    int i;
+
+    printf("%016llx ", (unsigned long long) fingerprint->hash);
+    for (i = 0; i < FINGERPRINT_MINHASH_SIZE; i++)
+        printf("%08x", fingerprint->minhash[i]);
+    printf("  %s\n", path);
+}
+
+static bool
+add_playlist(const char* path, void* fingerprint)
+{
+    mpls_file_t mpls_file = create_mpls_file_t();
+    playlist_t playlist = create_playlist_t();
+    char error[256];
+    bool ok = true;
+
+    if (load_mpls(&mpls_file, (char*) path, error, sizeof(error)) &&
+        check_mpls(&mpls_file, error, sizeof(error)))
+    {
+        parse_playlist(&mpls_file, &playlist, FINGERPRINT_FIELDS);
+        disc_find_clip_sizes(path, &playlist);
+        fingerprint_add_playlist((fingerprint_t*) fingerprint, &playlist);
+    }
+    else
+    {
+        fprintf(stderr, "%s\n", error);
+        ok = false;
+    }
+
+    free_playlist_members(&playlist);
+    free_mpls_file_members(&mpls_file);
+    return ok;
+}
+
+
+/*
+ * Functions
+ */
+
+
+void
+init_fingerprint_t(fingerprint_t* fingerprint)
+{
+    memset(fingerprint, 0, sizeof(*fingerprint));
+    memset(fingerprint->minhash, 0xFF, sizeof(fingerprint->minhash));
+}
+
+void
+free_fingerprint_members(fingerprint_t* fingerprint)
+{
+    free(fingerprint->playlist_hashes);
+    fingerprint->playlist_hashes = NULL;
+    fingerprint->playlist_count = fingerprint->playlist_capacity = 0;
+}
+
+void
+fingerprint_add_playlist(fingerprint_t* fingerprint, const playlist_t* playlist)
+{
+    xxh64_state_t state;
+    stream_clip_t* clip;
+    size_t i;
+
+    init_xxh64_state_t(&state, ELEMENT_PLAYLIST);
+    update_int(&state, playlist->stream_clip_list.count);
+
+    for (clip = playlist->stream_clip_list.first; clip != NULL; clip = clip->next)
+    {
+        xxh64_state_t item;
+        uint64_t item_hash;
+
+        // Seconds were converted from ticks, so the round trip is exact
+        init_xxh64_state_t(&item, ELEMENT_PLAY_ITEM);
+        xxh64_update(&item, clip->filename, 10);
+        update_int(&item, sec_to_timecode(clip->time_in_sec));
+        update_int(&item, sec_to_timecode(clip->time_out_sec));
+        update_int(&item, clip->video_count);
+        update_int(&item, clip->audio_count);
+        update_int(&item, clip->subtitle_count);
+        update_int(&item, clip->interactive_menu_count);
+        update_int(&item, clip->secondary_video_count);
+        update_int(&item, clip->secondary_audio_count);
+        update_int(&item, clip->pip_count);
+        item_hash = xxh64_digest(&item);
+        add_element(fingerprint, item_hash);
+
+        update_int(&state, item_hash);
+        update_int(&state, clip->clip_info_size);
+
+        if (clip->clip_info_size > 0)
+        {
+            xxh64_state_t info;
+
+            init_xxh64_state_t(&info, ELEMENT_CLIP_INFO);
+            xxh64_update(&info, clip->filename, 5);
+            update_int(&info, clip->clip_info_size);
+            add_element(fingerprint, xxh64_digest(&info));
+        }
+    }
+
+    update_int(&state, playlist->chapter_count);
+    for (i = 0; i < playlist->chapter_count; i++)
+        update_int(&state, sec_to_timecode(playlist->chapters[i]));
+
+    if (fingerprint->playlist_count == fingerprint->playlist_capacity)
+    {
+        fingerprint->playlist_capacity = fingerprint->playlist_capacity ? fingerprint->playlist_capacity * 2 : 32;
+        fingerprint->playlist_hashes = (uint64_t*) realloc(fingerprint->playlist_hashes,
+                                                           fingerprint->playlist_capacity * sizeof(uint64_t));
+        if (fingerprint->playlist_hashes == NULL)
+        {
+            DIE("Out of memory.");
+        }
+    }
+    fingerprint->playlist_hashes[fingerprint->playlist_count] = xxh64_digest(&state);
+    add_element(fingerprint, fingerprint->playlist_hashes[fingerprint->playlist_count]);
+    fingerprint->playlist_count++;
+}
+
+void
+fingerprint_finish(fingerprint_t* fingerprint)
+{
+    xxh64_state_t state;
+    size_t i;
+
+    // Sorted, so the hash does not depend on playlist numbering
+    if (fingerprint->playlist_count > 0)
+        qsort(fingerprint->playlist_hashes, fingerprint->playlist_count, sizeof(uint64_t), compare_hashes);
+
+    init_xxh64_state_t(&state, 0);
+    update_int(&state, fingerprint->playlist_count);
+    for (i = 0; i < fingerprint->playlist_count; i++)
+        update_int(&state, fingerprint->playlist_hashes[i]);
+    fingerprint->hash = xxh64_digest(&state);
+}
+
+double
+fingerprint_similarity(const fingerprint_t* a, const fingerprint_t* b)
+{
+    int equal = 0;
+    int i;
+
+    if (a->hash == b->hash && a->playlist_count == b->playlist_count)
+        return 1.0;
+
+    for (i = 0; i < FINGERPRINT_MINHASH_SIZE; i++)
+        equal += a->minhash[i] == b->minhash[i];
+    return (double) equal / FINGERPRINT_MINHASH_SIZE;
+}
+
+bool
+fingerprint_disc(const char* path, fingerprint_t* fingerprint)
+{
+    bool ok;
+
+    init_fingerprint_t(fingerprint);
+    ok = disc_for_each_playlist(path, add_playlist, fingerprint);
+    fingerprint_finish(fingerprint);
+    return ok;
+}
+
+bool
+fingerprint_run(char** paths, int path_count, bool compare)
+{
+    fingerprint_t fingerprints[2];
+    bool ok = true;
+    int i;
+
+    if (compare)
+    {
+        if (path_count != 2)
+        {
+            DIE("--compare takes exactly two discs.");
+        }
+
+        ok = fingerprint_disc(paths[0], &fingerprints[0]) && ok;
+        ok = fingerprint_disc(paths[1], &fingerprints[1]) && ok;
+        printf("%.4f%s\n", fingerprint_similarity(&fingerprints[0], &fingerprints[1]),
+               fingerprints[0].hash == fingerprints[1].hash ? " (identical)" : "");
+        free_fingerprint_members(&fingerprints[0]);
+        free_fingerprint_members(&fingerprints[1]);
+        return ok;
+    }
+
+    for (i = 0; i < path_count; i++)
+    {
+        if (fingerprint_disc(paths[i], &fingerprints[0]))
+            print_fingerprint(&fingerprints[0], paths[i]);
+        else
+            ok = false;
+        free_fingerprint_members(&fingerprints[0]);
+    }
+
+    return ok;
+}
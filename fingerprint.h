@@ -0,0 +1,115 @@
+/*
+ * File:   fingerprint.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Disc fingerprints (--fingerprint), computed from parsed playlists and
+ * clip info file sizes only; no stream file is read.
+ *
+ * Every playlist is reduced to a 64-bit content hash (XXH64) of its clip
+ * sequence (clip names, IN/OUT times in ticks, stream counts, .clpi sizes)
+ * and its chapter ticks.  Playlist file names are left out, so renumbered
+ * playlists still match.  The disc hash is the XXH64 of the sorted playlist
+ * hashes: equal for discs with identical metadata.
+ *
+ * For near-identical discs (regional variants, re-releases) the fingerprint
+ * also holds a MinHash signature of the set of playlists, PlayItems and
+ * clip info files.  The fraction of equal slots in two signatures estimates
+ * the Jaccard similarity of the two sets.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef FINGERPRINT_H
+#define	FINGERPRINT_H
+
+#include "parse_mpls.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+#define FINGERPRINT_FIELDS       (FIELD_CLIPS | FIELD_TRACKS | FIELD_CHAPTERS)
+#define FINGERPRINT_MINHASH_SIZE 64
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    uint64_t hash;               /* valid after fingerprint_finish() */
+    uint32_t minhash[FINGERPRINT_MINHASH_SIZE];
+    uint64_t* playlist_hashes;
+    size_t playlist_count;
+    size_t playlist_capacity;
+} fingerprint_t;
+
+
+/*
+ * Functions
+ */
+
+
+void
+init_fingerprint_t(fingerprint_t* fingerprint);
+
+void
+free_fingerprint_members(fingerprint_t* fingerprint);
+
+/**
+ * @param fingerprint
+ * @param playlist parsed with FINGERPRINT_FIELDS, and with clip info sizes
+ *        looked up (disc_find_clip_sizes())
+ */
+void
+fingerprint_add_playlist(fingerprint_t* fingerprint, const playlist_t* playlist);
+
+/**
+ * Computes the disc hash once every playlist was added.
+ * @param fingerprint
+ */
+void
+fingerprint_finish(fingerprint_t* fingerprint);
+
+/**
+ * @param a
+ * @param b
+ * @return Estimated similarity in [0, 1]; 1 for identical discs.
+ */
+double
+fingerprint_similarity(const fingerprint_t* a, const fingerprint_t* b);
+
+/**
+ * Fingerprints a disc (or a single playlist).
+ * @param path
+ * @param fingerprint receives the fingerprint
+ * @return false if a playlist could not be read (reported on stderr).
+ */
+bool
+fingerprint_disc(const char* path, fingerprint_t* fingerprint);
+
+/**
+ * Prints "HASH MINHASH  PATH" for every path, or with compare set (exactly
+ * two paths), their similarity.
+ * @param paths
+ * @param path_count
+ * @param compare
+ * @return false if a disc could not be fingerprinted.
+ */
+bool
+fingerprint_run(char** paths, int path_count, bool compare);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* FINGERPRINT_H */
@@ -0,0 +1,300 @@
+/*
+ * File:   fuzz_mpls.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Fuzz harness for the .mpls parser and the other readers of untrusted
+ * input, picked by the input's first bytes:
+ *
+ *   "MPLS"     .mpls parser, playlist index, catalog and mpls_view accessors
+ *   "MPLSBIN"  mplsbin_open() and mplsbin_to_playlist() of --format=bin files
+ *   "HDMV"     clpi_read_file() of .clpi files
+ *   otherwise  ingest's tar and length-prefixed readers, whose members go
+ *              through the .mpls checks above
+ *
+ * fuzz/corpus has seed files of each kind.
+ *
+ * libFuzzer:  make fuzz && ./fuzz_mpls fuzz/corpus
+ * AFL:        make fuzz-afl CC=afl-clang-fast && afl-fuzz -i fuzz/corpus -o findings ./fuzz_mpls_afl
+ *
+ * The standalone (AFL) build reads one input from stdin, or from each file
+ * named on the command line, which is also handy for replaying crashes.
+ *
+ * Both builds first check XXH64 against reference test vectors and abort
+ * on a mismatch, so every fuzz or replay run also tests the checksum of
+ * --verify.
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "../parse_mpls.h"
+#include "../allocator.h"
+#include "../catalog.h"
+#include "../playlist_index.h"
+#include "../mpls_view.h"
+#include "../mplsbin.h"
+#include "../clpi.h"
+#include "../ingest.h"
+#include "../xxh64.h"
+
+
+/**
+ * Aborts unless XXH64 (seed 0) matches the reference implementation.
+ */
+static void
+check_xxh64_vectors()
+{
+    static const struct {
+        const char* input;
+        uint64_t hash;
+    } vectors[] = {
+        { "",                                        0xef46db3751d8e999ull },
+        { "abc",                                     0x44bc2cf5ad770999ull },
+        { "Nobody inspects the spammish repetition", 0xfbcea83c8a378bf1ull } /* whole stripe + both tails */
+    };
+    xxh64_state_t state;
+    size_t i;
+    size_t b;
+    size_t len;
+
+    for (i = 0; i < ARRAY_SIZE(vectors); i++)
+    {
+        len = strlen(vectors[i].input);
+
+        // Streamed a byte at a time, so every buffering path is taken too
+        init_xxh64_state_t(&state, 0);
+        for (b = 0; b < len; b++)
+            xxh64_update(&state, vectors[i].input + b, 1);
+
+        if (xxh64(vectors[i].input, len, 0) != vectors[i].hash || xxh64_digest(&state) != vectors[i].hash)
+        {
+            fprintf(stderr, "XXH64 of \"%s\" does not match the reference %016llx.\n",
+                    vectors[i].input, (unsigned long long) vectors[i].hash);
+            abort();
+        }
+    }
+}
+
+static void
+walk_view(const mpls_file_t* mpls_file)
+{
+    mpls_view_t view;
+    mpls_play_item_iter_t item;
+    mpls_angle_iter_t angle;
+    mpls_stream_iter_t stream;
+    mpls_mark_iter_t mark;
+    volatile uint32_t sink = 0;
+    bool has_item;
+    bool ok;
+
+    // Touch every field so ASan sees every read the accessors make
+    mpls_view_init(&view, mpls_file);
+    for (has_item = mpls_view_play_items(&view, &item); has_item; has_item = mpls_play_item_next(&item))
+    {
+        char filename[11];
+        const char* language;
+
+        mpls_play_item_filename(&item, filename);
+        sink += (uint32_t) filename[0] + mpls_play_item_stc_id(&item) + (uint32_t) mpls_play_item_time_in(&item) +
+                (uint32_t) mpls_play_item_time_out(&item) + (uint32_t) mpls_play_item_uo_mask(&item);
+
+        for (ok = mpls_play_item_angles(&item, &angle); ok; ok = mpls_angle_next(&angle))
+        {
+            mpls_angle_filename(&angle, filename);
+            sink += (uint32_t) filename[0] + mpls_angle_stc_id(&angle);
+        }
+        for (ok = mpls_play_item_streams(&item, &stream); ok; ok = mpls_stream_next(&stream))
+        {
+            language = mpls_stream_language(&stream);
+            sink += (uint32_t) mpls_stream_pid(&stream) + mpls_stream_coding_type(&stream) + (language != NULL ? (uint8_t) language[2] : 0);
+        }
+    }
+    for (ok = mpls_view_marks(&view, &mark); ok; ok = mpls_mark_next(&mark))
+        sink += (uint32_t) mpls_mark_type(&mark) + mpls_mark_play_item(&mark) + (uint32_t) mpls_mark_time(&mark) +
+                mpls_mark_entry_es_pid(&mark) + (uint32_t) mpls_mark_duration(&mark);
+}
+
+static void
+check_playlist(const char* path, const playlist_t* playlist)
+{
+    playlist_index_t index;
+    catalog_t catalog;
+    double offset_sec;
+
+    init_playlist_index_t(&index, playlist);
+    playlist_index_find_clip(&index, playlist->duration_sec / 2, &offset_sec);
+    playlist_index_find_chapter(&index, playlist->duration_sec / 2);
+    free_playlist_index_members(&index);
+
+    init_catalog_t(&catalog);
+    catalog_add_playlist(&catalog, path, playlist);
+    catalog_build_clip_index(&catalog);
+    free_catalog_members(&catalog);
+}
+
+static void
+fuzz_mpls(const char* path, const void* data, size_t size)
+{
+    mpls_file_t mpls_file = create_mpls_file_t();
+    char error[256];
+
+    // Copy into an exactly-sized heap buffer so ASan catches any read past the end
+    mpls_file.path = MPLS_STRDUP(path);
+    mpls_file.name = mpls_file.path;
+    mpls_file.size = (long) size;
+    mpls_file.data = (char*) MPLS_CALLOC(size ? size : 1, 1);
+    memcpy(mpls_file.data, data, size);
+
+    if (read_mpls_header(&mpls_file, error, sizeof(error)) &&
+        validate_mpls_sections(&mpls_file, error, sizeof(error)))
+    {
+        playlist_t playlist = create_playlist_t();
+
+        parse_playlist(&mpls_file, &playlist, FIELD_ALL);
+        check_playlist(mpls_file.path, &playlist);
+        free_playlist_members(&playlist);
+
+        walk_view(&mpls_file);
+    }
+
+    free_mpls_file_members(&mpls_file);
+}
+
+static void
+fuzz_mplsbin(const uint8_t* data, size_t size)
+{
+    // malloc() keeps the 8-byte alignment mplsbin_open() requires
+    void* copy = malloc(size);
+    mplsbin_t bin;
+    char error[256];
+    size_t i;
+
+    memcpy(copy, data, size);
+    if (mplsbin_open(&bin, copy, size, error, sizeof(error)))
+    {
+        for (i = 0; i < mplsbin_playlist_count(&bin); i++)
+        {
+            const mplsbin_playlist_t* record = mplsbin_playlist(&bin, i);
+            playlist_t playlist = create_playlist_t();
+
+            mplsbin_to_playlist(&bin, record, &playlist);
+            check_playlist(mplsbin_string(&bin, record->path), &playlist);
+            free_playlist_members(&playlist);
+        }
+    }
+    free(copy);
+}
+
+static void
+fuzz_clpi(const uint8_t* data, size_t size)
+{
+    FILE* file = fmemopen((void*) data, size, "rb");
+    clpi_info_t info;
+    char error[256];
+
+    if (file == NULL)
+        return;
+    clpi_read_file(file, "fuzz.clpi", &info, error, sizeof(error));
+    fclose(file);
+}
+
+static void
+fuzz_member(const char* name, char* data, long size, void* arg)
+{
+    fuzz_mpls(name, data, (size_t) size);
+}
+
+static void
+fuzz_ingest(const uint8_t* data, size_t size)
+{
+    ingest_stream_t stream;
+    char error[256];
+
+    // An exactly-sized buffer at end of stream, so ingest_fill() never reads
+    init_ingest_stream_t(&stream, -1);
+    stream.buffer = (char*) malloc(size ? size : 1);
+    memcpy(stream.buffer, data, size);
+    stream.capacity = size;
+    stream.end = size;
+    stream.eof = true;
+
+    if (ingest_detect_format(&stream) == INGEST_FORMAT_TAR)
+        ingest_tar(&stream, fuzz_member, NULL, error, sizeof(error));
+    else
+        ingest_length_prefixed(&stream, "fuzz", fuzz_member, NULL, error, sizeof(error));
+
+    free_ingest_stream_members(&stream);
+}
+
+int
+LLVMFuzzerInitialize(int* argc, char*** argv)
+{
+    check_xxh64_vectors();
+    return 0;
+}
+
+int
+LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (size >= 8 && memcmp(data, MPLSBIN_MAGIC, 8) == 0)
+        fuzz_mplsbin(data, size);
+    else if (size >= 4 && memcmp(data, "MPLS", 4) == 0)
+        fuzz_mpls("fuzz.mpls", data, size);
+    else if (size >= 4 && memcmp(data, "HDMV", 4) == 0)
+        fuzz_clpi(data, size);
+    else
+        fuzz_ingest(data, size);
+    return 0;
+}
+
+
+#ifdef FUZZ_STANDALONE
+
+static void
+run_file(FILE* file)
+{
+    size_t capacity = 4096;
+    size_t size = 0;
+    size_t br;
+    uint8_t* buf = (uint8_t*) malloc(capacity);
+
+    while ((br = fread(buf + size, 1, capacity - size, file)) > 0)
+    {
+        size += br;
+        if (size == capacity)
+        {
+            capacity *= 2;
+            buf = (uint8_t*) realloc(buf, capacity);
+        }
+    }
+
+    LLVMFuzzerTestOneInput(buf, size);
+    free(buf);
+}
+
+int main(int argc, char** argv) {
+    int i;
+
+    LLVMFuzzerInitialize(&argc, &argv);
+
+    if (argc < 2)
+    {
+        run_file(stdin);
+        return (EXIT_SUCCESS);
+    }
+
+    for (i = 1; i < argc; i++)
+    {
+        FILE* file = fopen(argv[i], "rb");
+        if (file == NULL)
+        {
+            DIE("Unable to open \"%s\" for reading.", argv[i]);
+        }
+        run_file(file);
+        fclose(file);
+    }
+
+    return (EXIT_SUCCESS);
+}
+
+#endif /* FUZZ_STANDALONE */
@@ -0,0 +1,450 @@
+/*
+ * File:   ingest.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "ingest.h"
+#include "allocator.h"
+#include "disc.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <strings.h>
+
+
+/*
+ * Constants
+ */
+
+
+/**
+ * Writes a formatted message to the `error` buffer and returns false.
+ * Expects `char* error` and `size_t error_size` to be in scope.
+ */
+#define FAIL(...) do { snprintf(error, error_size, __VA_ARGS__); return false; } while (0)
+
+
+/*
+ * Private functions
+ */
+
+
+static size_t
+buffered(ingest_stream_t* stream)
+{
+    return stream->end - stream->start;
+}
+
+static void
+consume(ingest_stream_t* stream, size_t count)
+{
+    stream->start += count;
+}
+
+/**
+ * Consumes count bytes without keeping them buffered all at once.
+ * @return false if the stream ended first.
+ */
+static bool
+skip(ingest_stream_t* stream, int64_t count)
+{
+    while (count > 0)
+    {
+        size_t chunk = count < INGEST_READ_SIZE ? (size_t) count : INGEST_READ_SIZE;
+        ingest_fill(stream, chunk);
+        if (buffered(stream) == 0)
+            return false;
+        if (chunk > buffered(stream))
+            chunk = buffered(stream);
+        consume(stream, chunk);
+        count -= chunk;
+    }
+    return true;
+}
+
+/**
+ * Parses and prints one playlist held in the stream buffer (an
+ * ingest_member_fn).
+ * @param name printed as the playlist's path
+ * @param data borrowed; must stay valid until this returns
+ * @param size
+ * @param arg int* FIELD_* flags
+ */
+static void
+parse_member(const char* name, char* data, long size, void* arg)
+{
+    int fields = *(const int*) arg;
+    mpls_file_t mpls_file = create_mpls_file_t();
+    playlist_t playlist = create_playlist_t();
+    char error[256];
+    char* slash;
+
+    mpls_file.path = MPLS_STRDUP(name);
+    slash = strrchr(mpls_file.path, '/');
+    mpls_file.name = slash != NULL ? slash + 1 : mpls_file.path;
+    mpls_file.data = data;
+    mpls_file.size = size;
+
+    if (!check_mpls(&mpls_file, error, sizeof(error)))
+    {
+        fflush(stdout);
+        DIE("%s", error);
+    }
+
+    parse_playlist(&mpls_file, &playlist, fields);
+    output_playlist(&mpls_file, &playlist);
+
+    free_playlist_members(&playlist);
+    mpls_file.data = NULL; /* belongs to the stream buffer */
+    free_mpls_file_members(&mpls_file);
+}
+
+/**
+ * @return The value of an octal or GNU base-256 number field, or -1 if it is
+ *         negative or does not fit in an int64_t.
+ */
+static int64_t
+parse_tar_number(const char* field, size_t length)
+{
+    int64_t value = 0;
+    size_t i = 0;
+
+    // GNU base-256 encoding (sizes of 8 GiB and up); 0x40 marks a negative number
+    if ((uint8_t) field[0] & 0x80)
+    {
+        uint64_t big = (uint8_t) field[0] & 0x3F;
+
+        if ((uint8_t) field[0] & 0x40)
+            return -1;
+        for (i = 1; i < length; i++)
+        {
+            if (big > (uint64_t) INT64_MAX >> 8)
+                return -1;
+            big = (big << 8) | (uint8_t) field[i];
+        }
+        return (int64_t) big;
+    }
+
+    while (i < length && (field[i] == ' ' || field[i] == '\0'))
+        i++;
+    for (; i < length && field[i] >= '0' && field[i] <= '7'; i++)
+        value = (value << 3) | (field[i] - '0');
+    return value;
+}
+
+static bool
+tar_checksum_ok(const char* header)
+{
+    int64_t expected = parse_tar_number(header + 148, 8);
+    int64_t sum = 0;
+    int i;
+
+    // The checksum field itself counts as eight spaces
+    for (i = 0; i < INGEST_TAR_BLOCK_SIZE; i++)
+        sum += (i >= 148 && i < 156) ? ' ' : (uint8_t) header[i];
+    return sum == expected;
+}
+
+static bool
+is_zero_block(const char* block)
+{
+    int i;
+    for (i = 0; i < INGEST_TAR_BLOCK_SIZE; i++)
+    {
+        if (block[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @return true for "00000.mpls" and ".../PLAYLIST/00000.mpls", except under BACKUP.
+ */
+static bool
+is_playlist_member(const char* name)
+{
+    size_t len = strlen(name);
+
+    if (strchr(name, '/') == NULL)
+        return len > 5 && strcasecmp(name + len - 5, ".mpls") == 0;
+    return disc_is_disc_file(name, "PLAYLIST", ".mpls");
+}
+
+/**
+ * Finds the "path" record of a pax extended header ("<length> path=<value>\n" records).
+ * @param dest left unchanged if there is none
+ */
+static void
+read_pax_path(const char* data, int64_t size, char* dest, size_t dest_size)
+{
+    int64_t pos = 0;
+
+    while (pos < size)
+    {
+        int64_t length = 0;
+        int64_t i = pos;
+
+        while (i < size && data[i] >= '0' && data[i] <= '9')
+            length = length * 10 + (data[i++] - '0');
+        if (length <= 0 || pos + length > size || i >= size || data[i] != ' ')
+            return;
+        i++;
+
+        // The record ends with '\n', which is counted in length
+        if (pos + length - i > 5 && strncmp(data + i, "path=", 5) == 0)
+        {
+            snprintf(dest, dest_size, "%.*s", (int) (pos + length - i - 6), data + i + 5);
+            return;
+        }
+        pos += length;
+    }
+}
+
+/*
+ * Functions
+ */
+
+
+void
+init_ingest_stream_t(ingest_stream_t* stream, int fd)
+{
+    stream->fd = fd;
+    stream->buffer = NULL;
+    stream->capacity = 0;
+    stream->start = 0;
+    stream->end = 0;
+    stream->eof = false;
+    stream->bytes_read = 0;
+}
+
+void
+free_ingest_stream_members(ingest_stream_t* stream)
+{
+    free(stream->buffer); stream->buffer = NULL;
+    stream->capacity = 0;
+    stream->start = stream->end = 0;
+}
+
+bool
+ingest_fill(ingest_stream_t* stream, size_t count)
+{
+    while (buffered(stream) < count && !stream->eof)
+    {
+        size_t pending = buffered(stream);
+        size_t needed = (count > pending + INGEST_READ_SIZE ? count : pending + INGEST_READ_SIZE) + 1;
+        ssize_t br;
+
+        // Keep the unconsumed bytes at the front so members stay contiguous
+        if (stream->start > 0)
+        {
+            memmove(stream->buffer, stream->buffer + stream->start, pending);
+            stream->start = 0;
+            stream->end = pending;
+        }
+
+        if (stream->capacity < needed)
+        {
+            size_t capacity = stream->capacity * 2 > needed ? stream->capacity * 2 : needed;
+            char* buffer = (char*) realloc(stream->buffer, capacity);
+            if (buffer == NULL)
+            {
+                DIE("Out of memory reading %zu bytes of input.", count);
+            }
+            stream->buffer = buffer;
+            stream->capacity = capacity;
+        }
+
+        STATS_BEGIN(load);
+        // Leave one spare byte after the data, as load_mpls() does
+        br = read(stream->fd, stream->buffer + stream->end, stream->capacity - stream->end - 1);
+        STATS_END(load, STATS_PHASE_LOAD);
+
+        if (br < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            DIE("Error reading input: %s.", strerror(errno));
+        }
+        if (br == 0)
+            stream->eof = true;
+
+        stream->end += br;
+        stream->bytes_read += br;
+        STATS_ADD(STATS_BYTES_READ, br);
+    }
+
+    return buffered(stream) >= count;
+}
+
+ingest_format_t
+ingest_detect_format(ingest_stream_t* stream)
+{
+    const char* head;
+
+    ingest_fill(stream, INGEST_TAR_BLOCK_SIZE);
+    head = stream->buffer + stream->start;
+
+    if (buffered(stream) >= 4 && memcmp(head, "MPLS", 4) == 0)
+        return INGEST_FORMAT_MPLS;
+    if (buffered(stream) >= INGEST_TAR_BLOCK_SIZE &&
+        (memcmp(head + 257, "ustar", 5) == 0 || tar_checksum_ok(head)))
+        return INGEST_FORMAT_TAR;
+    return INGEST_FORMAT_LENGTH_PREFIXED;
+}
+
+bool
+ingest_tar(ingest_stream_t* stream, ingest_member_fn fn, void* arg, char* error, size_t error_size)
+{
+    char long_name[PATH_MAX] = "";
+    char name[PATH_MAX];
+
+    for (;;)
+    {
+        char* header;
+        int64_t size;
+        int64_t padded;
+        char type;
+
+        if (!ingest_fill(stream, INGEST_TAR_BLOCK_SIZE))
+        {
+            // A missing end-of-archive marker is common with streamed tars; a partial header is not
+            if (buffered(stream) != 0)
+            {
+                FAIL("Truncated tar header.");
+            }
+            return true;
+        }
+
+        header = stream->buffer + stream->start;
+        if (is_zero_block(header))
+            return true;
+        if (!tar_checksum_ok(header))
+        {
+            FAIL("Invalid tar header checksum at offset %lli.", (long long) (stream->bytes_read - buffered(stream)));
+        }
+
+        size = parse_tar_number(header + 124, 12);
+        type = header[156];
+
+        if (long_name[0] != '\0')
+            snprintf(name, sizeof(name), "%s", long_name);
+        else if (memcmp(header + 257, "ustar", 5) == 0 && header[345] != '\0')
+            snprintf(name, sizeof(name), "%.155s/%.100s", header + 345, header);
+        else
+            snprintf(name, sizeof(name), "%.100s", header);
+        long_name[0] = '\0';
+
+        if (size < 0 || size > INT64_MAX - INGEST_TAR_BLOCK_SIZE)
+        {
+            FAIL("Invalid tar size for \"%s\".", name);
+        }
+        padded = (size + INGEST_TAR_BLOCK_SIZE - 1) / INGEST_TAR_BLOCK_SIZE * INGEST_TAR_BLOCK_SIZE;
+
+        consume(stream, INGEST_TAR_BLOCK_SIZE);
+
+        if (type == 'L' || type == 'x')
+        {
+            // GNU long name or pax extended header: names the next member
+            if (size > INGEST_READ_SIZE || !ingest_fill(stream, padded))
+            {
+                FAIL("Truncated or oversized tar header for \"%s\".", name);
+            }
+            if (type == 'L')
+                snprintf(long_name, sizeof(long_name), "%.*s", (int) size, stream->buffer + stream->start);
+            else
+                read_pax_path(stream->buffer + stream->start, size, long_name, sizeof(long_name));
+            consume(stream, padded);
+            continue;
+        }
+
+        if ((type == '0' || type == '\0' || type == '7') && is_playlist_member(name) && size <= LONG_MAX)
+        {
+            if (!ingest_fill(stream, padded))
+            {
+                FAIL("Truncated tar stream: \"%s\" needs %lli bytes, found %zu.", name, (long long) padded, buffered(stream));
+            }
+            fn(name, stream->buffer + stream->start, (long) size, arg);
+            consume(stream, padded);
+        }
+        else if (!skip(stream, padded))
+        {
+            FAIL("Truncated tar stream: \"%s\".", name);
+        }
+    }
+}
+
+bool
+ingest_length_prefixed(ingest_stream_t* stream, const char* label, ingest_member_fn fn, void* arg,
+                       char* error, size_t error_size)
+{
+    char name[PATH_MAX];
+    int index = 0;
+
+    while (ingest_fill(stream, 4))
+    {
+        uint32_t size = (uint32_t) get_int32(stream->buffer + stream->start);
+        consume(stream, 4);
+
+        if (size > INT32_MAX || !ingest_fill(stream, size))
+        {
+            FAIL("Truncated input: playlist %i is %u bytes, found %zu.", index + 1, size, buffered(stream));
+        }
+
+        snprintf(name, sizeof(name), "%s:%i", label, ++index);
+        fn(name, stream->buffer + stream->start, (long) size, arg);
+        consume(stream, size);
+    }
+
+    if (buffered(stream) != 0)
+    {
+        FAIL("Truncated input: %zu trailing bytes after playlist %i.", buffered(stream), index);
+    }
+    return true;
+}
+
+
+void
+ingest_run(int fd, const char* label, int fields)
+{
+    ingest_stream_t stream;
+    char error[256];
+    bool ok = true;
+
+    init_ingest_stream_t(&stream, fd);
+
+    if (!ingest_fill(&stream, 1))
+    {
+        DIE("No input on %s.", label);
+    }
+
+    switch (ingest_detect_format(&stream))
+    {
+        case INGEST_FORMAT_MPLS:
+            while (ingest_fill(&stream, buffered(&stream) + INGEST_READ_SIZE))
+                ;
+            parse_member(label, stream.buffer + stream.start, (long) buffered(&stream), &fields);
+            break;
+        case INGEST_FORMAT_TAR:
+            ok = ingest_tar(&stream, parse_member, &fields, error, sizeof(error));
+            break;
+        case INGEST_FORMAT_LENGTH_PREFIXED:
+            if (buffered(&stream) >= 8 && memcmp(stream.buffer + stream.start + 4, "MPLS", 4) != 0)
+            {
+                DIE("Unrecognized input on %s: expected an MPLS file, a tar archive or length-prefixed MPLS files.", label);
+            }
+            ok = ingest_length_prefixed(&stream, label, parse_member, &fields, error, sizeof(error));
+            break;
+    }
+
+    if (!ok)
+    {
+        fflush(stdout);
+        DIE("%s", error);
+    }
+
+    free_ingest_stream_members(&stream);
+}
@@ -0,0 +1,153 @@
+/*
+ * File:   ingest.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Parses playlists read from a file descriptor (stdin, a pipe, a socket)
+ * instead of from files on disk.  The stream format is detected from its
+ * first bytes:
+ *
+ *   - a single .mpls file ("MPLS" magic), read to EOF;
+ *   - a tar (ustar/GNU) archive; every .mpls member in a PLAYLIST directory
+ *     (e.g., BDMV/PLAYLIST/00000.mpls, but not BDMV/BACKUP) is parsed and all
+ *     other members are skipped;
+ *   - a sequence of playlists, each prefixed with its length as a 32-bit
+ *     big-endian integer.
+ *
+ * Members are parsed in place from one streaming buffer, which is reused
+ * (and only grows to the size of the largest member); nothing is written
+ * to disk.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef INGEST_H
+#define	INGEST_H
+
+#include "parse_mpls.h"
+
+#include <unistd.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+#define INGEST_TAR_BLOCK_SIZE 512
+#define INGEST_READ_SIZE      65536   /* minimum read() size */
+
+
+/*
+ * Enums
+ */
+
+
+typedef enum {
+    INGEST_FORMAT_MPLS,
+    INGEST_FORMAT_TAR,
+    INGEST_FORMAT_LENGTH_PREFIXED
+} ingest_format_t;
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    int fd;
+    char* buffer;
+    size_t capacity;
+    size_t start;                /* unconsumed bytes are buffer[start, end) */
+    size_t end;
+    bool eof;
+    int64_t bytes_read;
+} ingest_stream_t;
+
+/**
+ * Called with each playlist found in a tar or length-prefixed stream.
+ * @param name member name, e.g., "BDMV/PLAYLIST/00000.mpls" or "<stdin>:1"
+ * @param data borrowed from the stream buffer; valid until this returns
+ * @param size
+ * @param arg
+ */
+typedef void (*ingest_member_fn)(const char* name, char* data, long size, void* arg);
+
+
+/*
+ * Functions
+ */
+
+
+void
+init_ingest_stream_t(ingest_stream_t* stream, int fd);
+
+void
+free_ingest_stream_members(ingest_stream_t* stream);
+
+/**
+ * Reads until at least count unconsumed bytes are buffered, contiguously.
+ * @param stream
+ * @param count
+ * @return false if the stream ended first (all remaining bytes are buffered).
+ */
+bool
+ingest_fill(ingest_stream_t* stream, size_t count);
+
+/**
+ * Detects the stream format from its first bytes (without consuming them).
+ * @param stream
+ * @return
+ */
+ingest_format_t
+ingest_detect_format(ingest_stream_t* stream);
+
+/**
+ * Calls fn with every playlist member of a tar archive, skipping the other
+ * members and BACKUP copies.
+ * @param stream
+ * @param fn
+ * @param arg passed to fn
+ * @param error receives a message if the archive is invalid or truncated
+ * @param error_size
+ * @return false if the archive is invalid or truncated.
+ */
+bool
+ingest_tar(ingest_stream_t* stream, ingest_member_fn fn, void* arg, char* error, size_t error_size);
+
+/**
+ * Calls fn with every playlist of a stream of 4-byte big-endian sizes, each
+ * followed by that many bytes of .mpls data.
+ * @param stream
+ * @param label members are named "<label>:<n>"
+ * @param fn
+ * @param arg passed to fn
+ * @param error receives a message if the stream is truncated
+ * @param error_size
+ * @return false if the stream is truncated.
+ */
+bool
+ingest_length_prefixed(ingest_stream_t* stream, const char* label, ingest_member_fn fn, void* arg,
+                       char* error, size_t error_size);
+
+/**
+ * Parses and prints every playlist in the stream, in stream order.  Like
+ * parse_mpls(), exits via DIE() at the first invalid playlist.
+ * @param fd
+ * @param label printed instead of a path, e.g., "<stdin>"
+ * @param fields FIELD_* flags
+ */
+void
+ingest_run(int fd, const char* label, int fields);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* INGEST_H */
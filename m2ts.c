@@ -0,0 +1,31 @@
+/*
+ * File:   m2ts.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "m2ts.h"
+
+
+/*
+ * Functions
+ */
+
+
+int64_t
+m2ts_find_sync_error(const uint8_t* data, size_t size)
+{
+    size_t whole = size - size % M2TS_PACKET_SIZE;
+    size_t pos;
+
+    // The sync byte is the first byte of the TS packet, after the TP_extra_header
+    for (pos = 0; pos < whole; pos += M2TS_PACKET_SIZE)
+    {
+        if (data[pos + 4] != TS_SYNC_BYTE)
+            return (int64_t) pos;
+    }
+
+    return whole < size ? (int64_t) whole : -1;
+}
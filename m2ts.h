@@ -0,0 +1,98 @@
+/*
+ * File:   m2ts.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * BDAV MPEG-2 transport stream (.m2ts) packets.  On disc every 188-byte TS
+ * packet is preceded by a 4-byte TP_extra_header: copy permission (2 bits)
+ * and a 30-bit arrival time stamp (ATS) on the 27 MHz clock.  Packets are
+ * stored in aligned units of 32 packets (6144 bytes).
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef M2TS_H
+#define	M2TS_H
+
+#include "parse_mpls.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+#define TS_PACKET_SIZE          188
+#define TS_SYNC_BYTE            0x47
+#define M2TS_PACKET_SIZE        192  /* TP_extra_header (4) + TS packet (188) */
+#define M2TS_ALIGNED_UNIT_SIZE  6144 /* 32 packets */
+#define M2TS_ATS_MASK           0x3FFFFFFF
+#define M2TS_CLOCK_HZ           27000000 /* ATS and PCR clock */
+#define M2TS_TICKS_PER_TIMECODE 600      /* 27 MHz ticks per 45 kHz timecode tick */
+
+
+/*
+ * Functions
+ */
+
+
+/**
+ * Checks the sync byte of every packet in a buffer of whole packets.
+ * @param data must start at a packet boundary
+ * @param size
+ * @return Offset of the first packet whose sync byte is wrong, of the
+ *         trailing partial packet if size is not a multiple of
+ *         M2TS_PACKET_SIZE, or -1 if every packet is in sync.
+ */
+int64_t
+m2ts_find_sync_error(const uint8_t* data, size_t size);
+
+
+/*
+ * Accessors
+ */
+
+
+/** @return 30-bit arrival time stamp (27 MHz). */
+static inline uint32_t
+m2ts_packet_ats(const uint8_t* packet)
+{
+    return ((uint32_t) (packet[0] & 0x3F) << 24) | (uint32_t) packet[1] << 16 | (uint32_t) packet[2] << 8 | packet[3];
+}
+
+static inline uint16_t
+m2ts_packet_pid(const uint8_t* packet)
+{
+    return (uint16_t) (((packet[5] & 0x1F) << 8) | packet[6]);
+}
+
+/**
+ * @param packet
+ * @param pcr receives the program clock reference in 27 MHz ticks
+ * @return false if the packet carries no PCR.
+ */
+static inline bool
+m2ts_packet_pcr(const uint8_t* packet, int64_t* pcr)
+{
+    const uint8_t* ts = packet + 4;
+    int64_t base;
+
+    // adaptation_field_control has an adaptation field, at least 7 bytes long, with PCR_flag set
+    if (!(ts[3] & 0x20) || ts[4] < 7 || !(ts[5] & 0x10))
+        return false;
+
+    base = ((int64_t) ts[6] << 25) | ((int64_t) ts[7] << 17) | ((int64_t) ts[8] << 9) | ((int64_t) ts[9] << 1) | (ts[10] >> 7);
+    *pcr = base * 300 + (((ts[10] & 0x01) << 8) | ts[11]);
+    return true;
+}
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* M2TS_H */
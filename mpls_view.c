@@ -0,0 +1,263 @@
+/*
+ * File:   mpls_view.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "mpls_view.h"
+
+
+/*
+ * Private functions
+ */
+
+
+static bool
+load_play_item(mpls_play_item_iter_t* it)
+{
+    if (it->index >= it->count)
+        return false;
+
+    // check_mpls() walked the same length fields, so the PlayItem fits the file
+    it->end = it->pos + 2 + (uint16_t) get_int16((char*) it->data + it->pos);
+    return true;
+}
+
+static bool
+stop_streams(mpls_stream_iter_t* it)
+{
+    it->kind = MPLS_STREAM_KIND_COUNT;
+    return false;
+}
+
+/**
+ * Positions the iterator on entry (kind, index) at next_pos, skipping empty
+ * groups, and finds where the entry after it starts.
+ * @return false at the end of the table or at an entry that does not fit.
+ */
+static bool
+load_stream(mpls_stream_iter_t* it)
+{
+    const char* data = it->data;
+    int32_t pos = it->next_pos;
+    int32_t attributes;
+    int32_t next;
+    int ref_lists;
+    int i;
+
+    while (it->kind < MPLS_STREAM_KIND_COUNT && it->index >= it->counts[it->kind])
+    {
+        it->kind++;
+        it->index = 0;
+    }
+    if (it->kind == MPLS_STREAM_KIND_COUNT)
+        return false;
+
+    // stream_entry and stream_attributes: length (1) + body each
+    if (pos + 1 > it->end)
+        return stop_streams(it);
+    attributes = pos + 1 + (uint8_t) data[pos];
+    if (attributes + 1 > it->end)
+        return stop_streams(it);
+    next = attributes + 1 + (uint8_t) data[attributes];
+
+    // Secondary streams are followed by reference lists: count (1), reserved (1),
+    // one byte per ID, padded to an even length.  Secondary audio has one list
+    // (primary audio), secondary video two (secondary audio, PiP subtitles).
+    ref_lists = it->kind == MPLS_STREAM_SECONDARY_AUDIO ? 1 : it->kind == MPLS_STREAM_SECONDARY_VIDEO ? 2 : 0;
+    for (i = 0; i < ref_lists && next + 2 <= it->end; i++)
+    {
+        int ids = (uint8_t) data[next];
+        next += 2 + ids + (ids & 1);
+    }
+    if (next > it->end || i < ref_lists)
+        return stop_streams(it);
+
+    it->pos = pos;
+    it->attributes_pos = attributes;
+    it->next_pos = next;
+    return true;
+}
+
+
+/*
+ * Functions
+ */
+
+
+void
+mpls_view_init(mpls_view_t* view, const mpls_file_t* mpls_file)
+{
+    view->data = mpls_file->data;
+    view->size = mpls_file->size;
+    view->version = mpls_file->version;
+    view->playlist_pos = mpls_file->playlist_pos;
+    view->chapter_pos = mpls_file->chapter_pos;
+    view->play_item_count = get_int16(mpls_file->data + mpls_file->playlist_pos + 6);
+    view->mark_count = mpls_file->total_chapter_count;
+}
+
+bool
+mpls_view_play_items(const mpls_view_t* view, mpls_play_item_iter_t* it)
+{
+    it->data = view->data;
+    it->pos = view->playlist_pos + PLAYLIST_HEADER_SIZE;
+    it->end = it->pos;
+    it->index = 0;
+    it->count = view->play_item_count;
+    return load_play_item(it);
+}
+
+bool
+mpls_play_item_next(mpls_play_item_iter_t* it)
+{
+    if (it->index >= it->count)
+        return false;
+
+    it->pos = it->end;
+    it->index++;
+    return load_play_item(it);
+}
+
+bool
+mpls_play_item_angles(const mpls_play_item_iter_t* item, mpls_angle_iter_t* it)
+{
+    // Angle block: number_of_angles (1), flags (1), then one entry per extra angle
+    it->data = item->data;
+    it->pos = item->pos + 2 + PLAY_ITEM_FIXED_SIZE + 2;
+    it->index = 1;
+    it->count = mpls_play_item_angle_count(item);
+    return it->index < it->count;
+}
+
+bool
+mpls_angle_next(mpls_angle_iter_t* it)
+{
+    if (it->index >= it->count)
+        return false;
+
+    it->pos += PLAY_ITEM_ANGLE_SIZE;
+    it->index++;
+    return it->index < it->count;
+}
+
+bool
+mpls_play_item_streams(const mpls_play_item_iter_t* item, mpls_stream_iter_t* it)
+{
+    const char* data = item->data;
+    int angles = mpls_play_item_angle_count(item);
+    int32_t stn = item->pos + 2 + PLAY_ITEM_FIXED_SIZE;
+
+    // Same layout arithmetic as validate_mpls_sections()
+    if (mpls_play_item_is_multi_angle(item))
+        stn += 2 + (angles > 1 ? (angles - 1) * PLAY_ITEM_ANGLE_SIZE : 0);
+
+    it->data = data;
+    it->end = stn + 2 + (uint16_t) get_int16((char*) data + stn);
+    if (it->end > item->end)
+        it->end = item->end;
+
+    // Counts: video, audio, PG, IG, secondary audio, secondary video, PiP PG.
+    // PiP subtitle entries follow the PG entries in the same loop.
+    it->counts[MPLS_STREAM_VIDEO] = (uint8_t) data[stn + 4];
+    it->counts[MPLS_STREAM_AUDIO] = (uint8_t) data[stn + 5];
+    it->counts[MPLS_STREAM_PG] = (uint8_t) data[stn + 6] + (uint8_t) data[stn + 10];
+    it->counts[MPLS_STREAM_IG] = (uint8_t) data[stn + 7];
+    it->counts[MPLS_STREAM_SECONDARY_AUDIO] = (uint8_t) data[stn + 8];
+    it->counts[MPLS_STREAM_SECONDARY_VIDEO] = (uint8_t) data[stn + 9];
+
+    it->pos = it->attributes_pos = it->next_pos = stn + STN_HEADER_SIZE;
+    it->kind = MPLS_STREAM_VIDEO;
+    it->index = 0;
+    return load_stream(it);
+}
+
+bool
+mpls_stream_next(mpls_stream_iter_t* it)
+{
+    if (it->kind == MPLS_STREAM_KIND_COUNT)
+        return false;
+
+    it->index++;
+    return load_stream(it);
+}
+
+uint16_t
+mpls_stream_pid(const mpls_stream_iter_t* it)
+{
+    const char* entry = it->data + it->pos;
+    int length = (uint8_t) entry[0];
+
+    // stream_type 1: PID in the main clip; 2 and 4: SubPath (1), SubClip (1), PID;
+    // 3: SubPath (1), PID in the main clip
+    if (length < 1)
+        return 0xFFFF;
+    switch (entry[1])
+    {
+        case 1:
+            return length >= 3 ? (uint16_t) get_int16((char*) entry + 2) : 0xFFFF;
+        case 2:
+        case 4:
+            return length >= 5 ? (uint16_t) get_int16((char*) entry + 4) : 0xFFFF;
+        case 3:
+            return length >= 4 ? (uint16_t) get_int16((char*) entry + 3) : 0xFFFF;
+        default:
+            return 0xFFFF;
+    }
+}
+
+const char*
+mpls_stream_language(const mpls_stream_iter_t* it)
+{
+    const char* attributes = it->data + it->attributes_pos;
+    int length = (uint8_t) attributes[0];
+    int offset;
+
+    if (length < 1)
+        return NULL;
+
+    switch ((uint8_t) attributes[1])
+    {
+        // Audio: format / sample rate (1), language (3)
+        case 0x03: case 0x04:
+        case 0x80: case 0x81: case 0x82: case 0x83: case 0x84: case 0x85: case 0x86:
+        case 0xA1: case 0xA2:
+            offset = 3;
+            break;
+        // Presentation and interactive graphics: language (3)
+        case 0x90: case 0x91:
+            offset = 2;
+            break;
+        // Text subtitles: character code (1), language (3)
+        case 0x92:
+            offset = 3;
+            break;
+        default:
+            return NULL;
+    }
+
+    return length >= offset + 2 ? attributes + offset : NULL;
+}
+
+bool
+mpls_view_marks(const mpls_view_t* view, mpls_mark_iter_t* it)
+{
+    it->data = view->data;
+    it->pos = view->chapter_pos;
+    it->index = 0;
+    it->count = view->mark_count;
+    return it->index < it->count;
+}
+
+bool
+mpls_mark_next(mpls_mark_iter_t* it)
+{
+    if (it->index >= it->count)
+        return false;
+
+    it->pos += CHAPTER_SIZE;
+    it->index++;
+    return it->index < it->count;
+}
@@ -0,0 +1,309 @@
+/*
+ * File:   mpls_view.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Read-only views over the raw bytes of a checked .mpls file, for consumers
+ * that walk the PlayItems and marks once and have no use for a playlist_t.
+ * Nothing is allocated or copied: iterators are small structs holding byte
+ * offsets into mpls_file_t.data, and every field is decoded when its
+ * accessor is called.
+ *
+ * Iterators follow one pattern: a "first" function positions the iterator
+ * on the first element and a "next" function advances it; both return false
+ * when there is no (further) element.
+ *
+ *   mpls_play_item_iter_t item;
+ *   bool ok;
+ *   for (ok = mpls_view_play_items(&view, &item); ok; ok = mpls_play_item_next(&item))
+ *       printf("%i\n", mpls_play_item_time_in(&item));
+ *
+ * STN entries are not covered by check_mpls(), so the stream iterator checks
+ * each entry against the end of its PlayItem and stops at the first one that
+ * does not fit.  See mpls_view.hpp for C++ ranges.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef MPLS_VIEW_H
+#define	MPLS_VIEW_H
+
+#include "parse_mpls.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Enums
+ */
+
+
+/* STN stream entry groups, in table order */
+typedef enum {
+    MPLS_STREAM_VIDEO,
+    MPLS_STREAM_AUDIO,
+    MPLS_STREAM_PG,              /* subtitles, including PiP subtitles */
+    MPLS_STREAM_IG,
+    MPLS_STREAM_SECONDARY_AUDIO,
+    MPLS_STREAM_SECONDARY_VIDEO,
+    MPLS_STREAM_KIND_COUNT
+} mpls_stream_kind_t;
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    const char* data;            /* mpls_file_t.data; not owned */
+    long size;
+    mpls_version_t version;
+    int32_t playlist_pos;
+    int32_t chapter_pos;
+    int play_item_count;
+    int mark_count;
+} mpls_view_t;
+
+typedef struct {
+    const char* data;
+    int32_t pos;                 /* offset of the PlayItem's length field */
+    int32_t end;                 /* offset just past the PlayItem */
+    int index;
+    int count;
+} mpls_play_item_iter_t;
+
+typedef struct {
+    const char* data;
+    int32_t pos;                 /* offset of the current angle entry */
+    int index;                   /* 1-based: angle 0 is the PlayItem's own clip */
+    int count;                   /* number_of_angles */
+} mpls_angle_iter_t;
+
+typedef struct {
+    const char* data;
+    int32_t pos;                 /* offset of the current stream_entry */
+    int32_t attributes_pos;      /* offset of its stream_attributes */
+    int32_t next_pos;            /* offset of the next stream_entry */
+    int32_t end;                 /* end of the STN table, clamped to the PlayItem */
+    uint16_t counts[MPLS_STREAM_KIND_COUNT];
+    mpls_stream_kind_t kind;
+    int index;                   /* within kind */
+} mpls_stream_iter_t;
+
+typedef struct {
+    const char* data;
+    int32_t pos;                 /* offset of the current PlayListMark */
+    int index;
+    int count;
+} mpls_mark_iter_t;
+
+
+/*
+ * Functions
+ */
+
+
+/**
+ * @param view
+ * @param mpls_file must have passed check_mpls() and outlive the view
+ */
+void
+mpls_view_init(mpls_view_t* view, const mpls_file_t* mpls_file);
+
+bool
+mpls_view_play_items(const mpls_view_t* view, mpls_play_item_iter_t* it);
+
+bool
+mpls_play_item_next(mpls_play_item_iter_t* it);
+
+/**
+ * Iterates the PlayItem's additional angles (none unless it is multi-angle).
+ * @param item
+ * @param it
+ * @return
+ */
+bool
+mpls_play_item_angles(const mpls_play_item_iter_t* item, mpls_angle_iter_t* it);
+
+bool
+mpls_angle_next(mpls_angle_iter_t* it);
+
+/**
+ * Iterates the PlayItem's STN table: video, audio, PG, IG, secondary audio
+ * and secondary video entries, in that order.
+ * @param item
+ * @param it
+ * @return
+ */
+bool
+mpls_play_item_streams(const mpls_play_item_iter_t* item, mpls_stream_iter_t* it);
+
+bool
+mpls_stream_next(mpls_stream_iter_t* it);
+
+/**
+ * @param it
+ * @return PID of the stream, or 0xFFFF if the entry does not name one.
+ */
+uint16_t
+mpls_stream_pid(const mpls_stream_iter_t* it);
+
+/**
+ * @param it
+ * @return ISO 639-2 code (3 bytes, not NUL-terminated) for audio and
+ *         subtitle streams, or NULL.
+ */
+const char*
+mpls_stream_language(const mpls_stream_iter_t* it);
+
+bool
+mpls_view_marks(const mpls_view_t* view, mpls_mark_iter_t* it);
+
+bool
+mpls_mark_next(mpls_mark_iter_t* it);
+
+
+/*
+ * Accessors
+ */
+
+
+/** @return 5 bytes, e.g., "00800" (not NUL-terminated). */
+static inline const char*
+mpls_play_item_clip_id(const mpls_play_item_iter_t* it)
+{
+    return it->data + it->pos + 2;
+}
+
+/** @return 4 bytes, "M2TS" (not NUL-terminated). */
+static inline const char*
+mpls_play_item_codec_id(const mpls_play_item_iter_t* it)
+{
+    return it->data + it->pos + 7;
+}
+
+/**
+ * @param it
+ * @param dest receives e.g. "00800.M2TS", like stream_clip_t.filename
+ */
+static inline void
+mpls_play_item_filename(const mpls_play_item_iter_t* it, char dest[11])
+{
+    memcpy(dest, mpls_play_item_clip_id(it), 5);
+    dest[5] = '.';
+    memcpy(dest + 6, mpls_play_item_codec_id(it), 4);
+    dest[10] = '\0';
+}
+
+static inline bool
+mpls_play_item_is_multi_angle(const mpls_play_item_iter_t* it)
+{
+    return (it->data[it->pos + 12] >> 4) & 0x01;
+}
+
+static inline uint8_t
+mpls_play_item_stc_id(const mpls_play_item_iter_t* it)
+{
+    return (uint8_t) it->data[it->pos + 13];
+}
+
+/** @return IN_time in 45 kHz ticks. */
+static inline int32_t
+mpls_play_item_time_in(const mpls_play_item_iter_t* it)
+{
+    return get_int32((char*) it->data + it->pos + 14) & 0x7FFFFFFF;
+}
+
+/** @return OUT_time in 45 kHz ticks. */
+static inline int32_t
+mpls_play_item_time_out(const mpls_play_item_iter_t* it)
+{
+    return get_int32((char*) it->data + it->pos + 18) & 0x7FFFFFFF;
+}
+
+static inline uint64_t
+mpls_play_item_uo_mask(const mpls_play_item_iter_t* it)
+{
+    return ((uint64_t) (uint32_t) get_int32((char*) it->data + it->pos + 22) << 32) |
+           (uint32_t) get_int32((char*) it->data + it->pos + 26);
+}
+
+/**
+ * @return number_of_angles; 1 unless the PlayItem is multi-angle.  In bounds:
+ *         check_mpls() requires room for it in every multi-angle PlayItem.
+ */
+static inline int
+mpls_play_item_angle_count(const mpls_play_item_iter_t* it)
+{
+    return mpls_play_item_is_multi_angle(it) ? (uint8_t) it->data[it->pos + 2 + PLAY_ITEM_FIXED_SIZE] : 1;
+}
+
+static inline const char*
+mpls_angle_clip_id(const mpls_angle_iter_t* it)
+{
+    return it->data + it->pos;
+}
+
+static inline void
+mpls_angle_filename(const mpls_angle_iter_t* it, char dest[11])
+{
+    memcpy(dest, it->data + it->pos, 5);
+    dest[5] = '.';
+    memcpy(dest + 6, it->data + it->pos + 5, 4);
+    dest[10] = '\0';
+}
+
+static inline uint8_t
+mpls_angle_stc_id(const mpls_angle_iter_t* it)
+{
+    return (uint8_t) it->data[it->pos + 9];
+}
+
+/** @return stream_coding_type (e.g., VIDEO_CODING_HEVC), or 0 if the attributes are empty. */
+static inline uint8_t
+mpls_stream_coding_type(const mpls_stream_iter_t* it)
+{
+    return it->data[it->attributes_pos] != 0 ? (uint8_t) it->data[it->attributes_pos + 1] : 0;
+}
+
+static inline uint8_t
+mpls_mark_type(const mpls_mark_iter_t* it)
+{
+    return (uint8_t) it->data[it->pos + 1];
+}
+
+/** @return Index of the PlayItem the mark points into. */
+static inline uint16_t
+mpls_mark_play_item(const mpls_mark_iter_t* it)
+{
+    return (uint16_t) get_int16((char*) it->data + it->pos + 2);
+}
+
+/** @return Mark time within its PlayItem's clip, in 45 kHz ticks. */
+static inline int32_t
+mpls_mark_time(const mpls_mark_iter_t* it)
+{
+    return get_int32((char*) it->data + it->pos + 4);
+}
+
+static inline uint16_t
+mpls_mark_entry_es_pid(const mpls_mark_iter_t* it)
+{
+    return (uint16_t) get_int16((char*) it->data + it->pos + 8);
+}
+
+static inline int32_t
+mpls_mark_duration(const mpls_mark_iter_t* it)
+{
+    return get_int32((char*) it->data + it->pos + 10);
+}
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* MPLS_VIEW_H */
@@ -0,0 +1,199 @@
+/*
+ * File:   mpls_view.hpp
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * C++11 ranges over the mpls_view.h iterators:
+ *
+ *   mpls::view view(mpls_file);
+ *   for (mpls::play_item item : view.play_items())
+ *       for (mpls::stream stream : item.streams())
+ *           std::printf("%s 0x%04x\n", item.filename().c_str(), stream.pid());
+ *
+ * Like the C API, nothing is allocated (except by the std::string helpers)
+ * and fields are decoded when they are read.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef MPLS_VIEW_HPP
+#define	MPLS_VIEW_HPP
+
+#include "mpls_view.h"
+
+#include <string>
+
+namespace mpls {
+
+
+/*
+ * Ranges
+ */
+
+
+/*
+ * Forward iterator over a C iterator It, dereferencing to an element T
+ * constructed from it.  Only "!= end()" comparisons are supported, which is
+ * what range-for needs.
+ */
+template <typename It, typename T, bool (*Next)(It*)>
+class iterator {
+public:
+    iterator() : valid_(false) {}
+    iterator(const It& it, bool valid) : it_(it), valid_(valid) {}
+
+    T operator*() const { return T(it_); }
+    iterator& operator++() { valid_ = Next(&it_); return *this; }
+    bool operator!=(const iterator& other) const { return valid_ != other.valid_; }
+    bool operator==(const iterator& other) const { return valid_ == other.valid_; }
+
+private:
+    It it_;
+    bool valid_;
+};
+
+template <typename Iterator>
+class range {
+public:
+    explicit range(const Iterator& begin) : begin_(begin) {}
+
+    Iterator begin() const { return begin_; }
+    Iterator end() const { return Iterator(); }
+    bool empty() const { return !(begin_ != end()); }
+
+private:
+    Iterator begin_;
+};
+
+
+/*
+ * Elements
+ */
+
+
+class angle {
+public:
+    explicit angle(const mpls_angle_iter_t& it) : it_(it) {}
+
+    int index() const { return it_.index; }
+    std::string filename() const { char name[11]; mpls_angle_filename(&it_, name); return name; }
+    uint8_t stc_id() const { return mpls_angle_stc_id(&it_); }
+    const mpls_angle_iter_t& raw() const { return it_; }
+
+private:
+    mpls_angle_iter_t it_;
+};
+
+class stream {
+public:
+    explicit stream(const mpls_stream_iter_t& it) : it_(it) {}
+
+    mpls_stream_kind_t kind() const { return it_.kind; }
+    int index() const { return it_.index; }
+    uint16_t pid() const { return mpls_stream_pid(&it_); }
+    uint8_t coding_type() const { return mpls_stream_coding_type(&it_); }
+
+    /** @return ISO 639-2 code, or "" if the stream has none. */
+    std::string language() const
+    {
+        const char* language = mpls_stream_language(&it_);
+        return language != NULL ? std::string(language, 3) : std::string();
+    }
+
+    const mpls_stream_iter_t& raw() const { return it_; }
+
+private:
+    mpls_stream_iter_t it_;
+};
+
+typedef iterator<mpls_angle_iter_t, angle, mpls_angle_next> angle_iterator;
+typedef iterator<mpls_stream_iter_t, stream, mpls_stream_next> stream_iterator;
+
+class play_item {
+public:
+    explicit play_item(const mpls_play_item_iter_t& it) : it_(it) {}
+
+    int index() const { return it_.index; }
+    std::string filename() const { char name[11]; mpls_play_item_filename(&it_, name); return name; }
+    bool is_multi_angle() const { return mpls_play_item_is_multi_angle(&it_); }
+    int angle_count() const { return mpls_play_item_angle_count(&it_); }
+    uint8_t stc_id() const { return mpls_play_item_stc_id(&it_); }
+    int32_t time_in() const { return mpls_play_item_time_in(&it_); }
+    int32_t time_out() const { return mpls_play_item_time_out(&it_); }
+    uint64_t uo_mask() const { return mpls_play_item_uo_mask(&it_); }
+    const mpls_play_item_iter_t& raw() const { return it_; }
+
+    range<angle_iterator> angles() const
+    {
+        mpls_angle_iter_t it;
+        bool valid = mpls_play_item_angles(&it_, &it);
+        return range<angle_iterator>(angle_iterator(it, valid));
+    }
+
+    range<stream_iterator> streams() const
+    {
+        mpls_stream_iter_t it;
+        bool valid = mpls_play_item_streams(&it_, &it);
+        return range<stream_iterator>(stream_iterator(it, valid));
+    }
+
+private:
+    mpls_play_item_iter_t it_;
+};
+
+class mark {
+public:
+    explicit mark(const mpls_mark_iter_t& it) : it_(it) {}
+
+    int index() const { return it_.index; }
+    uint8_t type() const { return mpls_mark_type(&it_); }
+    uint16_t play_item() const { return mpls_mark_play_item(&it_); }
+    int32_t time() const { return mpls_mark_time(&it_); }
+    uint16_t entry_es_pid() const { return mpls_mark_entry_es_pid(&it_); }
+    int32_t duration() const { return mpls_mark_duration(&it_); }
+    const mpls_mark_iter_t& raw() const { return it_; }
+
+private:
+    mpls_mark_iter_t it_;
+};
+
+typedef iterator<mpls_play_item_iter_t, play_item, mpls_play_item_next> play_item_iterator;
+typedef iterator<mpls_mark_iter_t, mark, mpls_mark_next> mark_iterator;
+
+
+/*
+ * View
+ */
+
+
+class view {
+public:
+    /** @param mpls_file must have passed check_mpls() and outlive the view */
+    explicit view(const mpls_file_t& mpls_file) { mpls_view_init(&view_, &mpls_file); }
+
+    mpls_version_t version() const { return view_.version; }
+    int play_item_count() const { return view_.play_item_count; }
+    int mark_count() const { return view_.mark_count; }
+    const mpls_view_t& raw() const { return view_; }
+
+    range<play_item_iterator> play_items() const
+    {
+        mpls_play_item_iter_t it;
+        bool valid = mpls_view_play_items(&view_, &it);
+        return range<play_item_iterator>(play_item_iterator(it, valid));
+    }
+
+    range<mark_iterator> marks() const
+    {
+        mpls_mark_iter_t it;
+        bool valid = mpls_view_marks(&view_, &it);
+        return range<mark_iterator>(mark_iterator(it, valid));
+    }
+
+private:
+    mpls_view_t view_;
+};
+
+
+} // namespace mpls
+
+#endif	/* MPLS_VIEW_HPP */
@@ -0,0 +1,461 @@
+/*
+ * File:   mplsbin.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "mplsbin.h"
+#include "allocator.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/*
+ * Layout checks
+ */
+
+
+/* The records are read in place, so their layout must not depend on the ABI (-m32 or not) */
+_Static_assert(sizeof(mplsbin_header_t) == 72, "mplsbin_header_t layout");
+_Static_assert(sizeof(mplsbin_playlist_t) == 40, "mplsbin_playlist_t layout");
+_Static_assert(sizeof(mplsbin_clip_t) == 40, "mplsbin_clip_t layout");
+
+
+/*
+ * Private functions
+ */
+
+
+/* Longest time that fits the 15-byte "HH:MM:SS.mmm" buffers of format_duration_to() */
+#define MAX_TICKS ((int64_t) 999 * 3600 * 45000)
+
+#define FAIL(...) do { snprintf(error, error_size, __VA_ARGS__); return false; } while (0)
+
+static bool
+is_little_endian()
+{
+    const uint16_t one = 1;
+    return *(const uint8_t*) &one == 1;
+}
+
+static void*
+reserve(void* array, size_t* capacity, size_t needed, size_t size)
+{
+    size_t new_capacity = *capacity ? *capacity : 64;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+    if (new_capacity != *capacity)
+    {
+        array = realloc(array, new_capacity * size);
+        if (array == NULL)
+        {
+            DIE("Out of memory writing the binary output.");
+        }
+        *capacity = new_capacity;
+    }
+    return array;
+}
+
+static void
+rehash_strings(mplsbin_writer_t* writer, size_t slot_count)
+{
+    uint32_t* slots = (uint32_t*) calloc(slot_count, sizeof(uint32_t));
+    size_t i;
+
+    if (slots == NULL)
+    {
+        DIE("Out of memory writing the binary output.");
+    }
+
+    // Offset 0 is the empty string, which is never hashed, so 0 marks a free slot
+    for (i = 0; i < writer->string_slot_count; i++)
+    {
+        uint32_t offset = writer->string_slots[i];
+        size_t slot;
+        if (offset == 0)
+            continue;
+        slot = hash_string(writer->strings + offset) & (slot_count - 1);
+        while (slots[slot] != 0)
+            slot = (slot + 1) & (slot_count - 1);
+        slots[slot] = offset;
+    }
+
+    free(writer->string_slots);
+    writer->string_slots = slots;
+    writer->string_slot_count = slot_count;
+}
+
+/**
+ * @return Offset of str in the string table; equal strings are stored once.
+ */
+static uint32_t
+add_string(mplsbin_writer_t* writer, const char* str)
+{
+    size_t len = strlen(str);
+    size_t slot;
+    uint32_t offset;
+
+    if (len == 0)
+        return 0;
+
+    if ((writer->string_count + 1) * 2 > writer->string_slot_count)
+        rehash_strings(writer, writer->string_slot_count ? writer->string_slot_count * 2 : 256);
+
+    slot = hash_string(str) & (writer->string_slot_count - 1);
+    while (writer->string_slots[slot] != 0)
+    {
+        if (strcmp(writer->strings + writer->string_slots[slot], str) == 0)
+            return writer->string_slots[slot];
+        slot = (slot + 1) & (writer->string_slot_count - 1);
+    }
+
+    if (writer->string_size + len + 1 > UINT32_MAX)
+    {
+        DIE("Binary output string table is too large.");
+    }
+
+    writer->strings = (char*) reserve(writer->strings, &writer->string_capacity, writer->string_size + len + 1, sizeof(char));
+    offset = (uint32_t) writer->string_size;
+    memcpy(writer->strings + offset, str, len + 1);
+    writer->string_size += len + 1;
+    writer->string_slots[slot] = offset;
+    writer->string_count++;
+    return offset;
+}
+
+static bool
+check_table(const mplsbin_t* bin, uint64_t offset, uint64_t count, size_t record_size, const char* name,
+            char* error, size_t error_size)
+{
+    if (offset % 8 != 0 || offset < sizeof(mplsbin_header_t) || offset > bin->size ||
+        count > (bin->size - offset) / record_size)
+    {
+        FAIL("Invalid %s table: %llu records at offset %llu in a %zu-byte file.", name,
+             (unsigned long long) count, (unsigned long long) offset, bin->size);
+    }
+    return true;
+}
+
+
+/*
+ * Writer
+ */
+
+
+void
+init_mplsbin_writer_t(mplsbin_writer_t* writer)
+{
+    writer->playlists = NULL;
+    writer->playlist_count = 0;
+    writer->playlist_capacity = 0;
+    writer->clips = NULL;
+    writer->clip_count = 0;
+    writer->clip_capacity = 0;
+    writer->chapters = NULL;
+    writer->chapter_count = 0;
+    writer->chapter_capacity = 0;
+    writer->strings = NULL;
+    writer->string_size = 0;
+    writer->string_capacity = 0;
+    writer->string_slots = NULL;
+    writer->string_slot_count = 0;
+    writer->string_count = 0;
+
+    // Offset 0 is the empty string
+    writer->strings = (char*) reserve(writer->strings, &writer->string_capacity, 1, sizeof(char));
+    writer->strings[0] = '\0';
+    writer->string_size = 1;
+}
+
+void
+free_mplsbin_writer_members(mplsbin_writer_t* writer)
+{
+    free(writer->playlists); writer->playlists = NULL;
+    free(writer->clips); writer->clips = NULL;
+    free(writer->chapters); writer->chapters = NULL;
+    free(writer->strings); writer->strings = NULL;
+    free(writer->string_slots); writer->string_slots = NULL;
+    writer->playlist_count = writer->clip_count = writer->chapter_count = 0;
+    writer->playlist_capacity = writer->clip_capacity = writer->chapter_capacity = 0;
+    writer->string_size = writer->string_capacity = 0;
+    writer->string_slot_count = writer->string_count = 0;
+}
+
+void
+mplsbin_writer_add(mplsbin_writer_t* writer, const char* path, const playlist_t* playlist)
+{
+    mplsbin_playlist_t* record;
+    stream_clip_t* clip;
+    size_t i;
+
+    if (writer->clip_count + playlist->stream_clip_list.count > UINT32_MAX ||
+        writer->chapter_count + playlist->chapter_count > UINT32_MAX)
+    {
+        DIE("Too many playlists for one binary output.");
+    }
+
+    writer->playlists = (mplsbin_playlist_t*) reserve(writer->playlists, &writer->playlist_capacity,
+                                                      writer->playlist_count + 1, sizeof(mplsbin_playlist_t));
+    record = &writer->playlists[writer->playlist_count++];
+    memset(record, 0, sizeof(*record));
+
+    record->path = add_string(writer, path);
+    record->filename = add_string(writer, playlist->filename);
+    record->first_clip = (uint32_t) writer->clip_count;
+    record->first_chapter = (uint32_t) writer->chapter_count;
+    record->fields = (uint32_t) (playlist->fields & MPLSBIN_FIELDS);
+    record->mpls_version = (uint8_t) playlist->version;
+
+    writer->clips = (mplsbin_clip_t*) reserve(writer->clips, &writer->clip_capacity,
+                                              writer->clip_count + playlist->stream_clip_list.count, sizeof(mplsbin_clip_t));
+    for (clip = playlist->stream_clip_list.first; clip != NULL; clip = clip->next)
+    {
+        mplsbin_clip_t* out = &writer->clips[writer->clip_count++];
+        memset(out, 0, sizeof(*out));
+
+        out->stream_file_size = clip->stream_file_size;
+        out->clip_info_size = clip->clip_info_size;
+        out->time_in = (int32_t) sec_to_timecode(clip->time_in_sec);
+        out->time_out = (int32_t) sec_to_timecode(clip->time_out_sec);
+        out->filename = add_string(writer, clip->filename);
+        out->video_count = (uint8_t) clip->video_count;
+        out->audio_count = (uint8_t) clip->audio_count;
+        out->subtitle_count = (uint8_t) clip->subtitle_count;
+        out->interactive_menu_count = (uint8_t) clip->interactive_menu_count;
+        out->secondary_video_count = (uint8_t) clip->secondary_video_count;
+        out->secondary_audio_count = (uint8_t) clip->secondary_audio_count;
+        out->pip_count = (uint8_t) clip->pip_count;
+        out->video_coding_type = clip->video_coding_type;
+        out->dynamic_range = clip->dynamic_range;
+        out->color_space = clip->color_space;
+        out->hdr_plus = clip->hdr_plus;
+        record->clip_count++;
+    }
+    record->duration_ticks = sec_to_timecode(playlist->duration_sec);
+
+    writer->chapters = (int64_t*) reserve(writer->chapters, &writer->chapter_capacity,
+                                          writer->chapter_count + playlist->chapter_count, sizeof(int64_t));
+    for (i = 0; i < playlist->chapter_count; i++)
+        writer->chapters[writer->chapter_count++] = sec_to_timecode(playlist->chapters[i]);
+    record->chapter_count = (uint32_t) playlist->chapter_count;
+}
+
+bool
+mplsbin_writer_write(mplsbin_writer_t* writer, FILE* out)
+{
+    mplsbin_header_t header;
+
+    // Records are written as they are laid out in memory
+    if (!is_little_endian())
+        return false;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MPLSBIN_MAGIC, sizeof(header.magic));
+    header.version = MPLSBIN_VERSION;
+    header.header_size = sizeof(mplsbin_header_t);
+    header.playlist_count = (uint32_t) writer->playlist_count;
+    header.clip_count = (uint32_t) writer->clip_count;
+    header.chapter_count = (uint32_t) writer->chapter_count;
+    header.string_table_size = (uint32_t) writer->string_size;
+
+    // Every record size is a multiple of 8, so the tables need no padding
+    header.playlists_offset = sizeof(mplsbin_header_t);
+    header.clips_offset = header.playlists_offset + writer->playlist_count * sizeof(mplsbin_playlist_t);
+    header.chapters_offset = header.clips_offset + writer->clip_count * sizeof(mplsbin_clip_t);
+    header.strings_offset = header.chapters_offset + writer->chapter_count * sizeof(int64_t);
+    header.file_size = header.strings_offset + writer->string_size;
+
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(writer->playlists, sizeof(mplsbin_playlist_t), writer->playlist_count, out);
+    fwrite(writer->clips, sizeof(mplsbin_clip_t), writer->clip_count, out);
+    fwrite(writer->chapters, sizeof(int64_t), writer->chapter_count, out);
+    fwrite(writer->strings, sizeof(char), writer->string_size, out);
+
+    return fflush(out) == 0 && !ferror(out);
+}
+
+
+/*
+ * Reader
+ */
+
+
+bool
+mplsbin_open(mplsbin_t* bin, const void* data, size_t size, char* error, size_t error_size)
+{
+    const mplsbin_header_t* header = (const mplsbin_header_t*) data;
+    size_t i;
+
+    memset(bin, 0, sizeof(*bin));
+    bin->data = (const char*) data;
+    bin->size = size;
+
+    if (!is_little_endian())
+        FAIL("Binary playlist files are not supported on big-endian hosts.");
+    if ((uintptr_t) data % 8 != 0)
+        FAIL("Binary playlist data is not 8-byte aligned.");
+    if (size < sizeof(mplsbin_header_t) || memcmp(header->magic, MPLSBIN_MAGIC, sizeof(header->magic)) != 0)
+        FAIL("Not a binary playlist file (bad magic).");
+    if (header->version != MPLSBIN_VERSION)
+        FAIL("Unsupported binary playlist version %u (expected %u).", header->version, MPLSBIN_VERSION);
+    if (header->header_size != sizeof(mplsbin_header_t))
+        FAIL("Invalid header size: %u.", header->header_size);
+    if (header->file_size != size)
+        FAIL("Truncated binary playlist file: header says %llu bytes, found %zu.", (unsigned long long) header->file_size, size);
+
+    if (!check_table(bin, header->playlists_offset, header->playlist_count, sizeof(mplsbin_playlist_t), "playlist", error, error_size) ||
+        !check_table(bin, header->clips_offset, header->clip_count, sizeof(mplsbin_clip_t), "clip", error, error_size) ||
+        !check_table(bin, header->chapters_offset, header->chapter_count, sizeof(int64_t), "chapter", error, error_size) ||
+        !check_table(bin, header->strings_offset, header->string_table_size, sizeof(char), "string", error, error_size))
+        return false;
+    if (header->string_table_size == 0 || bin->data[header->strings_offset + header->string_table_size - 1] != '\0')
+        FAIL("Invalid string table: not NUL-terminated.");
+
+    bin->header = header;
+    bin->playlists = (const mplsbin_playlist_t*) (bin->data + header->playlists_offset);
+    bin->clips = (const mplsbin_clip_t*) (bin->data + header->clips_offset);
+    bin->chapters = (const int64_t*) (bin->data + header->chapters_offset);
+    bin->strings = bin->data + header->strings_offset;
+
+    // Every index, offset and time, so the accessors and formatters need no checks of their own
+    for (i = 0; i < header->clip_count; i++)
+    {
+        const mplsbin_clip_t* clip = &bin->clips[i];
+        if (clip->filename >= header->string_table_size)
+            FAIL("Invalid clip %zu: string offset out of bounds.", i + 1);
+        if (clip->time_in < 0 || clip->time_out < clip->time_in)
+            FAIL("Invalid clip %zu: time range out of order.", i + 1);
+    }
+    for (i = 0; i < header->chapter_count; i++)
+    {
+        if (bin->chapters[i] < 0 || bin->chapters[i] > MAX_TICKS)
+            FAIL("Invalid chapter %zu: time out of range.", i + 1);
+    }
+    for (i = 0; i < header->playlist_count; i++)
+    {
+        const mplsbin_playlist_t* playlist = &bin->playlists[i];
+        int64_t duration = 0;
+        uint32_t c;
+
+        if ((uint64_t) playlist->first_clip + playlist->clip_count > header->clip_count ||
+            (uint64_t) playlist->first_chapter + playlist->chapter_count > header->chapter_count)
+            FAIL("Invalid playlist %zu: clip or chapter range out of bounds.", i + 1);
+        if (playlist->path >= header->string_table_size || playlist->filename >= header->string_table_size)
+            FAIL("Invalid playlist %zu: string offset out of bounds.", i + 1);
+        if (playlist->mpls_version >= MPLS_VERSION_COUNT)
+            FAIL("Invalid playlist %zu: unknown MPLS version %u.", i + 1, playlist->mpls_version);
+
+        for (c = 0; c < playlist->clip_count && duration <= MAX_TICKS; c++)
+            duration += bin->clips[playlist->first_clip + c].time_out - bin->clips[playlist->first_clip + c].time_in;
+        if (playlist->duration_ticks < 0 || playlist->duration_ticks > MAX_TICKS || duration > MAX_TICKS)
+            FAIL("Invalid playlist %zu: duration out of range.", i + 1);
+    }
+
+    return true;
+}
+
+bool
+mplsbin_map(mplsbin_t* bin, const char* path, char* error, size_t error_size)
+{
+    struct stat st;
+    void* data;
+    int fd;
+
+    memset(bin, 0, sizeof(*bin));
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        FAIL("Unable to open \"%s\": %s.", path, strerror(errno));
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        FAIL("Unable to map \"%s\": empty or unreadable file.", path);
+    }
+
+    data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        FAIL("Unable to map \"%s\": %s.", path, strerror(errno));
+
+    if (!mplsbin_open(bin, data, (size_t) st.st_size, error, error_size))
+    {
+        munmap(data, (size_t) st.st_size);
+        memset(bin, 0, sizeof(*bin));
+        return false;
+    }
+
+    bin->mapped = true;
+    return true;
+}
+
+void
+mplsbin_close(mplsbin_t* bin)
+{
+    if (bin->mapped)
+        munmap((void*) bin->data, bin->size);
+    memset(bin, 0, sizeof(*bin));
+}
+
+void
+mplsbin_to_playlist(const mplsbin_t* bin, const mplsbin_playlist_t* record, playlist_t* playlist)
+{
+    const mplsbin_clip_t* clips = mplsbin_clips(bin, record);
+    const int64_t* chapters = mplsbin_chapters(bin, record);
+    uint32_t i;
+
+    snprintf(playlist->filename, sizeof(playlist->filename), "%s", mplsbin_string(bin, record->filename));
+    playlist->fields = (int) record->fields;
+    playlist->version = (mpls_version_t) record->mpls_version;
+
+    // Same arithmetic as parse_stream_clips(), so the durations print identically
+    playlist->duration_sec = 0;
+    for (i = 0; i < record->clip_count; i++)
+    {
+        const mplsbin_clip_t* in = &clips[i];
+        stream_clip_t* clip = (stream_clip_t*) MPLS_CALLOC(1, sizeof(stream_clip_t));
+        init_stream_clip_t(clip);
+
+        snprintf(clip->filename, sizeof(clip->filename), "%s", mplsbin_string(bin, in->filename));
+        clip->time_in_sec = timecode_to_sec(in->time_in);
+        clip->time_out_sec = timecode_to_sec(in->time_out);
+        clip->duration_sec = clip->time_out_sec - clip->time_in_sec;
+        clip->relative_time_in_sec = playlist->duration_sec;
+        clip->relative_time_out_sec = clip->relative_time_in_sec + clip->duration_sec;
+        playlist->duration_sec += clip->duration_sec;
+
+        clip->video_count = in->video_count;
+        clip->audio_count = in->audio_count;
+        clip->subtitle_count = in->subtitle_count;
+        clip->interactive_menu_count = in->interactive_menu_count;
+        clip->secondary_video_count = in->secondary_video_count;
+        clip->secondary_audio_count = in->secondary_audio_count;
+        clip->pip_count = in->pip_count;
+        clip->track_count = in->video_count + in->audio_count + in->subtitle_count + in->interactive_menu_count +
+                            in->secondary_video_count + in->secondary_audio_count;
+        clip->video_coding_type = in->video_coding_type;
+        clip->dynamic_range = in->dynamic_range;
+        clip->color_space = in->color_space;
+        clip->hdr_plus = in->hdr_plus != 0;
+        clip->stream_file_size = in->stream_file_size;
+        clip->clip_info_size = in->clip_info_size;
+
+        add_stream_clip(&playlist->stream_clip_list, clip);
+        add_stream_clip(&playlist->chapter_stream_clip_list, clip);
+    }
+
+    // Clips are only stored when the playlist was parsed with a field that needs them
+    if (record->clip_count == 0)
+        playlist->duration_sec = record->duration_ticks / TIMECODE_DIV;
+    format_duration_to(playlist->duration_sec, playlist->duration_formatted);
+
+    playlist->chapters = (double*) MPLS_CALLOC(record->chapter_count + 1, sizeof(double));
+    for (i = 0; i < record->chapter_count; i++)
+        playlist->chapters[i] = chapters[i] / TIMECODE_DIV;
+    playlist->chapter_count = record->chapter_count;
+}
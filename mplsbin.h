@@ -0,0 +1,244 @@
+/*
+ * File:   mplsbin.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Compact binary format for parsed playlists (--format=bin).
+ *
+ * A file holds any number of playlists (typically one disc) as fixed-size,
+ * little-endian records in four contiguous, 8-byte aligned tables:
+ *
+ *   header | playlists | clips | chapter ticks | string table
+ *
+ * Playlists refer to their clips and chapters by index range and to their
+ * names by string table offset, so a stored file can be mmap'd, checked
+ * once by mplsbin_open() and then read in place: the accessors below are
+ * plain pointer arithmetic.  All record layouts are identical on 32- and
+ * 64-bit hosts (every 64-bit field is 8-byte aligned, every record size is
+ * a multiple of 8).  Big-endian hosts are not supported.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef MPLSBIN_H
+#define	MPLSBIN_H
+
+#include "parse_mpls.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+#define MPLSBIN_MAGIC   "MPLSBIN"    /* 8 bytes including the NUL */
+#define MPLSBIN_VERSION 1
+
+/* Sections a stored playlist can carry; AppInfoPlayList and ExtensionData are not stored */
+#define MPLSBIN_FIELDS (FIELD_DURATION | FIELD_CLIPS | FIELD_TRACKS | FIELD_CHAPTERS | FIELD_STREAMS | FIELD_FILE_SIZES)
+
+
+/*
+ * Structs - on-disk records
+ */
+
+
+typedef struct {
+    char magic[8];               /* MPLSBIN_MAGIC */
+    uint16_t version;            /* MPLSBIN_VERSION */
+    uint16_t header_size;        /* sizeof(mplsbin_header_t) */
+    uint32_t playlist_count;
+    uint32_t clip_count;         /* total, all playlists */
+    uint32_t chapter_count;      /* total, all playlists */
+    uint32_t string_table_size;
+    uint32_t reserved;
+    uint64_t playlists_offset;   /* byte offsets from the start of the file */
+    uint64_t clips_offset;
+    uint64_t chapters_offset;
+    uint64_t strings_offset;
+    uint64_t file_size;
+} mplsbin_header_t;
+
+typedef struct {
+    int64_t duration_ticks;      /* 45 kHz */
+    uint32_t path;               /* string table offsets */
+    uint32_t filename;           /* e.g., "00800.MPLS" */
+    uint32_t first_clip;         /* index into the clip table */
+    uint32_t clip_count;
+    uint32_t first_chapter;      /* index into the chapter table */
+    uint32_t chapter_count;
+    uint32_t fields;             /* FIELD_* sections that were decoded */
+    uint8_t mpls_version;        /* mpls_version_t */
+    uint8_t reserved[3];
+} mplsbin_playlist_t;
+
+typedef struct {
+    int64_t stream_file_size;    /* 0 if unknown */
+    int64_t clip_info_size;      /* 0 if unknown */
+    int32_t time_in;             /* 45 kHz ticks */
+    int32_t time_out;
+    uint32_t filename;           /* string table offset, e.g., "00800.M2TS" */
+    uint8_t video_count;
+    uint8_t audio_count;
+    uint8_t subtitle_count;
+    uint8_t interactive_menu_count;
+    uint8_t secondary_video_count;
+    uint8_t secondary_audio_count;
+    uint8_t pip_count;
+    uint8_t video_coding_type;
+    uint8_t dynamic_range;
+    uint8_t color_space;
+    uint8_t hdr_plus;
+    uint8_t reserved;
+} mplsbin_clip_t;
+
+
+/*
+ * Structs - in memory
+ */
+
+
+typedef struct {
+    mplsbin_playlist_t* playlists;
+    size_t playlist_count;
+    size_t playlist_capacity;
+    mplsbin_clip_t* clips;
+    size_t clip_count;
+    size_t clip_capacity;
+    int64_t* chapters;
+    size_t chapter_count;
+    size_t chapter_capacity;
+    char* strings;
+    size_t string_size;
+    size_t string_capacity;
+    uint32_t* string_slots;      /* open-addressing hash of string offsets, for de-duplication */
+    size_t string_slot_count;
+    size_t string_count;
+} mplsbin_writer_t;
+
+typedef struct {
+    const char* data;
+    size_t size;
+    const mplsbin_header_t* header;
+    const mplsbin_playlist_t* playlists;
+    const mplsbin_clip_t* clips;
+    const int64_t* chapters;
+    const char* strings;
+    bool mapped;                 /* data is an mmap() owned by this struct */
+} mplsbin_t;
+
+
+/*
+ * Accessors
+ *
+ * Only valid after mplsbin_open() or mplsbin_map() succeeded.
+ */
+
+
+static inline size_t
+mplsbin_playlist_count(const mplsbin_t* bin)
+{
+    return bin->header->playlist_count;
+}
+
+static inline const mplsbin_playlist_t*
+mplsbin_playlist(const mplsbin_t* bin, size_t index)
+{
+    return &bin->playlists[index];
+}
+
+static inline const mplsbin_clip_t*
+mplsbin_clips(const mplsbin_t* bin, const mplsbin_playlist_t* playlist)
+{
+    return &bin->clips[playlist->first_clip];
+}
+
+static inline const int64_t*
+mplsbin_chapters(const mplsbin_t* bin, const mplsbin_playlist_t* playlist)
+{
+    return &bin->chapters[playlist->first_chapter];
+}
+
+static inline const char*
+mplsbin_string(const mplsbin_t* bin, uint32_t offset)
+{
+    return bin->strings + offset;
+}
+
+
+/*
+ * Functions
+ */
+
+
+void
+init_mplsbin_writer_t(mplsbin_writer_t* writer);
+
+void
+free_mplsbin_writer_members(mplsbin_writer_t* writer);
+
+/**
+ * Appends a parsed playlist.
+ * @param writer
+ * @param path stored as the playlist's path
+ * @param playlist
+ */
+void
+mplsbin_writer_add(mplsbin_writer_t* writer, const char* path, const playlist_t* playlist);
+
+/**
+ * Writes the header and all tables.
+ * @param writer
+ * @param out
+ * @return false on a write error (or a big-endian host).
+ */
+bool
+mplsbin_writer_write(mplsbin_writer_t* writer, FILE* out);
+
+/**
+ * Checks a stored file (magic, version, table extents, every index and
+ * string offset) and points the accessors into it.  Nothing is copied.
+ * @param bin
+ * @param data must stay valid (and 8-byte aligned) while bin is in use
+ * @param size
+ * @param error receives a message if the data is invalid
+ * @param error_size
+ * @return false if the data is invalid.
+ */
+bool
+mplsbin_open(mplsbin_t* bin, const void* data, size_t size, char* error, size_t error_size);
+
+/**
+ * mmap()s a stored file read-only and opens it with mplsbin_open().
+ * @return false if the file cannot be mapped or is invalid.
+ */
+bool
+mplsbin_map(mplsbin_t* bin, const char* path, char* error, size_t error_size);
+
+/**
+ * Unmaps a file mapped by mplsbin_map(); no-op otherwise.
+ * @param bin
+ */
+void
+mplsbin_close(mplsbin_t* bin);
+
+/**
+ * Rebuilds a playlist_t from a stored record, e.g., to print it with
+ * format_playlist().  Release with free_playlist_members().
+ * @param bin
+ * @param record
+ * @param playlist initialized with create_playlist_t()
+ */
+void
+mplsbin_to_playlist(const mplsbin_t* bin, const mplsbin_playlist_t* record, playlist_t* playlist);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* MPLSBIN_H */
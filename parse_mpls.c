@@ -7,6 +7,20 @@
 
 
 #include "parse_mpls.h"
+#include "allocator.h"
+#include "catalog.h"
+#include "playlist_index.h"
+#include "pipeline.h"
+#include "disc.h"
+#include "stats.h"
+#include "ingest.h"
+#include "mplsbin.h"
+#include "watch.h"
+#include "verify.h"
+#include "bitrate.h"
+#include "fingerprint.h"
+#include "quickcheck.h"
+#include "chapter_export.h"
 
 
 /*
@@ -31,10 +45,16 @@ timecode_to_sec(int32_t timecode)
     return (double)timecode / TIMECODE_DIV;
 }
 
+int64_t
+sec_to_timecode(double sec)
+{
+    return llround(sec * TIMECODE_DIV);
+}
+
 char*
 format_duration(double length_sec)
 {
-    char* str = (char*) calloc(15, sizeof(char));
+    char* str = (char*) MPLS_CALLOC(15, sizeof(char));
     format_duration_to(length_sec, str);
     return str;
 }
@@ -45,6 +65,28 @@ format_duration_to(double length_sec, char* dest)
     sprintf(dest, "%02.0f:%02.0f:%06.3f", floor(length_sec / 3600), floor(fmod(length_sec, 3600) / 60), fmod(length_sec, 60));
 }
 
+int
+format_ticks_to(int64_t ticks, int decimals, char* dest)
+{
+    int64_t scale = 1;
+    int64_t units;
+    int64_t seconds;
+    int i;
+
+    for (i = 0; i < decimals; i++)
+        scale *= 10;
+
+    // Round once, in fractional units, so a carry reaches the seconds and minutes
+    units = (ticks * scale + (int64_t) TIMECODE_DIV / 2) / (int64_t) TIMECODE_DIV;
+    seconds = units / scale;
+
+    if (decimals == 0)
+        return sprintf(dest, "%02lli:%02lli:%02lli", (long long) (seconds / 3600), (long long) (seconds / 60 % 60),
+                       (long long) (seconds % 60));
+    return sprintf(dest, "%02lli:%02lli:%02lli.%0*lli", (long long) (seconds / 3600), (long long) (seconds / 60 % 60),
+                   (long long) (seconds % 60), decimals, (long long) (units % scale));
+}
+
 
 /*
  * Linked list functions
@@ -127,10 +169,10 @@ get_int32(char* bytes)
     uint8_t b3 = (uint8_t) bytes[2];
     uint8_t b4 = (uint8_t) bytes[3];
 //    printf("%02x %02x %02x %02x \n", b1, b2, b3, b4);
-    return (b1 << 24) |
-           (b2 << 16) |
-           (b3 <<  8) |
-           (b4 <<  0);
+    return (int32_t) (((uint32_t) b1 << 24) |
+                      ((uint32_t) b2 << 16) |
+                      ((uint32_t) b3 <<  8) |
+                      ((uint32_t) b4 <<  0));
 }
 
 int16_t
@@ -153,7 +195,7 @@ char*
 file_read_string(FILE* file, int offset, int length)
 {
     // Allocate an empty string initialized to all NULL chars
-    char* chars = (char*) calloc(length + 1, sizeof(char));
+    char* chars = (char*) MPLS_CALLOC(length + 1, sizeof(char));
     
     // Jump to the requested position (byte offset) in the file
     fseek(file, offset, SEEK_SET);
@@ -184,12 +226,22 @@ file_read_string_cursor(FILE* file, int* offset, int length)
 char*
 copy_string_cursor(char* bytes, int* offset, int length)
 {
-    char* str = (char*) calloc(length + 1, sizeof(char));
+    char* str = (char*) MPLS_CALLOC(length + 1, sizeof(char));
     strncpy(str, bytes + *offset, length);
     *offset += length;
     return str;
 }
 
+uint32_t
+hash_string(const char* str)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*str != '\0')
+        hash = (hash ^ (uint8_t) *str++) * 16777619u;
+    return hash;
+}
+
 
 /*
  * Struct initialization
@@ -215,9 +267,11 @@ init_mpls_file_t(mpls_file_t* mpls_file)
     mpls_file->data = NULL;
     for (i = 0; i < 9; i++)
         mpls_file->header[i] = 0;
+    mpls_file->version = MPLS_VERSION_0100;
     mpls_file->pos = 0;
     mpls_file->playlist_pos = 0;
     mpls_file->chapter_pos = 0;
+    mpls_file->extension_pos = 0;
     mpls_file->total_chapter_count = 0;
     mpls_file->time_in = 0;
     mpls_file->time_out = 0;
@@ -250,6 +304,12 @@ init_stream_clip_t(stream_clip_t* stream_clip)
     stream_clip->secondary_video_count = 0;
     stream_clip->secondary_audio_count = 0;
     stream_clip->pip_count = 0;
+    stream_clip->video_coding_type = 0;
+    stream_clip->dynamic_range = 0;
+    stream_clip->color_space = 0;
+    stream_clip->hdr_plus = false;
+    stream_clip->stream_file_size = 0;
+    stream_clip->clip_info_size = 0;
     stream_clip->index = 0;
     stream_clip->next = NULL;
 }
@@ -282,6 +342,12 @@ init_playlist_t(playlist_t* playlist)
         playlist->duration_formatted[i] = 0;
     playlist->chapters = NULL;
     playlist->chapter_count = 0;
+    playlist->marks = NULL;
+    playlist->mark_count = 0;
+    playlist->fields = 0;
+    playlist->version = MPLS_VERSION_0100;
+    memset(&playlist->app_info, 0, sizeof(playlist->app_info));
+    memset(&playlist->extensions, 0, sizeof(playlist->extensions));
     init_stream_clip_list_t(&playlist->stream_clip_list);
     init_stream_clip_list_t(&playlist->chapter_stream_clip_list);
 }
@@ -300,7 +366,7 @@ free_stream_clip_list(stream_clip_list_t* list)
     while (clip != NULL)
     {
         next = clip->next;
-        free(clip);
+        MPLS_FREE(clip);
         clip = next;
     }
     list->first = list->last = NULL;
@@ -310,8 +376,12 @@ free_stream_clip_list(stream_clip_list_t* list)
 void
 free_mpls_file_members(mpls_file_t* mpls_file)
 {
-    free(mpls_file->path); mpls_file->path = NULL;
-    free(mpls_file->data); mpls_file->data = NULL;
+    if (mpls_file->file != NULL)
+    {
+        fclose(mpls_file->file); mpls_file->file = NULL;
+    }
+    MPLS_FREE(mpls_file->path); mpls_file->path = NULL;
+    MPLS_FREE(mpls_file->data); mpls_file->data = NULL;
 }
 
 void
@@ -321,7 +391,8 @@ free_playlist_members(playlist_t* playlist)
     // playlist.chapter_stream_clip_list only contains a subset.
     // So we only need to free .stream_clip_list nodes.
     free_stream_clip_list(&playlist->stream_clip_list);
-    free(playlist->chapters); playlist->chapters = NULL;
+    MPLS_FREE(playlist->chapters); playlist->chapters = NULL;
+    MPLS_FREE(playlist->marks); playlist->marks = NULL;
 }
 
 
@@ -338,97 +409,333 @@ copy_header(char* header, char* data, int* offset)
 }
 
 
+/*
+ * Fills the caller's error buffer and returns false from a validation function.
+ * Expects `char* error` and `size_t error_size` to be in scope.
+ */
+#define FAIL(...) do { snprintf(error, error_size, __VA_ARGS__); return false; } while (0)
+
+
 /*
  * Main parsing functions
  */
 
 
-mpls_file_t
-init_mpls(char* path)
+static const char* mpls_version_headers[MPLS_VERSION_COUNT] = {
+    "MPLS0100",
+    "MPLS0200",
+    "MPLS0300"
+};
+
+bool
+read_mpls_header(mpls_file_t* mpls_file, char* error, size_t error_size)
 {
-    mpls_file_t mpls_file = create_mpls_file_t();
+    char* data = mpls_file->data;
+    int* pos_ptr = &(mpls_file->pos);
+    int i;
+    *pos_ptr = 0;
 
-    mpls_file.path = realpath(path, NULL);
-    if (mpls_file.path == NULL)
+    if (mpls_file->size < 90)
     {
-        DIE("Unable to get the full path (realpath) of \"%s\".", path);
+        FAIL("Invalid MPLS file (too small): \"%s\".", mpls_file->path);
     }
     
-    mpls_file.name = basename(mpls_file.path);
-    if (mpls_file.name == NULL)
+    // Verify header and decode the version once; everything after dispatches on it
+    copy_header(mpls_file->header, data, pos_ptr);
+    for (i = 0; i < MPLS_VERSION_COUNT; i++)
+    {
+        if (strncmp(mpls_version_headers[i], mpls_file->header, 8) == 0)
+            break;
+    }
+    if (i == MPLS_VERSION_COUNT)
     {
-        DIE("Unable to get the file name (basename) of \"%s\".", path);
+        FAIL("Invalid header in \"%s\": expected MPLS0100, MPLS0200 or MPLS0300, found \"%s\".", mpls_file->path, mpls_file->header);
     }
+    mpls_file->version = (mpls_version_t) i;
     
-    mpls_file.file = fopen(mpls_file.path, "r");
-    if (mpls_file.file == NULL)
+    // Verify playlist offset
+    mpls_file->playlist_pos = get_int32_cursor(data, pos_ptr);
+    if (mpls_file->playlist_pos <= 8 || mpls_file->playlist_pos > mpls_file->size - PLAYLIST_HEADER_SIZE)
     {
-        DIE("Unable to open \"%s\" for reading.", mpls_file.path);
+        FAIL("Invalid playlists offset: %i.", mpls_file->playlist_pos);
     }
-
-    mpls_file.size = file_get_length(mpls_file.file);
-    if (mpls_file.size < 90)
+    
+    // Verify chapter offset
+    int32_t chaptersPos = get_int32_cursor(data, pos_ptr);
+    if (chaptersPos <= 8 || chaptersPos > mpls_file->size - 6)
     {
-        DIE("Invalid MPLS file (too small): \"%s\".", mpls_file.path);
+        FAIL("Invalid chapters offset: %i.", chaptersPos);
     }
     
-    mpls_file.data = file_read_string(mpls_file.file, 0, mpls_file.size);
+    // ExtensionData offset (0 = none); checked by validate_mpls_sections()
+    mpls_file->extension_pos = get_int32_cursor(data, pos_ptr);
+
+    int chapterCountPos = chaptersPos + 4;
+    mpls_file->chapter_pos = chaptersPos + 6;
     
-    char* data = mpls_file.data;
-    int* pos_ptr = &(mpls_file.pos);
+    // Verify chapter count
+    mpls_file->total_chapter_count = get_int16(data + chapterCountPos);
+    if (mpls_file->total_chapter_count < 0 ||
+        mpls_file->chapter_pos + (int64_t) mpls_file->total_chapter_count * CHAPTER_SIZE > mpls_file->size)
+    {
+        FAIL("Invalid chapter count: %i.", mpls_file->total_chapter_count);
+    }
     
-    // Verify header
-    copy_header(mpls_file.header, data, pos_ptr);
-    if (strncmp("MPLS0100", mpls_file.header, 8) != 0 &&
-        strncmp("MPLS0200", mpls_file.header, 8) != 0)
+    // Verify Time IN
+    mpls_file->time_in = get_int32(data + TIME_IN_POS);
+    if (mpls_file->time_in < 0)
     {
-        DIE("Invalid header in \"%s\": expected MPLS0100 or MPLS0200, found \"%s\".", mpls_file.path, mpls_file.header);
+        FAIL("Invalid playlist time in: %i.", mpls_file->time_in);
     }
     
-    // Verify playlist offset
-    mpls_file.playlist_pos = get_int32_cursor(data, pos_ptr);
-    if (mpls_file.playlist_pos <= 8)
+    // Verify Time OUT
+    mpls_file->time_out = get_int32(data + TIME_OUT_POS);
+    if (mpls_file->time_out < 0)
     {
-        DIE("Invalid playlists offset: %i.", mpls_file.playlist_pos);
+        FAIL("Invalid playlist time out: %i.", mpls_file->time_out);
     }
     
-    // Verify chapter offset
-    int32_t chaptersPos = get_int32_cursor(data, pos_ptr);
-    if (chaptersPos <= 8)
+    return true;
+}
+
+/**
+ * Checks the ExtensionData directory and that every entry lies inside the block.
+ * @return false if ExtensionData is malformed.
+ */
+static bool
+check_extension_data(mpls_file_t* mpls_file)
+{
+    char* data = mpls_file->data;
+    int64_t ext = mpls_file->extension_pos;
+    int64_t end;
+    int count;
+    int i;
+
+    if (ext < APP_INFO_POS || ext + 12 > mpls_file->size)
+        return false;
+
+    // length (4), data block start address (4), reserved (3), entry count (1)
+    end = ext + 4 + (uint32_t) get_int32(data + ext);
+    count = (uint8_t) data[ext + 11];
+    if (end > mpls_file->size || ext + 12 + (int64_t) count * EXTENSION_ENTRY_SIZE > end)
+        return false;
+
+    for (i = 0; i < count; i++)
+    {
+        char* entry = data + ext + 12 + i * EXTENSION_ENTRY_SIZE;
+        int64_t start = (uint32_t) get_int32(entry + 4);
+        int64_t length = (uint32_t) get_int32(entry + 8);
+        if (ext + start + length > end)
+            return false;
+    }
+
+    return true;
+}
+
+bool
+validate_mpls_sections(mpls_file_t* mpls_file, char* error, size_t error_size)
+{
+    char* data = mpls_file->data;
+    int64_t size = mpls_file->size;
+    int64_t pos = mpls_file->playlist_pos;
+    int i;
+
+    // Playlist section: length (4), reserved (2), PlayItem count (2), SubPath count (2).
+    // read_mpls_header() already checked that it fits in the file.
+    int16_t stream_clip_count = get_int16(data + pos + 6);
+    if (stream_clip_count < 0)
+    {
+        FAIL("Invalid stream clip count: %i.", stream_clip_count);
+    }
+    pos += PLAYLIST_HEADER_SIZE;
+
+    // Walk the PlayItems by their length fields only, checking that each one
+    // fits in the file and is long enough for every field the parser reads.
+    for (i = 0; i < stream_clip_count; i++)
+    {
+        if (pos + 2 > size)
+        {
+            FAIL("Stream clip %i starts past the end of the file (offset %lli).", i, (long long) pos);
+        }
+
+        int64_t length = (uint16_t) get_int16(data + pos);
+        int64_t required = PLAY_ITEM_FIXED_SIZE;
+        if (pos + 2 + length > size)
+        {
+            FAIL("Stream clip %i (%lli bytes at offset %lli) extends past the end of the file.", i, (long long) length, (long long) pos);
+        }
+
+        if (length >= required && ((data[pos + 12] >> 4) & 0x01))
+        {
+            // Angle count (1) and flags (1) must be inside the PlayItem before the count is read
+            if (length < required + 2)
+            {
+                FAIL("Stream clip %i is too short for its angle count: %lli bytes.", i, (long long) length);
+            }
+            int angles = (uint8_t) data[pos + 2 + PLAY_ITEM_FIXED_SIZE];
+            required += 2;
+            if (angles > 1)
+                required += (int64_t) (angles - 1) * PLAY_ITEM_ANGLE_SIZE;
+        }
+        required += STN_HEADER_SIZE;
+
+        if (length < required)
+        {
+            FAIL("Stream clip %i is too short: %lli bytes, expected at least %lli.", i, (long long) length, (long long) required);
+        }
+
+        // MPLS0300 also reads the first primary video stream entry and its attributes
+        int64_t stn = pos + 2 + required - STN_HEADER_SIZE;
+        if (mpls_file->version >= MPLS_VERSION_0300 && data[stn + 4] != 0)
+        {
+            int64_t end = pos + 2 + length;
+            int64_t attributes = stn + STN_HEADER_SIZE;
+            if (attributes < end)
+                attributes += 1 + (uint8_t) data[attributes];
+            if (attributes >= end || attributes + 1 + (uint8_t) data[attributes] > end)
+            {
+                FAIL("Stream clip %i has a truncated video stream entry.", i);
+            }
+        }
+
+        pos += 2 + length;
+    }
+
+    // Chapter marks: read_mpls_header() checked the table extent; check the PlayItem references.
+    for (i = 0; i < mpls_file->total_chapter_count; i++)
+    {
+        uint16_t clip_index = (uint16_t) get_int16(data + mpls_file->chapter_pos + i * CHAPTER_SIZE + 2);
+        if (clip_index >= stream_clip_count)
+        {
+            FAIL("Chapter mark %i references missing stream clip %i.", i, clip_index);
+        }
+    }
+
+    // ExtensionData is optional metadata: ignore it when malformed rather than reject the playlist
+    if (mpls_file->extension_pos != 0 && !check_extension_data(mpls_file))
+    {
+#ifdef DEBUG
+        printf("Ignoring malformed ExtensionData at offset %i.\n", mpls_file->extension_pos);
+#endif
+        mpls_file->extension_pos = 0;
+    }
+
+    return true;
+}
+
+bool
+load_mpls(mpls_file_t* mpls_file, char* path, char* error, size_t error_size)
+{
+    char resolved[PATH_MAX];
+
+    STATS_BEGIN(open);
+    if (realpath(path, resolved) == NULL)
     {
-        DIE("Invalid chapters offset: %i.", chaptersPos);
+        FAIL("Unable to get the full path (realpath) of \"%s\".", path);
     }
+    mpls_file->path = MPLS_STRDUP(resolved);
     
-    int chapterCountPos = chaptersPos + 4;
-    mpls_file.chapter_pos = chaptersPos + 6;
+    mpls_file->name = basename(mpls_file->path);
+    if (mpls_file->name == NULL)
+    {
+        FAIL("Unable to get the file name (basename) of \"%s\".", path);
+    }
     
-    // Verify chapter count
-    mpls_file.total_chapter_count = get_int16(data + chapterCountPos);
-    if (mpls_file.total_chapter_count < 0)
+    mpls_file->file = fopen(mpls_file->path, "r");
+    if (mpls_file->file == NULL)
     {
-        DIE("Invalid chapter count: %i.", mpls_file.total_chapter_count);
+        FAIL("Unable to open \"%s\" for reading.", mpls_file->path);
     }
+    STATS_END(open, STATS_PHASE_OPEN);
+
+    STATS_BEGIN(load);
+    mpls_file->size = file_get_length(mpls_file->file);
+    mpls_file->data = (char*) MPLS_CALLOC(mpls_file->size + 1, sizeof(char));
     
-    // Verify Time IN
-    mpls_file.time_in = get_int32(data + TIME_IN_POS);
-    if (mpls_file.time_in < 0)
+    long br = fread(mpls_file->data, 1, mpls_file->size, mpls_file->file);
+    STATS_ADD(STATS_BYTES_READ, br);
+    
+    // The whole file is in memory now; don't hold on to the descriptor
+    fclose(mpls_file->file); mpls_file->file = NULL;
+    
+    if (br != mpls_file->size)
     {
-        DIE("Invalid playlist time in: %i.", mpls_file.time_in);
+        FAIL("Wrong number of chars read from \"%s\": expected %li, found %li.", mpls_file->path, mpls_file->size, br);
     }
+    STATS_END(load, STATS_PHASE_LOAD);
     
-    // Verify Time OUT
-    mpls_file.time_out = get_int32(data + TIME_OUT_POS);
-    if (mpls_file.time_out < 0)
+    return true;
+}
+
+bool
+check_mpls(mpls_file_t* mpls_file, char* error, size_t error_size)
+{
+    bool valid;
+
+    // Every offset, count and length the parser later follows comes from the
+    // file, so check them all once here; the parse loops then read unchecked.
+    STATS_BEGIN(validate);
+    valid = read_mpls_header(mpls_file, error, error_size) &&
+            validate_mpls_sections(mpls_file, error, error_size);
+    STATS_END(validate, STATS_PHASE_VALIDATE);
+
+    return valid;
+}
+
+mpls_file_t
+init_mpls(char* path)
+{
+    mpls_file_t mpls_file = create_mpls_file_t();
+    char error[256];
+
+    if (!load_mpls(&mpls_file, path, error, sizeof(error)) ||
+        !check_mpls(&mpls_file, error, sizeof(error)))
     {
-        DIE("Invalid playlist time out: %i.", mpls_file.time_out);
+        DIE("%s", error);
     }
     
     return mpls_file;
 }
 
-void
-parse_stream_clips(mpls_file_t* mpls_file, playlist_t* playlist)
+/**
+ * Decodes the attributes of the first primary video stream (MPLS0300).
+ * validate_mpls_sections() checked that the entry and attributes fit.
+ * @param entry start of the STN stream entry (its length byte)
+ * @param clip
+ */
+static void
+read_uhd_video_attributes(const char* entry, stream_clip_t* clip)
+{
+    // stream_entry: length (1) + body; stream_attributes: length (1), coding type (1),
+    // video format / frame rate (1), dynamic range / color space (1), flags (1)
+    const char* attributes = entry + 1 + (uint8_t) entry[0];
+    int length = (uint8_t) attributes[0];
+
+    if (length < 1)
+        return;
+
+    clip->video_coding_type = (uint8_t) attributes[1];
+    if (clip->video_coding_type == VIDEO_CODING_HEVC && length >= 4)
+    {
+        clip->dynamic_range = ((uint8_t) attributes[3] >> 4) & 0x0F;
+        clip->color_space = (uint8_t) attributes[3] & 0x0F;
+        clip->hdr_plus = ((uint8_t) attributes[4] >> 6) & 0x01;
+    }
+}
+
+/*
+ * Shared body of the per-version parse loops.  Always inlined into each
+ * variant below with a constant version, so the version checks in the loop
+ * are resolved at compile time.
+ */
+static inline __attribute__((always_inline)) void
+parse_stream_clips_version(mpls_file_t* mpls_file, playlist_t* playlist, const mpls_version_t version)
 {
+    // Clip nodes are only needed when something reads them back later;
+    // STN (stream count) data only when tracks or streams were requested.
+    bool need_clip_list = (playlist->fields & (FIELD_CLIPS | FIELD_TRACKS | FIELD_STREAMS | FIELD_CHAPTERS)) != 0;
+    bool need_stn = (playlist->fields & (FIELD_TRACKS | FIELD_STREAMS)) != 0;
+
     char* data = mpls_file->data;
     int* pos_ptr = &(mpls_file->pos);
     *pos_ptr = mpls_file->playlist_pos;
@@ -447,19 +754,28 @@ parse_stream_clips(mpls_file_t* mpls_file, playlist_t* playlist)
     
     for(streamClipIndex = 0; streamClipIndex < stream_clip_count; streamClipIndex++)
     {
-        stream_clip_t* streamClip = (stream_clip_t*) calloc(1, sizeof(stream_clip_t));
+        stream_clip_t scratchClip;
+        stream_clip_t* streamClip = &scratchClip;
+
+        if (need_clip_list)
+            streamClip = (stream_clip_t*) MPLS_CALLOC(1, sizeof(stream_clip_t));
         init_stream_clip_t(streamClip);
 
-        add_stream_clip(&playlist->stream_clip_list, streamClip);
-        add_stream_clip(&playlist->chapter_stream_clip_list, streamClip);
+        if (need_clip_list)
+        {
+            add_stream_clip(&playlist->stream_clip_list, streamClip);
+            add_stream_clip(&playlist->chapter_stream_clip_list, streamClip);
+        }
 
         int itemStart = *pos_ptr;
-        int itemLength = get_int16_cursor(data, pos_ptr);
-        char* itemName = copy_string_cursor(data, pos_ptr, 5); /* e.g., "00504" */
-        char* itemType = copy_string_cursor(data, pos_ptr, 4); /* "M2TS" */
-        
-        // Will always be exactly ten (10) chars
-        sprintf(streamClip->filename, "%s.%s", itemName, itemType);
+        int itemLength = (uint16_t) get_int16_cursor(data, pos_ptr);
+
+        // Will always be exactly ten (10) chars: name (e.g., "00504") + "." + type ("M2TS")
+        memcpy(streamClip->filename, data + *pos_ptr, 5);
+        streamClip->filename[5] = '.';
+        memcpy(streamClip->filename + 6, data + *pos_ptr + 5, 4);
+        streamClip->filename[10] = '\0';
+        *pos_ptr += 9;
         
         *pos_ptr += 1;
         int multiangle = (data[*pos_ptr] >> 4) & 0x01;
@@ -489,24 +805,27 @@ parse_stream_clips(mpls_file_t* mpls_file, playlist_t* playlist)
         playlist->duration_sec += (timeOut - timeIn);
         
 #ifdef DEBUG
-        printf("Stream clip %2i: %s (type = %s, length = %i, multiangle = %i)\n", streamClipIndex, streamClip->filename, itemType, itemLength, multiangle);
+        printf("Stream clip %2i: %s (length = %i, multiangle = %i)\n", streamClipIndex, streamClip->filename, itemLength, multiangle);
 #endif
-        
-        free(itemName); itemName = NULL;
-        free(itemType); itemType = NULL;
+
+        if (!need_stn)
+        {
+            // Skip the rest of the PlayItem (angles and STN table) by its length field
+            *pos_ptr = itemStart + itemLength + 2;
+            continue;
+        }
 
         *pos_ptr += 12;
         
         if (multiangle > 0)
         {
-            int angles = data[*pos_ptr];
+            int angles = (uint8_t) data[*pos_ptr];
             *pos_ptr += 2;
             int angle;
             for (angle = 0; angle < angles - 1; angle++)
             {
-                /* char* angleName = */ copy_string_cursor(data, pos_ptr, 5);
-                /* char* angleType = */ copy_string_cursor(data, pos_ptr, 4);
-                *pos_ptr += 1;
+                // Angle clip name (5), codec (4), STC ID (1); not reported
+                *pos_ptr += PLAY_ITEM_ANGLE_SIZE;
 
                 // TODO
                 /*
@@ -556,14 +875,17 @@ parse_stream_clips(mpls_file_t* mpls_file, playlist_t* playlist)
 
         /* int streamInfoLength = */ get_int16_cursor(data, pos_ptr);
         *pos_ptr += 2;
-        int streamCountVideo = data[(*pos_ptr)++];
-        int streamCountAudio = data[(*pos_ptr)++];
-        int streamCountPG = data[(*pos_ptr)++];
-        int streamCountIG = data[(*pos_ptr)++];
-        int streamCountSecondaryAudio = data[(*pos_ptr)++];
-        int streamCountSecondaryVideo = data[(*pos_ptr)++];
-        int streamCountPIP = data[(*pos_ptr)++];
+        int streamCountVideo = (uint8_t) data[(*pos_ptr)++];
+        int streamCountAudio = (uint8_t) data[(*pos_ptr)++];
+        int streamCountPG = (uint8_t) data[(*pos_ptr)++];
+        int streamCountIG = (uint8_t) data[(*pos_ptr)++];
+        int streamCountSecondaryAudio = (uint8_t) data[(*pos_ptr)++];
+        int streamCountSecondaryVideo = (uint8_t) data[(*pos_ptr)++];
+        int streamCountPIP = (uint8_t) data[(*pos_ptr)++];
         *pos_ptr += 5;
+
+        if (version >= MPLS_VERSION_0300 && streamCountVideo > 0)
+            read_uhd_video_attributes(data + *pos_ptr, streamClip);
         
         int i;
 
@@ -633,6 +955,37 @@ parse_stream_clips(mpls_file_t* mpls_file, playlist_t* playlist)
     format_duration_to(playlist->duration_sec, playlist->duration_formatted);
 }
 
+static void
+parse_stream_clips_0100(mpls_file_t* mpls_file, playlist_t* playlist)
+{
+    parse_stream_clips_version(mpls_file, playlist, MPLS_VERSION_0100);
+}
+
+static void
+parse_stream_clips_0200(mpls_file_t* mpls_file, playlist_t* playlist)
+{
+    parse_stream_clips_version(mpls_file, playlist, MPLS_VERSION_0200);
+}
+
+static void
+parse_stream_clips_0300(mpls_file_t* mpls_file, playlist_t* playlist)
+{
+    parse_stream_clips_version(mpls_file, playlist, MPLS_VERSION_0300);
+}
+
+/* Indexed by mpls_version_t */
+static void (*const stream_clip_parsers[MPLS_VERSION_COUNT])(mpls_file_t*, playlist_t*) = {
+    parse_stream_clips_0100,
+    parse_stream_clips_0200,
+    parse_stream_clips_0300
+};
+
+void
+parse_stream_clips(mpls_file_t* mpls_file, playlist_t* playlist)
+{
+    stream_clip_parsers[mpls_file->version](mpls_file, playlist);
+}
+
 void
 parse_chapters(mpls_file_t* mpls_file, playlist_t* playlist)
 {
@@ -641,213 +994,1149 @@ parse_chapters(mpls_file_t* mpls_file, playlist_t* playlist)
     *pos_ptr = mpls_file->chapter_pos;
 
     int i;
-    int validChapterCount = 0;
-    
-    for (i = 0; i < mpls_file->total_chapter_count; i++)
-    {
-        char* chapter = data + *pos_ptr + (i * CHAPTER_SIZE);
-        if (chapter[1] == CHAPTER_TYPE_ENTRY_MARK)
-        {
-            validChapterCount++;
-        }
-    }
-    
-    double* chapters = (double*) calloc(validChapterCount, sizeof(double));
-    
-    validChapterCount = 0;
-    
-    *pos_ptr = mpls_file->chapter_pos;
-    
-    for (i = 0; i < mpls_file->total_chapter_count; i++)
+    int mark_count = mpls_file->total_chapter_count;
+    int clip_count = playlist->chapter_stream_clip_list.count;
+    size_t validChapterCount = 0;
+
+    // Every mark becomes a mark record and at most one chapter, so both output
+    // arrays can be sized up front and filled in a single pass over the table.
+    playlist_mark_t* marks = (playlist_mark_t*) MPLS_CALLOC(mark_count + 1, sizeof(playlist_mark_t));
+    double* chapters = (double*) MPLS_CALLOC(mark_count + 1, sizeof(double));
+
+    // Resolve PlayItem references by index instead of walking the clip list per mark
+    stream_clip_t** clips = (stream_clip_t**) MPLS_CALLOC(clip_count + 1, sizeof(stream_clip_t*));
+    stream_clip_t* clip = playlist->chapter_stream_clip_list.first;
+    for (i = 0; i < clip_count; i++, clip = clip->next)
+        clips[i] = clip;
+
+    for (i = 0; i < mark_count; i++)
     {
         char* chapter = data + *pos_ptr;
-        
-        if (chapter[1] == CHAPTER_TYPE_ENTRY_MARK)
-        {
-            
-            int streamFileIndex = ((int)data[*pos_ptr + 2] << 8) + data[*pos_ptr + 3];
-            
-            int32_t chapterTime = get_int32(chapter + 4);
+        playlist_mark_t* mark = &marks[i];
 
-            stream_clip_t* streamClip = get_stream_clip_at(&playlist->chapter_stream_clip_list, streamFileIndex);
+        // PlayListMark: reserved (1), mark_type (1), ref_to_PlayItem_id (2),
+        // mark_time_stamp (4), entry_ES_PID (2), duration (4)
+        mark->type = (uint8_t) chapter[1];
+        mark->clip_index = (uint16_t) get_int16(chapter + 2);
+        mark->time = get_int32(chapter + 4);
+        mark->entry_es_pid = (uint16_t) get_int16(chapter + 8);
+        mark->duration = get_int32(chapter + 10);
 
-            double chapterSeconds = timecode_to_sec(chapterTime);
+        stream_clip_t* streamClip = clips[mark->clip_index];
+        double chapterSeconds = timecode_to_sec(mark->time);
+
+        mark->relative_time_sec =
+            chapterSeconds -
+            streamClip->time_in_sec +
+            streamClip->relative_time_in_sec;
 
-            double relativeSeconds =
-                chapterSeconds -
-                streamClip->time_in_sec +
-                streamClip->relative_time_in_sec;
-            
 #ifdef DEBUG
-            printf("streamFileIndex %2i: (%9i / %f = %8.3f) - %8.3f + %8.3f = %8.3f\n", streamFileIndex, chapterTime, TIMECODE_DIV, chapterSeconds, streamClip->time_in_sec, streamClip->relative_time_in_sec, relativeSeconds);
+        printf("mark %2i: type %i, streamFileIndex %2i: (%9i / %f = %8.3f) - %8.3f + %8.3f = %8.3f\n", i, mark->type, mark->clip_index, mark->time, TIMECODE_DIV, chapterSeconds, streamClip->time_in_sec, streamClip->relative_time_in_sec, mark->relative_time_sec);
 #endif
 
-            // Ignore short last chapter
-            // If the last chapter is < 1.0 Second before end of film Ignore
-            if (playlist->duration_sec - relativeSeconds > 1.0)
-            {
-//                streamClip->Chapters.Add(chapterSeconds);
-//                this.Chapters.Add(relativeSeconds);
-                chapters[validChapterCount++] = relativeSeconds;
-            }
-        }
-        
+        // Branch-free compaction: always store, only advance for entry marks.
+        // Ignore short last chapter
+        // If the last chapter is < 1.0 Second before end of film Ignore
+        chapters[validChapterCount] = mark->relative_time_sec;
+        validChapterCount +=
+            (mark->type == CHAPTER_TYPE_ENTRY_MARK) &
+            (playlist->duration_sec - mark->relative_time_sec > 1.0);
+
         *pos_ptr += CHAPTER_SIZE;
     }
-    
-    chapters = (double*) realloc(chapters, validChapterCount * sizeof(double));
 
+    MPLS_FREE(clips);
+
+    playlist->marks = marks;
+    playlist->mark_count = mark_count;
     playlist->chapters = chapters;
     playlist->chapter_count = validChapterCount;
 }
 
 void
-print_playlist_header(mpls_file_t* mpls_file, playlist_t* playlist)
+parse_app_info(mpls_file_t* mpls_file, playlist_t* playlist)
+{
+    char* data = mpls_file->data;
+    int* pos_ptr = &(mpls_file->pos);
+    playlist_app_info_t* app_info = &playlist->app_info;
+
+    // read_mpls_header() checked the file is long enough for all of AppInfoPlayList
+    *pos_ptr = APP_INFO_POS + 5;
+    app_info->playback_type = (uint8_t) data[(*pos_ptr)++];
+    uint16_t playback_count = (uint16_t) get_int16_cursor(data, pos_ptr);
+    if (app_info->playback_type == PLAYBACK_TYPE_RANDOM || app_info->playback_type == PLAYBACK_TYPE_SHUFFLE)
+        app_info->playback_count = playback_count;
+
+    uint32_t uo_mask_high = (uint32_t) get_int32_cursor(data, pos_ptr);
+    uint32_t uo_mask_low = (uint32_t) get_int32_cursor(data, pos_ptr);
+    app_info->uo_mask = ((uint64_t) uo_mask_high << 32) | uo_mask_low;
+
+    uint8_t flags = (uint8_t) data[*pos_ptr];
+    app_info->random_access = (flags >> 7) & 0x01;
+    app_info->audio_mix = (flags >> 6) & 0x01;
+    app_info->lossless_bypass = (flags >> 5) & 0x01;
+}
+
+static void
+parse_hdr_static_metadata(char* block, int64_t length, playlist_extensions_t* extensions)
+{
+    // length (4), metadata count (1), reserved (3), then the metadata entries;
+    // the length field counts the bytes after it, so one entry needs at least 32
+    int64_t block_length;
+    int count;
+    int i;
+    int j;
+
+    if (length < 8 + HDR_STATIC_METADATA_SIZE)
+        return;
+
+    block_length = (uint32_t) get_int32(block);
+    if (block_length < 4 + HDR_STATIC_METADATA_SIZE)
+        return;
+    if (block_length > length - 4)
+        block_length = length - 4;
+
+    count = (uint8_t) block[4];
+    if (count > (block_length - 4) / HDR_STATIC_METADATA_SIZE)
+        count = (int) ((block_length - 4) / HDR_STATIC_METADATA_SIZE);
+    if (count > HDR_STATIC_METADATA_MAX)
+        count = HDR_STATIC_METADATA_MAX;
+
+    for (i = 0; i < count; i++)
+    {
+        hdr_static_metadata_t* hdr = &extensions->hdr_static[i];
+        int pos = 8 + i * HDR_STATIC_METADATA_SIZE;
+
+        hdr->dynamic_range = ((uint8_t) block[pos] >> 4) & 0x0F;
+        pos += 4;
+        for (j = 0; j < 3; j++)
+        {
+            hdr->display_primaries_x[j] = (uint16_t) get_int16_cursor(block, &pos);
+            hdr->display_primaries_y[j] = (uint16_t) get_int16_cursor(block, &pos);
+        }
+        hdr->white_point_x = (uint16_t) get_int16_cursor(block, &pos);
+        hdr->white_point_y = (uint16_t) get_int16_cursor(block, &pos);
+        hdr->max_luminance = (uint16_t) get_int16_cursor(block, &pos);
+        hdr->min_luminance = (uint16_t) get_int16_cursor(block, &pos);
+        hdr->max_cll = (uint16_t) get_int16_cursor(block, &pos);
+        hdr->max_fall = (uint16_t) get_int16_cursor(block, &pos);
+    }
+    extensions->hdr_static_count = count;
+}
+
+void
+parse_extension_data(mpls_file_t* mpls_file, playlist_t* playlist)
+{
+    char* data = mpls_file->data;
+    int* pos_ptr = &(mpls_file->pos);
+    playlist_extensions_t* extensions = &playlist->extensions;
+    int ext = mpls_file->extension_pos;
+    int i;
+
+    if (ext == 0)
+        return;
+
+    // validate_mpls_sections() checked the directory and the entry extents
+    *pos_ptr = ext + 11;
+    extensions->entry_count = (uint8_t) data[(*pos_ptr)++];
+
+    for (i = 0; i < extensions->entry_count; i++)
+    {
+        uint32_t id = (uint32_t) get_int32_cursor(data, pos_ptr); /* ID1 (2), ID2 (2) */
+        int64_t start = (uint32_t) get_int32_cursor(data, pos_ptr);
+        int64_t length = (uint32_t) get_int32_cursor(data, pos_ptr);
+        char* block = data + ext + start;
+
+        // Each block starts with its own length (4) followed by a count
+        switch (id)
+        {
+            case EXTENSION_PIP_METADATA:
+                if (length >= 6)
+                    extensions->pip_block_count = (uint16_t) get_int16(block + 4);
+                break;
+            case EXTENSION_STN_SS:
+                extensions->stereoscopic = true;
+                break;
+            case EXTENSION_SUBPATH:
+                if (length >= 6)
+                    extensions->subpath_count = (uint16_t) get_int16(block + 4);
+                break;
+            case EXTENSION_STATIC_HDR:
+                parse_hdr_static_metadata(block, length, extensions);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void
+print_playlist_header(FILE* out, mpls_file_t* mpls_file, playlist_t* playlist)
 {
     int i;
     size_t len = strlen(mpls_file->path);
-    printf("%s\n", mpls_file->path);
+    fprintf(out, "%s\n", mpls_file->path);
     for (i = 0; i < len; i++)
-        printf("%c", '=');
-    printf("\n");
-    printf("\n");
+        fprintf(out, "%c", '=');
+    fprintf(out, "\n");
+    fprintf(out, "\n");
 }
 
 void
-print_playlist_details(playlist_t* playlist)
+print_playlist_details(FILE* out, playlist_t* playlist)
 {
-    printf("Playlist duration: %s\n", playlist->duration_formatted);
-    printf("\n");
+    fprintf(out, "Playlist duration: %s\n", playlist->duration_formatted);
+    fprintf(out, "\n");
 }
 
 void
-print_tracks_header(playlist_t* playlist)
+print_tracks_header(FILE* out, playlist_t* playlist)
 {
 //    int i;
     char header[1024];
     sprintf(header, "Tracks (%i):", playlist->stream_clip_list.first->track_count);
 //    size_t len = strlen(header);
-    printf("%s\n", header);
+    fprintf(out, "%s\n", header);
 //    for (i = 0; i < len; i++)
-//        printf("%c", '-');
-//    printf("\n");
-    printf("\n");
+//        fprintf(out, "%c", '-');
+//    fprintf(out, "\n");
+    fprintf(out, "\n");
 }
 
 void
-print_tracks(playlist_t* playlist)
+print_tracks(FILE* out, playlist_t* playlist)
 {
     stream_clip_t* first_clip = playlist->stream_clip_list.first;
-    printf("\t type                        # \n");
-    printf("\t ------------------------    --\n");
-    printf("\t Primary Video:              %2i\n", first_clip->video_count);
-    printf("\t Primary Audio:              %2i\n", first_clip->audio_count);
-    printf("\t Subtitle (PGS):             %2i\n", first_clip->subtitle_count);
-    printf("\t Interactive Menu:           %2i\n", first_clip->interactive_menu_count);
-    printf("\t Secondary Video:            %2i\n", first_clip->secondary_video_count);
-    printf("\t Secondary Audio:            %2i\n", first_clip->secondary_audio_count);
-    printf("\t Picture-in-Picture (PiP):   %2i\n", first_clip->pip_count);
-    printf("\n");
+    fprintf(out, "\t type                        # \n");
+    fprintf(out, "\t ------------------------    --\n");
+    fprintf(out, "\t Primary Video:              %2i\n", first_clip->video_count);
+    fprintf(out, "\t Primary Audio:              %2i\n", first_clip->audio_count);
+    fprintf(out, "\t Subtitle (PGS):             %2i\n", first_clip->subtitle_count);
+    fprintf(out, "\t Interactive Menu:           %2i\n", first_clip->interactive_menu_count);
+    fprintf(out, "\t Secondary Video:            %2i\n", first_clip->secondary_video_count);
+    fprintf(out, "\t Secondary Audio:            %2i\n", first_clip->secondary_audio_count);
+    fprintf(out, "\t Picture-in-Picture (PiP):   %2i\n", first_clip->pip_count);
+    if (playlist->version >= MPLS_VERSION_0300 && first_clip->video_coding_type == VIDEO_CODING_HEVC)
+    {
+        static const char* dynamic_ranges[] = { "SDR", "HDR10", "Dolby Vision" };
+        const char* dynamic_range = first_clip->dynamic_range < ARRAY_SIZE(dynamic_ranges)
+                                  ? dynamic_ranges[first_clip->dynamic_range] : "Unknown";
+        const char* color_space = first_clip->color_space == COLOR_SPACE_BT2020 ? "BT.2020"
+                                : first_clip->color_space == COLOR_SPACE_BT709 ? "BT.709" : "Unknown";
+        fprintf(out, "\t Dynamic Range:              %s%s (%s)\n", dynamic_range, first_clip->hdr_plus ? ", HDR10+" : "", color_space);
+    }
+    fprintf(out, "\n");
 }
 
 void
-print_stream_clips_header(playlist_t* playlist)
+print_stream_clips_header(FILE* out, playlist_t* playlist)
 {
 //    int i;
     char header[1024];
     sprintf(header, "Stream Clips (%i):", playlist->stream_clip_list.count);
 //    size_t len = strlen(header);
-    printf("%s\n", header);
+    fprintf(out, "%s\n", header);
 //    for (i = 0; i < len; i++)
-//        printf("%c", '-');
-//    printf("\n");
-    printf("\n");
+//        fprintf(out, "%c", '-');
+//    fprintf(out, "\n");
+    fprintf(out, "\n");
 }
 
 void
-print_stream_clips(playlist_t* playlist)
+print_stream_clips(FILE* out, playlist_t* playlist)
 {
     stream_clip_t* clip = playlist->stream_clip_list.first;
+    bool sizes = (playlist->fields & FIELD_FILE_SIZES) != 0;
     char duration_human[15];
-    printf("\t idx    filename     duration    \n");
-    printf("\t ---    ----------   ------------\n");
+    if (sizes)
+    {
+        fprintf(out, "\t idx    filename     duration       size (bytes)\n");
+        fprintf(out, "\t ---    ----------   ------------   -------------\n");
+    }
+    else
+    {
+        fprintf(out, "\t idx    filename     duration    \n");
+        fprintf(out, "\t ---    ----------   ------------\n");
+    }
     while (clip != NULL)
     {
         format_duration_to(clip->duration_sec, duration_human);
-        printf("\t %3i:   %s   %s\n", clip->index + 1, clip->filename, duration_human);
+        if (sizes)
+            fprintf(out, "\t %3i:   %s   %s   %13lli\n", clip->index + 1, clip->filename, duration_human, (long long) clip->stream_file_size);
+        else
+            fprintf(out, "\t %3i:   %s   %s\n", clip->index + 1, clip->filename, duration_human);
         clip = clip->next;
     }
-    printf("\n");
+    fprintf(out, "\n");
+}
+
+void
+print_streams_header(FILE* out, playlist_t* playlist)
+{
+    fprintf(out, "Streams per Clip (%i):\n", playlist->stream_clip_list.count);
+    fprintf(out, "\n");
+}
+
+void
+print_streams(FILE* out, playlist_t* playlist)
+{
+    stream_clip_t* clip = playlist->stream_clip_list.first;
+    fprintf(out, "\t idx    filename      #V   #A  #PG  #IG  #2V  #2A #PiP\n");
+    fprintf(out, "\t ---    ----------   ---  ---  ---  ---  ---  ---  ---\n");
+    while (clip != NULL)
+    {
+        fprintf(out, "\t %3i:   %s   %3i  %3i  %3i  %3i  %3i  %3i  %3i\n", clip->index + 1, clip->filename,
+               clip->video_count, clip->audio_count, clip->subtitle_count, clip->interactive_menu_count,
+               clip->secondary_video_count, clip->secondary_audio_count, clip->pip_count);
+        clip = clip->next;
+    }
+    fprintf(out, "\n");
 }
 
 void
-print_chapters_header(playlist_t* playlist)
+print_chapters_header(FILE* out, playlist_t* playlist)
 {
 //    int i;
     char header[1024];
     sprintf(header, "Chapters (%zu):", playlist->chapter_count);
 //    size_t len = strlen(header);
-    printf("%s\n", header);
+    fprintf(out, "%s\n", header);
 //    for (i = 0; i < len; i++)
-//        printf("%c", '-');
-//    printf("\n");
-    printf("\n");
+//        fprintf(out, "%c", '-');
+//    fprintf(out, "\n");
+    fprintf(out, "\n");
 }
 
 void
-print_chapters(playlist_t* playlist)
+print_chapters(FILE* out, playlist_t* playlist)
 {
     int i;
-    printf("\t idx    start time  \n");
-    printf("\t ---    ------------\n");
+    fprintf(out, "\t idx    start time  \n");
+    fprintf(out, "\t ---    ------------\n");
     for(i = 0; i < playlist->chapter_count; i++)
     {
-        double sec = playlist->chapters[i];
-        char* chapter_start_human = format_duration(sec);
-        printf("\t %3i:   %s\n", i + 1, chapter_start_human);
-        free(chapter_start_human);
+        char chapter_start_human[15];
+        format_duration_to(playlist->chapters[i], chapter_start_human);
+        fprintf(out, "\t %3i:   %s\n", i + 1, chapter_start_human);
     }
+    fprintf(out, "\n");
+}
+
+void
+print_app_info(FILE* out, playlist_t* playlist)
+{
+    static const char* playback_types[] = { "Unknown", "Sequential", "Random", "Shuffle" };
+    playlist_app_info_t* app_info = &playlist->app_info;
+
+    fprintf(out, "Playback:\n");
+    fprintf(out, "\n");
+    fprintf(out, "\t Type:                     %s", playback_types[app_info->playback_type < ARRAY_SIZE(playback_types) ? app_info->playback_type : 0]);
+    if (app_info->playback_type == PLAYBACK_TYPE_RANDOM || app_info->playback_type == PLAYBACK_TYPE_SHUFFLE)
+        fprintf(out, " (%i items)", app_info->playback_count);
+    fprintf(out, "\n");
+    fprintf(out, "\t UO mask:                  0x%016llx\n", (unsigned long long) app_info->uo_mask);
+    fprintf(out, "\t Random access flag:       %s\n", app_info->random_access ? "yes" : "no");
+    fprintf(out, "\t Audio mix:                %s\n", app_info->audio_mix ? "yes" : "no");
+    fprintf(out, "\t Lossless bypass:          %s\n", app_info->lossless_bypass ? "yes" : "no");
+    fprintf(out, "\n");
+}
+
+void
+print_extensions(FILE* out, playlist_t* playlist)
+{
+    static const char* dynamic_ranges[] = { "SDR", "HDR10", "Dolby Vision" };
+    playlist_extensions_t* extensions = &playlist->extensions;
+    int i;
+    int j;
+
+    fprintf(out, "Extensions (%i):\n", extensions->entry_count);
+    fprintf(out, "\n");
+    fprintf(out, "\t 3D (STN_SS):              %s\n", extensions->stereoscopic ? "yes" : "no");
+    fprintf(out, "\t PiP metadata blocks:      %i\n", extensions->pip_block_count);
+    fprintf(out, "\t SubPath extensions:       %i\n", extensions->subpath_count);
+    fprintf(out, "\t Static HDR metadata:      %i\n", extensions->hdr_static_count);
+    for (i = 0; i < extensions->hdr_static_count; i++)
+    {
+        hdr_static_metadata_t* hdr = &extensions->hdr_static[i];
+
+        // Chromaticity in units of 0.00002; minimum luminance in 0.0001 cd/m2
+        fprintf(out, "\t   %i: %s, mastering %u / %.4f cd/m2, MaxCLL %u, MaxFALL %u, primaries",
+                i + 1, hdr->dynamic_range < ARRAY_SIZE(dynamic_ranges) ? dynamic_ranges[hdr->dynamic_range] : "Unknown",
+                hdr->max_luminance, hdr->min_luminance / 10000.0, hdr->max_cll, hdr->max_fall);
+        for (j = 0; j < 3; j++)
+            fprintf(out, " (%.4f, %.4f)", hdr->display_primaries_x[j] * 0.00002, hdr->display_primaries_y[j] * 0.00002);
+        fprintf(out, ", white (%.4f, %.4f)\n", hdr->white_point_x * 0.00002, hdr->white_point_y * 0.00002);
+    }
+    fprintf(out, "\n");
+}
+
+void
+parse_playlist(mpls_file_t* mpls_file, playlist_t* playlist, int fields)
+{
+    int i;
+    playlist->fields = fields;
+    playlist->version = mpls_file->version;
+    for (i = 0; i < 10 && mpls_file->name[i] != '\0'; i++)
+        playlist->filename[i] = toupper((unsigned char) mpls_file->name[i]);
+    playlist->filename[i] = '\0';
+
+    // Every field needs the PlayItem walk: the duration is the sum of the
+    // clip durations, and chapters are relative to the clip times.
+    STATS_BEGIN(stream_clips);
+    parse_stream_clips(mpls_file, playlist);
+    STATS_END(stream_clips, STATS_PHASE_STREAM_CLIPS);
+
+    if (fields & FIELD_CHAPTERS)
+    {
+        STATS_BEGIN(chapters);
+        parse_chapters(mpls_file, playlist);
+        STATS_END(chapters, STATS_PHASE_CHAPTERS);
+    }
+
+    // Optional blocks outside the PlayItem walk; untouched unless requested
+    if (fields & FIELD_PLAYBACK)
+        parse_app_info(mpls_file, playlist);
+    if (fields & FIELD_EXTENSIONS)
+        parse_extension_data(mpls_file, playlist);
+
+    STATS_ADD(STATS_FILES, 1);
+}
+
+void
+format_playlist(FILE* out, mpls_file_t* mpls_file, playlist_t* playlist)
+{
+    int fields = playlist->fields;
+    STATS_BEGIN(format);
+
+    print_playlist_header(out, mpls_file, playlist);
+    if (fields & FIELD_DURATION)
+    {
+        print_playlist_details(out, playlist);
+    }
+    if ((fields & FIELD_TRACKS) && playlist->stream_clip_list.first != NULL)
+    {
+        print_tracks_header(out, playlist);
+        print_tracks(out, playlist);
+    }
+    if (fields & FIELD_CLIPS)
+    {
+        print_stream_clips_header(out, playlist);
+        print_stream_clips(out, playlist);
+    }
+    if (fields & FIELD_STREAMS)
+    {
+        print_streams_header(out, playlist);
+        print_streams(out, playlist);
+    }
+    if (fields & FIELD_CHAPTERS)
+    {
+        print_chapters_header(out, playlist);
+        print_chapters(out, playlist);
+    }
+    if (fields & FIELD_PLAYBACK)
+    {
+        print_app_info(out, playlist);
+    }
+    if (fields & FIELD_EXTENSIONS)
+    {
+        print_extensions(out, playlist);
+    }
+
+    STATS_END(format, STATS_PHASE_FORMAT);
+}
+
+void
+output_playlist(mpls_file_t* mpls_file, playlist_t* playlist)
+{
+    char* output = NULL;
+    size_t output_size = 0;
+    FILE* out;
+
+    // Render first and write in one go, so formatting and output are separate
+    // phases for --stats (and stdout sees one write per playlist).
+    out = open_memstream(&output, &output_size);
+    format_playlist(out, mpls_file, playlist);
+    fclose(out);
+
+    STATS_BEGIN(output_mark);
+    fwrite(output, 1, output_size, stdout);
+    STATS_END(output_mark, STATS_PHASE_OUTPUT);
+
+    free(output);
+}
+
+void
+parse_mpls(char* path, int fields)
+{
+    mpls_file_t mpls_file = init_mpls(path);
+    playlist_t playlist = create_playlist_t();
+
+    parse_playlist(&mpls_file, &playlist, fields);
+    output_playlist(&mpls_file, &playlist);
+
+    free_playlist_members(&playlist);
+    free_mpls_file_members(&mpls_file);
+}
+
+
+void
+query_mpls(char* query, char** paths, int path_count)
+{
+    catalog_t catalog;
+    catalog_query_t catalog_query;
+    int i;
+
+    if (!catalog_parse_query(query, &catalog_query))
+    {
+        DIE("Invalid query: \"%s\".", query);
+    }
+
+    init_catalog_t(&catalog);
+
+    for (i = 0; i < path_count; i++)
+    {
+        mpls_file_t mpls_file = init_mpls(paths[i]);
+        playlist_t playlist = create_playlist_t();
+
+        parse_playlist(&mpls_file, &playlist, FIELD_ALL);
+        catalog_add_playlist(&catalog, mpls_file.path, &playlist);
+
+        free_playlist_members(&playlist);
+        free_mpls_file_members(&mpls_file);
+    }
+
+    uint8_t* selection = (uint8_t*) calloc(catalog.row_count ? catalog.row_count : 1, sizeof(uint8_t));
+    size_t selected = catalog_run_query(&catalog, &catalog_query, selection);
+    char duration_human[15];
+    size_t row;
+
+    for (row = 0; row < catalog.row_count; row++)
+    {
+        if (!selection[row])
+            continue;
+        format_duration_to(timecode_to_sec(catalog.columns[CATALOG_COL_DURATION][row]), duration_human);
+        printf("%s   %s   %3lli chapters   %2lli audio\n",
+               catalog.names[row], duration_human,
+               (long long) catalog.columns[CATALOG_COL_CHAPTER_COUNT][row],
+               (long long) catalog.columns[CATALOG_COL_AUDIO_COUNT][row]);
+    }
+
+    format_duration_to(timecode_to_sec(catalog_aggregate(&catalog, CATALOG_COL_DURATION, CATALOG_AGG_SUM, selection)), duration_human);
+    printf("\n%zu of %zu playlists matched (total duration %s)\n", selected, catalog.row_count, duration_human);
+
+    free(selection);
+    free_catalog_members(&catalog);
+}
+
+typedef struct {
+    alloc_tracker_t* tracker;
+    int fields;
+    long long total_retained;
+    long long max_peak;
+} mem_report_t;
+
+static bool
+mem_report_playlist(const char* path, void* arg)
+{
+    mem_report_t* report = (mem_report_t*) arg;
+    alloc_tracker_t* tracker = report->tracker;
+    long long live_before = atomic_load(&tracker->live_bytes);
+    long long allocs_before = atomic_load(&tracker->allocs);
+    long long retained;
+    long long peak;
+    long long allocs;
+
+    alloc_tracker_reset_peak(tracker);
+
+    mpls_file_t mpls_file = init_mpls((char*) path);
+    playlist_t playlist = create_playlist_t();
+    parse_playlist(&mpls_file, &playlist, report->fields);
+
+    // What a caller holds on to while the playlist is loaded
+    retained = atomic_load(&tracker->live_bytes) - live_before;
+    allocs = atomic_load(&tracker->allocs) - allocs_before;
+
+    FILE* out = fopen("/dev/null", "w");
+    if (out != NULL)
+    {
+        format_playlist(out, &mpls_file, &playlist);
+        fclose(out);
+    }
+
+    peak = atomic_load(&tracker->peak_bytes) - live_before;
+
+    free_playlist_members(&playlist);
+    free_mpls_file_members(&mpls_file);
+
+    // Anything still live now was allocated for this playlist and never freed
+    printf("\t %-10s    %9li    %8lli    %14lli    %10lli    %12lli\n",
+           playlist.filename, mpls_file.size, allocs, retained, peak,
+           atomic_load(&tracker->live_bytes) - live_before);
+
+    report->total_retained += retained;
+    if (peak > report->max_peak)
+        report->max_peak = peak;
+    return true;
+}
+
+void
+mem_report_mpls(char** paths, int path_count, int fields)
+{
+    static alloc_tracker_t tracker;
+    mpls_allocator_t allocator;
+    mem_report_t report = { &tracker, fields, 0, 0 };
+    long long leaked;
+    int i;
+
+    init_alloc_tracker_t(&tracker);
+    allocator = alloc_tracker_allocator(&tracker);
+    mpls_set_allocator(&allocator);
+
+    printf("Memory:\n");
+    printf("\n");
+    printf("\t playlist      file size      allocs    retained bytes    peak bytes    leaked bytes\n");
+    printf("\t ----------    ---------    --------    --------------    ----------    ------------\n");
+
+    // One playlist at a time, so the live byte count belongs to it alone
+    for (i = 0; i < path_count; i++)
+    {
+        if (!disc_for_each_playlist(paths[i], mem_report_playlist, &report))
+            exit(EXIT_FAILURE);
+    }
+
+    leaked = atomic_load(&tracker.live_bytes);
+
     printf("\n");
+    printf("\t Retained (sum):   %lli bytes\n", report.total_retained);
+    printf("\t Peak (max):       %lli bytes\n", report.max_peak);
+    printf("\t Allocations:      %lli (%lli freed)\n", (long long) atomic_load(&tracker.allocs), (long long) atomic_load(&tracker.frees));
+    printf("\t Leaked:           %lli bytes\n", leaked);
+    printf("\n");
+
+    printf("Allocation sites:\n");
+    printf("\n");
+    alloc_tracker_print_sites(&tracker, stdout, false);
+
+    if (leaked != 0)
+    {
+        fflush(stdout);
+        fprintf(stderr, "Leaked allocations:\n\n");
+        alloc_tracker_print_sites(&tracker, stderr, true);
+        exit(EXIT_FAILURE);
+    }
+}
+
+typedef struct {
+    mplsbin_writer_t* writer;
+    int fields;
+    bool disc;
+} bin_output_t;
+
+static bool
+bin_add_playlist(const char* path, void* arg)
+{
+    bin_output_t* output = (bin_output_t*) arg;
+    mpls_file_t mpls_file = init_mpls((char*) path);
+    playlist_t playlist = create_playlist_t();
+
+    parse_playlist(&mpls_file, &playlist, output->fields);
+
+    // Same clip file lookups as disc_run(), so both outputs carry the same data
+    if (output->disc)
+        disc_find_clip_sizes(mpls_file.path, &playlist);
+
+    mplsbin_writer_add(output->writer, mpls_file.path, &playlist);
+
+    free_playlist_members(&playlist);
+    free_mpls_file_members(&mpls_file);
+    return true;
 }
 
 void
-parse_mpls(char* path)
+bin_mpls(char** paths, int path_count, int fields)
 {
+    mplsbin_writer_t writer;
+    bin_output_t output = { &writer, fields, false };
+    int i;
+
+    if (isatty(STDOUT_FILENO))
+    {
+        DIE("Refusing to write binary output to a terminal; redirect stdout to a file.");
+    }
+
+    init_mplsbin_writer_t(&writer);
+
+    // As in text mode, a single disc argument switches every path to disc mode
+    for (i = 0; i < path_count && !output.disc; i++)
+    {
+        struct stat st;
+        output.disc = stat(paths[i], &st) == 0 && S_ISDIR(st.st_mode);
+    }
+
+    // Playlists are checked by init_mpls(), so only a disc without playlists fails here
+    for (i = 0; i < path_count; i++)
+    {
+        if (!disc_for_each_playlist(paths[i], bin_add_playlist, &output))
+            exit(EXIT_FAILURE);
+    }
+
+    STATS_BEGIN(output_mark);
+    if (!mplsbin_writer_write(&writer, stdout))
+    {
+        DIE("Error writing binary output.");
+    }
+    STATS_END(output_mark, STATS_PHASE_OUTPUT);
+
+    free_mplsbin_writer_members(&writer);
+}
+
+void
+read_bin_mpls(char** paths, int path_count)
+{
+    char error[256];
+    int i;
+    size_t p;
+
+    for (i = 0; i < path_count; i++)
+    {
+        mplsbin_t bin;
+
+        STATS_BEGIN(load);
+        if (!mplsbin_map(&bin, paths[i], error, sizeof(error)))
+        {
+            fflush(stdout);
+            DIE("%s: %s", paths[i], error);
+        }
+        STATS_END(load, STATS_PHASE_LOAD);
+
+        for (p = 0; p < mplsbin_playlist_count(&bin); p++)
+        {
+            const mplsbin_playlist_t* record = mplsbin_playlist(&bin, p);
+            mpls_file_t mpls_file = create_mpls_file_t();
+            playlist_t playlist = create_playlist_t();
+
+            // Only the path is printed from the file; it points into the mapping
+            mpls_file.path = (char*) mplsbin_string(&bin, record->path);
+
+            mplsbin_to_playlist(&bin, record, &playlist);
+            output_playlist(&mpls_file, &playlist);
+            free_playlist_members(&playlist);
+        }
+
+        mplsbin_close(&bin);
+    }
+}
+
+static int
+compare_doubles(const void* a, const void* b)
+{
+    const double x = *(const double*) a;
+    const double y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+void
+locate_mpls(char* times, char* path)
+{
+    size_t count = 0;
+    size_t capacity = 16;
+    double* times_sec = (double*) calloc(capacity, sizeof(double));
+    char* p = times;
+    char* end;
+    size_t i;
+
+    while (*p != '\0')
+    {
+        double t = strtod(p, &end);
+        if (end == p || (*end != ',' && *end != '\0'))
+        {
+            DIE("Invalid time list: \"%s\".", times);
+        }
+        if (count == capacity)
+        {
+            capacity *= 2;
+            times_sec = (double*) realloc(times_sec, capacity * sizeof(double));
+        }
+        times_sec[count++] = t;
+        p = (*end == ',') ? end + 1 : end;
+    }
+
+    qsort(times_sec, count, sizeof(double), compare_doubles);
+
     mpls_file_t mpls_file = init_mpls(path);
     playlist_t playlist = create_playlist_t();
+    playlist_index_t index;
 
-    parse_stream_clips(&mpls_file, &playlist);
-    parse_chapters(&mpls_file, &playlist);
-    
-    print_playlist_header(&mpls_file, &playlist);
-    print_playlist_details(&playlist);
-    print_tracks_header(&playlist);
-    print_tracks(&playlist);
-    print_stream_clips_header(&playlist);
-    print_stream_clips(&playlist);
-    print_chapters_header(&playlist);
-    print_chapters(&playlist);
+    parse_playlist(&mpls_file, &playlist, FIELD_ALL);
+    init_playlist_index_t(&index, &playlist);
+
+    size_t* clip_indexes = (size_t*) calloc(count + 1, sizeof(size_t));
+    size_t* chapter_indexes = (size_t*) calloc(count + 1, sizeof(size_t));
+    double* offsets_sec = (double*) calloc(count + 1, sizeof(double));
+
+    playlist_index_find_clips_sorted(&index, times_sec, count, clip_indexes, offsets_sec);
+    playlist_index_find_chapters_sorted(&index, times_sec, count, chapter_indexes);
+
+    char time_human[15];
+    char offset_human[15];
+    printf("%s\n", mpls_file.path);
+    printf("\t time           filename     offset         chapter\n");
+    printf("\t ------------   ----------   ------------   -------\n");
+    for (i = 0; i < count; i++)
+    {
+        format_duration_to(times_sec[i], time_human);
+        if (clip_indexes[i] == PLAYLIST_INDEX_NONE)
+        {
+            printf("\t %s   (outside of the playlist)\n", time_human);
+            continue;
+        }
+        format_duration_to(offsets_sec[i], offset_human);
+        printf("\t %s   %s   %s   ", time_human, index.clips[clip_indexes[i]]->filename, offset_human);
+        if (chapter_indexes[i] == PLAYLIST_INDEX_NONE)
+            printf("%7s\n", "-");
+        else
+            printf("%7zu\n", chapter_indexes[i] + 1);
+    }
+    printf("\n");
 
+    free(clip_indexes);
+    free(chapter_indexes);
+    free(offsets_sec);
+    free(times_sec);
+    free_playlist_index_members(&index);
     free_playlist_members(&playlist);
     free_mpls_file_members(&mpls_file);
 }
 
+int
+parse_fields(const char* list)
+{
+    static const struct {
+        const char* name;
+        int field;
+    } field_names[] = {
+        { "duration", FIELD_DURATION },
+        { "clips",    FIELD_CLIPS    },
+        { "tracks",   FIELD_TRACKS   },
+        { "chapters", FIELD_CHAPTERS },
+        { "streams",  FIELD_STREAMS  },
+        { "playback", FIELD_PLAYBACK },
+        { "extensions", FIELD_EXTENSIONS },
+        { "all",      FIELD_ALL      }
+    };
+
+    int fields = 0;
+    const char* p = list;
+
+    while (*p != '\0')
+    {
+        size_t len = strcspn(p, ",");
+        size_t i;
+
+        for (i = 0; i < ARRAY_SIZE(field_names); i++)
+        {
+            if (strlen(field_names[i].name) == len && strncmp(p, field_names[i].name, len) == 0)
+                break;
+        }
+        if (i == ARRAY_SIZE(field_names))
+            return -1;
+
+        fields |= field_names[i].field;
+        p += len;
+        if (*p == ',')
+            p++;
+    }
+
+    return fields;
+}
+
+
+#define USAGE "Usage: parse_mpls [ --stats[=json] ] [ --jobs N ] [ --format text|bin ] [ --fields duration,clips,tracks,chapters,streams,playback,extensions | --query EXPR | --locate SEC[,SEC...] | --mem-report ] { MPLS_FILE_PATH | DISC_PATH | - } [ ... ] | --fd N | --read-bin BIN_FILE [ ... ] | --watch [ --debounce MS ] DIR [ ... ] | --verify [ --checksums FILE ] [ --direct ] DISC_PATH [ ... ] | --bitrate [ --bitrate-interval SEC ] MPLS_FILE_PATH | --fingerprint [ --compare ] DISC_PATH [ ... ] | --quick-check DISC_PATH [ ... ] | --export-chapters matroska,ogm,ffmetadata [ --export-dir DIR ] [ --query EXPR ] { MPLS_FILE_PATH | DISC_PATH } [ ... ]"
 
+#ifndef PARSE_MPLS_NO_MAIN
 /*
  * 
  */
 int main(int argc, char** argv) {
-    if (argc < 2)
+    static struct option long_options[] = {
+        { "query",  required_argument, NULL, 'q' },
+        { "locate", required_argument, NULL, 'l' },
+        { "fields", required_argument, NULL, 'f' },
+        { "jobs",   required_argument, NULL, 'j' },
+        { "stats",  optional_argument, NULL, 's' },
+        { "mem-report", no_argument,   NULL, 'm' },
+        { "fd",     required_argument, NULL, 'd' },
+        { "format", required_argument, NULL, 'o' },
+        { "read-bin", no_argument,     NULL, 'b' },
+        { "watch",  no_argument,       NULL, 'w' },
+        { "debounce", required_argument, NULL, 'D' },
+        { "verify", no_argument,       NULL, 'V' },
+        { "checksums", required_argument, NULL, 'c' },
+        { "direct", no_argument,       NULL, 'I' },
+        { "bitrate", no_argument,      NULL, 'B' },
+        { "bitrate-interval", required_argument, NULL, 'R' },
+        { "fingerprint", no_argument,  NULL, 'F' },
+        { "compare", no_argument,      NULL, 'C' },
+        { "quick-check", no_argument,  NULL, 'K' },
+        { "export-chapters", required_argument, NULL, 'E' },
+        { "export-dir", required_argument, NULL, 'X' },
+        { NULL,     0,                 NULL,  0  }
+    };
+
+    char* query = NULL;
+    char* locate = NULL;
+    int fields = FIELD_DEFAULT;
+    int jobs = 1;
+    bool jobs_given = false;
+    bool mem_report = false;
+    int input_fd = -1;
+    bool has_stdin = false;
+    bool bin_output = false;
+    bool bin_input = false;
+    bool watch = false;
+    int debounce_ms = WATCH_DEFAULT_DEBOUNCE_MS;
+    bool verify = false;
+    char* checksum_path = NULL;
+    bool direct = false;
+    bool bitrate = false;
+    double bitrate_interval_sec = 1.0;
+    bool fingerprint = false;
+    bool compare = false;
+    bool quick_check = false;
+    int export_formats = 0;
+    char* export_dir = ".";
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "q:l:f:j:", long_options, NULL)) != -1)
     {
-        DIE("Usage: parse_mpls MPLS_FILE_PATH [ MPLS_FILE_PATH ... ]");
+        switch (opt)
+        {
+            case 'q':
+                query = optarg;
+                break;
+            case 'l':
+                locate = optarg;
+                break;
+            case 'f':
+                fields = parse_fields(optarg);
+                if (fields <= 0)
+                {
+                    DIE("Invalid --fields list: \"%s\".", optarg);
+                }
+                break;
+            case 'j':
+                jobs = atoi(optarg);
+                if (jobs < 1)
+                {
+                    DIE("Invalid --jobs count: \"%s\".", optarg);
+                }
+                jobs_given = true;
+                break;
+            case 'm':
+                mem_report = true;
+                break;
+            case 'd':
+                input_fd = atoi(optarg);
+                if (input_fd < 0 || (input_fd == 0 && strcmp(optarg, "0") != 0))
+                {
+                    DIE("Invalid --fd: \"%s\".", optarg);
+                }
+                break;
+            case 'o':
+                if (strcmp(optarg, "text") == 0)
+                    bin_output = false;
+                else if (strcmp(optarg, "bin") == 0)
+                    bin_output = true;
+                else
+                {
+                    DIE("Invalid --format: \"%s\" (expected text or bin).", optarg);
+                }
+                break;
+            case 'b':
+                bin_input = true;
+                break;
+            case 'w':
+                watch = true;
+                break;
+            case 'D':
+                debounce_ms = atoi(optarg);
+                if (debounce_ms < 0 || (debounce_ms == 0 && strcmp(optarg, "0") != 0))
+                {
+                    DIE("Invalid --debounce: \"%s\".", optarg);
+                }
+                break;
+            case 'V':
+                verify = true;
+                break;
+            case 'c':
+                checksum_path = optarg;
+                break;
+            case 'I':
+                direct = true;
+                break;
+            case 'B':
+                bitrate = true;
+                break;
+            case 'F':
+                fingerprint = true;
+                break;
+            case 'C':
+                compare = true;
+                break;
+            case 'K':
+                quick_check = true;
+                break;
+            case 'E':
+                export_formats = chapter_parse_formats(optarg);
+                if (export_formats <= 0)
+                {
+                    DIE("Invalid --export-chapters list: \"%s\" (expected matroska, ogm, ffmetadata or all).", optarg);
+                }
+                break;
+            case 'X':
+                export_dir = optarg;
+                break;
+            case 'R':
+                bitrate_interval_sec = atof(optarg);
+                if (sec_to_timecode(bitrate_interval_sec) < 1)
+                {
+                    DIE("Invalid --bitrate-interval: \"%s\".", optarg);
+                }
+                break;
+            case 's':
+                if (optarg == NULL || strcmp(optarg, "text") == 0)
+                    stats_enable(STATS_FORMAT_TEXT);
+                else if (strcmp(optarg, "json") == 0)
+                    stats_enable(STATS_FORMAT_JSON);
+                else
+                {
+                    DIE("Invalid --stats format: \"%s\" (expected text or json).", optarg);
+                }
+                break;
+            default:
+                DIE(USAGE);
+        }
+    }
+
+    if (input_fd >= 0)
+    {
+        char label[32];
+        snprintf(label, sizeof(label), "<fd %i>", input_fd);
+        ingest_run(input_fd, label, fields);
+        return (EXIT_SUCCESS);
+    }
+
+    if (optind >= argc)
+    {
+        DIE(USAGE);
+    }
+
+    // Before --query, which then selects the playlists to export
+    if (export_formats != 0)
+    {
+        if (!chapter_export_run(argv + optind, argc - optind, export_formats, export_dir, query))
+            return (EXIT_FAILURE);
+        return (EXIT_SUCCESS);
     }
     
+    if (query != NULL)
+    {
+        query_mpls(query, argv + optind, argc - optind);
+        return (EXIT_SUCCESS);
+    }
+
+    if (mem_report)
+    {
+        mem_report_mpls(argv + optind, argc - optind, fields);
+        return (EXIT_SUCCESS);
+    }
+
+    if (fingerprint || compare)
+    {
+        if (!fingerprint_run(argv + optind, argc - optind, compare))
+            return (EXIT_FAILURE);
+        return (EXIT_SUCCESS);
+    }
+
+    // Stream files are read and scanned in parallel chunks: one worker per CPU unless --jobs says otherwise
+    if ((verify || bitrate || quick_check) && !jobs_given)
+        jobs = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? (int) sysconf(_SC_NPROCESSORS_ONLN) : 1;
+
+    if (quick_check)
+    {
+        if (!quick_check_run(argv + optind, argc - optind, jobs))
+            return (EXIT_FAILURE);
+        return (EXIT_SUCCESS);
+    }
+
+    if (verify)
+    {
+        if (!verify_run(argv + optind, argc - optind, checksum_path, direct, jobs))
+            return (EXIT_FAILURE);
+        return (EXIT_SUCCESS);
+    }
+
+    if (bitrate)
+    {
+        if (argc - optind != 1)
+        {
+            DIE("--bitrate takes exactly one playlist.");
+        }
+        if (!bitrate_run(argv[optind], bitrate_interval_sec, bin_output, jobs))
+            return (EXIT_FAILURE);
+        return (EXIT_SUCCESS);
+    }
+
+    if (watch)
+    {
+        watch_run(argv + optind, argc - optind, fields, debounce_ms);
+        return (EXIT_FAILURE);
+    }
+
+    if (bin_input)
+    {
+        read_bin_mpls(argv + optind, argc - optind);
+        return (EXIT_SUCCESS);
+    }
+
+    if (bin_output)
+    {
+        bin_mpls(argv + optind, argc - optind, fields);
+        return (EXIT_SUCCESS);
+    }
+
     int i;
-    for(i = 1; i < argc; i++)
+    for (i = optind; i < argc; i++)
+        has_stdin |= strcmp(argv[i], "-") == 0;
+
+    // "-" is read in order with the other arguments, on this thread
+    for (i = optind; i < argc && locate == NULL && !has_stdin; i++)
     {
-        parse_mpls(argv[i]);
+        struct stat st;
+        if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode))
+        {
+            // At least one disc: schedule discs, playlists and clips as tasks
+            disc_run(argv + optind, argc - optind, fields, jobs);
+            return (EXIT_SUCCESS);
+        }
+    }
+
+    if (jobs > 1 && locate == NULL && !has_stdin)
+    {
+        pipeline_run(argv + optind, argc - optind, fields, jobs);
+        return (EXIT_SUCCESS);
+    }
+
+    for(i = optind; i < argc; i++)
+    {
+        if (locate != NULL)
+            locate_mpls(locate, argv[i]);
+        else if (strcmp(argv[i], "-") == 0)
+            ingest_run(STDIN_FILENO, "<stdin>", fields);
+        else
+            parse_mpls(argv[i], fields);
     }
     
     return (EXIT_SUCCESS);
 }
-
+#endif /* PARSE_MPLS_NO_MAIN */
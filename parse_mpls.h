@@ -8,6 +8,8 @@
 #ifndef PARSE_MPLS_H
 #define	PARSE_MPLS_H
 
+#include <ctype.h>
+#include <getopt.h>
 #include <libgen.h>
 #include <math.h>
 #include <stdarg.h>
@@ -38,10 +40,57 @@ extern "C" {
 #define TIME_OUT_POS 86
 
 #define CHAPTER_TYPE_ENTRY_MARK 1 /* standard chapter */
-#define CHAPTER_TYPE_LINK_POINT 2 /* unsupported ??? */
+#define CHAPTER_TYPE_LINK_POINT 2 /* link point (not a chapter) */
 
 #define CHAPTER_SIZE 14 /* number of bytes per chapter entry */
 
+#define PLAYLIST_HEADER_SIZE 10 /* length (4), reserved (2), PlayItem count (2), SubPath count (2) */
+#define PLAY_ITEM_FIXED_SIZE 32 /* bytes after the PlayItem length field up to the angle data */
+#define PLAY_ITEM_ANGLE_SIZE 10 /* clip name (5), codec (4), STC ID (1) per extra angle */
+#define STN_HEADER_SIZE      16 /* STN length (2), reserved (2), stream counts (7), reserved (5) */
+
+/*
+ * Sections of a playlist that can be requested with --fields.  Only the
+ * requested sections are decoded.
+ */
+#define FIELD_DURATION (1 << 0)
+#define FIELD_CLIPS    (1 << 1)
+#define FIELD_TRACKS   (1 << 2)
+#define FIELD_CHAPTERS (1 << 3)
+#define FIELD_STREAMS  (1 << 4)
+#define FIELD_PLAYBACK (1 << 5) /* AppInfoPlayList */
+#define FIELD_EXTENSIONS (1 << 6) /* ExtensionData */
+#define FIELD_DEFAULT  (FIELD_DURATION | FIELD_TRACKS | FIELD_CLIPS | FIELD_CHAPTERS)
+#define FIELD_ALL      (FIELD_DEFAULT | FIELD_STREAMS | FIELD_PLAYBACK | FIELD_EXTENSIONS)
+
+#define FIELD_FILE_SIZES (1 << 8) /* clip file sizes were looked up (disc mode); not selectable */
+
+#define APP_INFO_POS 40 /* AppInfoPlayList: length (4), reserved (1), playback type (1), playback count (2), UO mask (8), flags (2) */
+#define EXTENSION_ENTRY_SIZE 12 /* ID1 (2), ID2 (2), start address (4), length (4) */
+
+#define PLAYBACK_TYPE_SEQUENTIAL 1
+#define PLAYBACK_TYPE_RANDOM     2
+#define PLAYBACK_TYPE_SHUFFLE    3
+
+/* ExtensionData entry IDs */
+#define EXTENSION_ID(id1, id2) (((uint32_t) (id1) << 16) | (uint32_t) (id2))
+#define EXTENSION_PIP_METADATA EXTENSION_ID(1, 1) /* Picture-in-Picture metadata */
+#define EXTENSION_STN_SS       EXTENSION_ID(2, 1) /* stereoscopic (3D) STN table */
+#define EXTENSION_SUBPATH      EXTENSION_ID(2, 2) /* SubPath extensions (e.g., 3D dependent view) */
+#define EXTENSION_STATIC_HDR   EXTENSION_ID(3, 5) /* UHD static HDR metadata */
+
+#define HDR_STATIC_METADATA_SIZE 28 /* dynamic range (4 bits), reserved (4 bits + 3), primaries (12), white point (4), luminance (4), MaxCLL (2), MaxFALL (2) */
+#define HDR_STATIC_METADATA_MAX  4
+
+#define VIDEO_CODING_HEVC 0x24 /* stream coding type of UHD (MPLS0300) primary video */
+
+#define DYNAMIC_RANGE_SDR          0
+#define DYNAMIC_RANGE_HDR10        1
+#define DYNAMIC_RANGE_DOLBY_VISION 2
+
+#define COLOR_SPACE_BT709  1
+#define COLOR_SPACE_BT2020 2
+
 #define TIMECODE_DIV 45000.00 /* divide timecodes (int32) by this value to get
                                  the number of seconds (double) */
 
@@ -55,6 +104,19 @@ extern "C" {
 #define ARRAY_SIZE(x)  (sizeof(x) / sizeof(x[0]))
 
 
+/*
+ * Enums
+ */
+
+
+typedef enum {
+    MPLS_VERSION_0100,           /* BD-ROM */
+    MPLS_VERSION_0200,           /* BD-ROM (BD-Live, 3D) */
+    MPLS_VERSION_0300,           /* UHD BD-ROM */
+    MPLS_VERSION_COUNT
+} mpls_version_t;
+
+
 /*
  * Structs - BD-ROM
  */
@@ -65,10 +127,12 @@ typedef struct {
     FILE* file;
     long size;
     char* data;
-    char header[9];              /* "MPLS0100" or "MPLS0200" */
+    char header[9];              /* "MPLS0100", "MPLS0200" or "MPLS0300" */
+    mpls_version_t version;      /* decoded from the header */
     int32_t pos;                 /* cursor containing the current byte offset in the file during parsing */
     int32_t playlist_pos;        /* byte offset of the playlist and stream clip information */
     int32_t chapter_pos;         /* byte offset of the chapter list */
+    int32_t extension_pos;       /* byte offset of ExtensionData; 0 if absent (or ignored as malformed) */
     int16_t total_chapter_count; /* total number of chapters (including both supported (0x1) and unsupported (0x2) chapter types) */
     int32_t time_in;
     int32_t time_out;
@@ -89,6 +153,12 @@ typedef struct stream_clip_s {
     int secondary_video_count;
     int secondary_audio_count;
     int pip_count; /* Picture-in-Picture (PiP) */
+    uint8_t video_coding_type; /* first primary video stream (MPLS0300 only; 0 if unknown) */
+    uint8_t dynamic_range;     /* DYNAMIC_RANGE_*; HEVC primary video only */
+    uint8_t color_space;       /* COLOR_SPACE_*; HEVC primary video only */
+    bool hdr_plus;             /* HDR10+ dynamic metadata present */
+    int64_t stream_file_size; /* size of the .m2ts file in bytes (disc mode only; 0 if unknown) */
+    int64_t clip_info_size;   /* size of the .clpi file in bytes (disc mode only; 0 if unknown) */
     int index;
     struct stream_clip_s* next;
 } stream_clip_t; /* parsed data from .m2ts + .cpli files */
@@ -99,6 +169,45 @@ typedef struct {
     int count;
 } stream_clip_list_t;
 
+typedef struct {
+    uint8_t type;             /* CHAPTER_TYPE_ENTRY_MARK or CHAPTER_TYPE_LINK_POINT */
+    uint16_t clip_index;      /* index of the referenced stream clip (PlayItem) */
+    int32_t time;             /* timecode within the referenced clip */
+    uint16_t entry_es_pid;    /* PID of the elementary stream the mark points into (0xFFFF = none) */
+    int32_t duration;         /* timecode; 0 unless the mark has a duration */
+    double relative_time_sec; /* time relative to the start of the playlist */
+} playlist_mark_t; /* one PlayListMark entry */
+
+typedef struct {
+    uint8_t playback_type;       /* PLAYBACK_TYPE_* */
+    uint16_t playback_count;     /* random and shuffle playback only */
+    uint64_t uo_mask;            /* user operations prohibited while the playlist plays */
+    bool random_access;          /* PlayList_random_access_flag */
+    bool audio_mix;              /* audio_mix_app_flag */
+    bool lossless_bypass;        /* lossless_may_bypass_mixer_flag */
+} playlist_app_info_t; /* AppInfoPlayList */
+
+typedef struct {
+    uint8_t dynamic_range;       /* DYNAMIC_RANGE_* */
+    uint16_t display_primaries_x[3];
+    uint16_t display_primaries_y[3];
+    uint16_t white_point_x;
+    uint16_t white_point_y;
+    uint16_t max_luminance;      /* mastering display, cd/m2 */
+    uint16_t min_luminance;      /* mastering display, 0.0001 cd/m2 */
+    uint16_t max_cll;            /* maximum content light level, cd/m2 */
+    uint16_t max_fall;           /* maximum frame-average light level, cd/m2 */
+} hdr_static_metadata_t;
+
+typedef struct {
+    int entry_count;             /* entries in the ExtensionData directory */
+    int pip_block_count;         /* ID 1/1 */
+    bool stereoscopic;           /* ID 2/1 present (3D) */
+    int subpath_count;           /* ID 2/2 */
+    hdr_static_metadata_t hdr_static[HDR_STATIC_METADATA_MAX]; /* ID 3/5 */
+    int hdr_static_count;
+} playlist_extensions_t; /* ExtensionData */
+
 typedef struct {
     char filename[11]; /* uppercase - e.g., "00801.MPLS" */
     double time_in_sec;
@@ -107,8 +216,14 @@ typedef struct {
     char duration_formatted[15]; /* HH:MM:SS.mmm */
     stream_clip_list_t stream_clip_list;
     stream_clip_list_t chapter_stream_clip_list;
-    double* chapters;
+    double* chapters;            /* relative start times of the entry marks (chapters) */
     size_t chapter_count;
+    playlist_mark_t* marks;      /* all marks (entry marks and link points) in file order */
+    size_t mark_count;
+    int fields;                  /* FIELD_* sections decoded into this playlist */
+    mpls_version_t version;
+    playlist_app_info_t app_info;     /* FIELD_PLAYBACK only */
+    playlist_extensions_t extensions; /* FIELD_EXTENSIONS only */
 } playlist_t;
 
 
@@ -135,10 +250,19 @@ die (const char* filename, int line_number, const char * format, ...);
 double
 timecode_to_sec(int32_t timecode);
 
+/**
+ * Converts a number of seconds to the nearest timecode (45 kHz ticks).
+ * @param sec
+ * @return Number of ticks represented by sec
+ */
+int64_t
+sec_to_timecode(double sec);
+
 /**
  * Converts a duration in seconds to a human-readable string in the format HH:MM:SS.mmm
  * @param length_sec
- * @return 
+ * @return A string that the caller must release with MPLS_FREE().
+ *         Prefer format_duration_to() with a 15-char buffer.
  */
 char*
 format_duration(double length_sec);
@@ -146,6 +270,18 @@ format_duration(double length_sec);
 void
 format_duration_to(double length_sec, char* str);
 
+/**
+ * Formats a non-negative timecode as HH:MM:SS with the given number of
+ * decimals (e.g., 3 for milliseconds, 9 for nanoseconds), rounding to the
+ * nearest unit in integer arithmetic.
+ * @param ticks 45 kHz ticks
+ * @param decimals 0 to 9
+ * @param dest receives at most 30 chars plus the NUL
+ * @return Length of the string written.
+ */
+int
+format_ticks_to(int64_t ticks, int decimals, char* dest);
+
 
 /*
  * Linked list functions
@@ -205,7 +341,7 @@ char*
 file_read_string_cursor(FILE* file, int* offset, int length);
 
 /**
- * Copies a sequence of bytes into a newly alloc'd C string and advances the cursor position by #{length}.
+ * Copies a sequence of bytes into a newly alloc'd C string (release with MPLS_FREE()) and advances the cursor position by #{length}.
  * @param bytes
  * @param offset
  * @param length
@@ -214,6 +350,14 @@ file_read_string_cursor(FILE* file, int* offset, int length);
 char*
 copy_string_cursor(char* bytes, int* offset, int length);
 
+/**
+ * Hashes a C string (FNV-1a) for open-addressing tables keyed by strings.
+ * @param str
+ * @return 
+ */
+uint32_t
+hash_string(const char* str);
+
 
 /*
  * Struct initialization
@@ -262,9 +406,69 @@ free_playlist_members(playlist_t* playlist);
  */
 
 
+/**
+ * Reads the .mpls file at the given path and validates it (see read_mpls_header()
+ * and validate_mpls_sections()).  Exits via DIE() if the file is invalid.
+ * @param path
+ * @return 
+ */
 mpls_file_t
 init_mpls(char* path);
 
+/**
+ * Reads the whole file at the given path into mpls_file->data without
+ * validating it.
+ * @param mpls_file
+ * @param path
+ * @param error receives a message if the file cannot be read
+ * @param error_size
+ * @return false if the file cannot be read.
+ */
+bool
+load_mpls(mpls_file_t* mpls_file, char* path, char* error, size_t error_size);
+
+/**
+ * Decodes and validates the header of the .mpls file loaded into
+ * mpls_file->data / mpls_file->size.
+ * @param mpls_file
+ * @param error receives a message if the header is invalid
+ * @param error_size
+ * @return false if the header is invalid.
+ */
+bool
+read_mpls_header(mpls_file_t* mpls_file, char* error, size_t error_size);
+
+/**
+ * Checks the extent of every section the parser reads (PlayItems, their
+ * angle and STN headers, chapter marks and their PlayItem references)
+ * against mpls_file->size.  Once this returns true, the parse functions
+ * need no further bounds checks.
+ * @param mpls_file header already decoded by read_mpls_header()
+ * @param error receives a message if a section is invalid
+ * @param error_size
+ * @return false if any section is out of bounds.
+ */
+bool
+validate_mpls_sections(mpls_file_t* mpls_file, char* error, size_t error_size);
+
+/**
+ * read_mpls_header() followed by validate_mpls_sections(), for a file
+ * already loaded into mpls_file->data / mpls_file->size.
+ * @param mpls_file
+ * @param error receives a message if the file is invalid
+ * @param error_size
+ * @return false if the file is invalid.
+ */
+bool
+check_mpls(mpls_file_t* mpls_file, char* error, size_t error_size);
+
+/**
+ * Walks the PlayItems.  Dispatches once, on mpls_file->version, to a variant
+ * of the parse loop specialized for that version (MPLS0300 additionally
+ * decodes the UHD video attributes), so the loop itself has no version checks.
+ * @param mpls_file
+ * @param playlist
+ */
 void
 parse_stream_clips(mpls_file_t* mpls_file, playlist_t* playlist);
 
@@ -274,11 +478,114 @@ parse_stream_clip();
 void
 parse_chapters(mpls_file_t* mpls_file, playlist_t* playlist);
 
+/**
+ * Decodes AppInfoPlayList (playback type and count, UO mask, flags) into
+ * playlist->app_info.
+ * @param mpls_file
+ * @param playlist
+ */
+void
+parse_app_info(mpls_file_t* mpls_file, playlist_t* playlist);
+
+/**
+ * Decodes the known ExtensionData entries (PiP metadata, 3D STN, SubPath
+ * extensions, static HDR metadata) into playlist->extensions.  Unknown
+ * entries are counted and skipped.
+ * @param mpls_file
+ * @param playlist
+ */
+void
+parse_extension_data(mpls_file_t* mpls_file, playlist_t* playlist);
+
 void
 parse_chapter();
 
+/**
+ * Parses the requested sections of an initialized .mpls file.  PlayItems are
+ * skipped by their length field when no per-clip details were requested.
+ * @param mpls_file
+ * @param playlist
+ * @param fields FIELD_* flags
+ */
+void
+parse_playlist(mpls_file_t* mpls_file, playlist_t* playlist, int fields);
+
+/**
+ * Writes the human-readable report of the parsed sections of a playlist.
+ * @param out
+ * @param mpls_file
+ * @param playlist
+ */
+void
+format_playlist(FILE* out, mpls_file_t* mpls_file, playlist_t* playlist);
+
+/**
+ * Formats the playlist and writes it to stdout with a single write.
+ * @param mpls_file
+ * @param playlist
+ */
+void
+output_playlist(mpls_file_t* mpls_file, playlist_t* playlist);
+
+void
+parse_mpls(char* path, int fields);
+
+/**
+ * Parses a comma-separated --fields list (e.g., "duration,chapters").
+ * @param list
+ * @return FIELD_* flags, or -1 if the list contains an unknown field.
+ */
+int
+parse_fields(const char* list);
+
+/**
+ * Parses every playlist into a catalog, runs the query against it and prints
+ * the matching playlists.
+ * @param query comma-separated predicates (see catalog_parse_query())
+ * @param paths
+ * @param path_count
+ */
+void
+query_mpls(char* query, char** paths, int path_count);
+
+/**
+ * Parses and formats every playlist (or every playlist of a disc) one at a
+ * time through the tracking allocator, and prints the bytes each one
+ * retains, its peak and any bytes it leaked, followed by the allocation
+ * sites.  Exits with EXIT_FAILURE if anything is still allocated at the end.
+ * @param paths
+ * @param path_count
+ * @param fields FIELD_* flags
+ */
+void
+mem_report_mpls(char** paths, int path_count, int fields);
+
+/**
+ * Parses every playlist (and every playlist of every disc) and writes them
+ * to stdout in the binary format (see mplsbin.h).
+ * @param paths
+ * @param path_count
+ * @param fields FIELD_* flags
+ */
+void
+bin_mpls(char** paths, int path_count, int fields);
+
+/**
+ * Maps binary playlist files written by bin_mpls() and prints their
+ * playlists like parse_mpls() does, without re-parsing anything.
+ * @param paths
+ * @param path_count
+ */
+void
+read_bin_mpls(char** paths, int path_count);
+
+/**
+ * Prints the stream clip and chapter that play at each of the given times.
+ * @param times comma-separated playlist times in seconds
+ * @param path
+ */
 void
-parse_mpls(char* path);
+locate_mpls(char* times, char* path);
 
 
 
@@ -0,0 +1,368 @@
+/*
+ * File:   pipeline.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "pipeline.h"
+#include "stats.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+
+/*
+ * Private types
+ */
+
+
+typedef struct {
+    size_t seq;                  /* position of the path on the command line */
+    mpls_file_t mpls_file;
+    playlist_t playlist;
+    char* output;                /* formatted report (open_memstream buffer) */
+    size_t output_size;
+    bool failed;
+    char error[256];
+} pipeline_job_t;
+
+typedef struct {
+    char** paths;
+    size_t path_count;
+    int fields;
+    int parser_count;
+    int formatter_count;
+
+    atomic_size_t next_path;     /* next path index for the readers to claim */
+    atomic_size_t written;       /* number of playlists the writer has output */
+    atomic_int readers_left;
+    atomic_int parsers_left;
+    atomic_int formatters_left;
+
+    pipeline_queue_t parse_queue;
+    pipeline_queue_t format_queue;
+    pipeline_queue_t write_queue;
+} pipeline_t;
+
+/* Pushed once per downstream consumer when a stage has finished */
+static pipeline_job_t end_of_stream;
+#define PIPELINE_END (&end_of_stream)
+
+
+/*
+ * Queue functions
+ */
+
+
+void
+init_pipeline_queue_t(pipeline_queue_t* queue, size_t capacity)
+{
+    size_t i;
+    queue->cells = (pipeline_cell_t*) calloc(capacity, sizeof(pipeline_cell_t));
+    queue->mask = capacity - 1;
+    for (i = 0; i < capacity; i++)
+        atomic_init(&queue->cells[i].sequence, i);
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+}
+
+void
+free_pipeline_queue_members(pipeline_queue_t* queue)
+{
+    free(queue->cells); queue->cells = NULL;
+}
+
+bool
+pipeline_queue_try_push(pipeline_queue_t* queue, void* data)
+{
+    pipeline_cell_t* cell;
+    size_t pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+    for (;;)
+    {
+        cell = &queue->cells[pos & queue->mask];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&queue->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false; /* full */
+        }
+        else
+        {
+            pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        }
+    }
+
+    cell->data = data;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+bool
+pipeline_queue_try_pop(pipeline_queue_t* queue, void** data)
+{
+    pipeline_cell_t* cell;
+    size_t pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+    for (;;)
+    {
+        cell = &queue->cells[pos & queue->mask];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&queue->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false; /* empty */
+        }
+        else
+        {
+            pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        }
+    }
+
+    *data = cell->data;
+    atomic_store_explicit(&cell->sequence, pos + queue->mask + 1, memory_order_release);
+    return true;
+}
+
+
+/*
+ * Private functions
+ */
+
+
+/**
+ * Yields for the first few retries, then sleeps briefly so an idle stage
+ * does not burn a core while it waits on disk or on another stage.
+ */
+static void
+backoff(unsigned* spins)
+{
+    if ((*spins)++ < 64)
+    {
+        sched_yield();
+    }
+    else
+    {
+        struct timespec ts = { 0, 50000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void
+push_blocking(pipeline_queue_t* queue, pipeline_job_t* job)
+{
+    unsigned spins = 0;
+    while (!pipeline_queue_try_push(queue, job))
+        backoff(&spins);
+}
+
+static pipeline_job_t*
+pop_blocking(pipeline_queue_t* queue)
+{
+    unsigned spins = 0;
+    void* job;
+    while (!pipeline_queue_try_pop(queue, &job))
+        backoff(&spins);
+    return (pipeline_job_t*) job;
+}
+
+static void*
+reader_main(void* arg)
+{
+    pipeline_t* pipeline = (pipeline_t*) arg;
+    size_t seq;
+    int i;
+
+    while ((seq = atomic_fetch_add(&pipeline->next_path, 1)) < pipeline->path_count)
+    {
+        unsigned spins = 0;
+
+        // Stay within the writer's reorder window
+        while (seq >= atomic_load(&pipeline->written) + PIPELINE_MAX_IN_FLIGHT)
+            backoff(&spins);
+
+        pipeline_job_t* job = (pipeline_job_t*) calloc(1, sizeof(pipeline_job_t));
+        job->seq = seq;
+        job->mpls_file = create_mpls_file_t();
+        job->playlist = create_playlist_t();
+
+        if (!load_mpls(&job->mpls_file, pipeline->paths[seq], job->error, sizeof(job->error)))
+            job->failed = true;
+
+        push_blocking(&pipeline->parse_queue, job);
+    }
+
+    if (atomic_fetch_sub(&pipeline->readers_left, 1) == 1)
+    {
+        for (i = 0; i < pipeline->parser_count; i++)
+            push_blocking(&pipeline->parse_queue, PIPELINE_END);
+    }
+
+    return NULL;
+}
+
+static void*
+parser_main(void* arg)
+{
+    pipeline_t* pipeline = (pipeline_t*) arg;
+    pipeline_job_t* job;
+    int i;
+
+    while ((job = pop_blocking(&pipeline->parse_queue)) != PIPELINE_END)
+    {
+        if (!job->failed && !check_mpls(&job->mpls_file, job->error, sizeof(job->error)))
+            job->failed = true;
+
+        if (!job->failed)
+            parse_playlist(&job->mpls_file, &job->playlist, pipeline->fields);
+
+        push_blocking(&pipeline->format_queue, job);
+    }
+
+    if (atomic_fetch_sub(&pipeline->parsers_left, 1) == 1)
+    {
+        for (i = 0; i < pipeline->formatter_count; i++)
+            push_blocking(&pipeline->format_queue, PIPELINE_END);
+    }
+
+    return NULL;
+}
+
+static void*
+formatter_main(void* arg)
+{
+    pipeline_t* pipeline = (pipeline_t*) arg;
+    pipeline_job_t* job;
+
+    while ((job = pop_blocking(&pipeline->format_queue)) != PIPELINE_END)
+    {
+        if (!job->failed)
+        {
+            FILE* out = open_memstream(&job->output, &job->output_size);
+            format_playlist(out, &job->mpls_file, &job->playlist);
+            fclose(out);
+        }
+
+        // Only the formatted text travels on to the writer
+        free_playlist_members(&job->playlist);
+        free_mpls_file_members(&job->mpls_file);
+
+        push_blocking(&pipeline->write_queue, job);
+    }
+
+    if (atomic_fetch_sub(&pipeline->formatters_left, 1) == 1)
+        push_blocking(&pipeline->write_queue, PIPELINE_END);
+
+    return NULL;
+}
+
+/**
+ * Runs on the calling thread.  Jobs arrive in completion order and are held
+ * in a ring of PIPELINE_MAX_IN_FLIGHT slots until every earlier one is out.
+ */
+static void
+write_in_order(pipeline_t* pipeline)
+{
+    pipeline_job_t** pending = (pipeline_job_t**) calloc(PIPELINE_MAX_IN_FLIGHT, sizeof(pipeline_job_t*));
+    pipeline_job_t* job;
+    size_t next = 0;
+
+    while ((job = pop_blocking(&pipeline->write_queue)) != PIPELINE_END)
+    {
+        pending[job->seq % PIPELINE_MAX_IN_FLIGHT] = job;
+
+        while ((job = pending[next % PIPELINE_MAX_IN_FLIGHT]) != NULL)
+        {
+            pending[next % PIPELINE_MAX_IN_FLIGHT] = NULL;
+
+            if (job->failed)
+            {
+                fflush(stdout);
+                DIE("%s", job->error);
+            }
+
+            STATS_BEGIN(output);
+            fwrite(job->output, 1, job->output_size, stdout);
+            STATS_END(output, STATS_PHASE_OUTPUT);
+            free(job->output);
+            free(job);
+
+            next++;
+            atomic_store(&pipeline->written, next);
+        }
+    }
+
+    free(pending);
+}
+
+
+/*
+ * Engine
+ */
+
+
+void
+pipeline_run(char** paths, int path_count, int fields, int jobs)
+{
+    pipeline_t pipeline;
+    int reader_count = PIPELINE_READER_COUNT;
+    int thread_count;
+    pthread_t* threads;
+    int t = 0;
+    int i;
+
+    if (jobs < 1)
+        jobs = 1;
+
+    pipeline.paths = paths;
+    pipeline.path_count = path_count;
+    pipeline.fields = fields;
+    pipeline.parser_count = jobs;
+    pipeline.formatter_count = jobs / 2 > 0 ? jobs / 2 : 1;
+    atomic_init(&pipeline.next_path, 0);
+    atomic_init(&pipeline.written, 0);
+    atomic_init(&pipeline.readers_left, reader_count);
+    atomic_init(&pipeline.parsers_left, pipeline.parser_count);
+    atomic_init(&pipeline.formatters_left, pipeline.formatter_count);
+    init_pipeline_queue_t(&pipeline.parse_queue, PIPELINE_QUEUE_CAPACITY);
+    init_pipeline_queue_t(&pipeline.format_queue, PIPELINE_QUEUE_CAPACITY);
+    init_pipeline_queue_t(&pipeline.write_queue, PIPELINE_QUEUE_CAPACITY);
+
+    thread_count = reader_count + pipeline.parser_count + pipeline.formatter_count;
+    threads = (pthread_t*) calloc(thread_count, sizeof(pthread_t));
+
+    for (i = 0; i < reader_count; i++)
+        pthread_create(&threads[t++], NULL, reader_main, &pipeline);
+    for (i = 0; i < pipeline.parser_count; i++)
+        pthread_create(&threads[t++], NULL, parser_main, &pipeline);
+    for (i = 0; i < pipeline.formatter_count; i++)
+        pthread_create(&threads[t++], NULL, formatter_main, &pipeline);
+
+    write_in_order(&pipeline);
+    fflush(stdout);
+
+    for (i = 0; i < thread_count; i++)
+        pthread_join(threads[i], NULL);
+
+    free(threads);
+    free_pipeline_queue_members(&pipeline.parse_queue);
+    free_pipeline_queue_members(&pipeline.format_queue);
+    free_pipeline_queue_members(&pipeline.write_queue);
+}
@@ -0,0 +1,111 @@
+/*
+ * File:   pipeline.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Staged, multi-threaded batch engine for parsing many playlists:
+ *
+ *   readers --> parse workers --> formatters --> ordered writer
+ *
+ * Stages are connected by bounded lock-free queues, so disk reads, parsing,
+ * formatting and stdout writes overlap.  Output is byte-for-byte identical to
+ * running parse_mpls() on each path in order.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef PIPELINE_H
+#define	PIPELINE_H
+
+#include "parse_mpls.h"
+
+#include <stdatomic.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+#define PIPELINE_QUEUE_CAPACITY 64   /* slots per inter-stage queue (power of two) */
+#define PIPELINE_MAX_IN_FLIGHT  256  /* max playlists between reader and writer */
+#define PIPELINE_READER_COUNT   4    /* concurrent file reads */
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    atomic_size_t sequence;
+    void* data;
+} pipeline_cell_t;
+
+/*
+ * Bounded multi-producer/multi-consumer queue (Dmitry Vyukov's array queue).
+ * head and tail live on separate cache lines so producers and consumers do
+ * not contend on the same line.
+ */
+typedef struct {
+    pipeline_cell_t* cells;
+    size_t mask;
+    char pad0[64];
+    atomic_size_t head; /* next slot to enqueue */
+    char pad1[64];
+    atomic_size_t tail; /* next slot to dequeue */
+    char pad2[64];
+} pipeline_queue_t;
+
+
+/*
+ * Queue functions
+ */
+
+
+void
+init_pipeline_queue_t(pipeline_queue_t* queue, size_t capacity);
+
+void
+free_pipeline_queue_members(pipeline_queue_t* queue);
+
+/**
+ * @return false if the queue is full.
+ */
+bool
+pipeline_queue_try_push(pipeline_queue_t* queue, void* data);
+
+/**
+ * @return false if the queue is empty.
+ */
+bool
+pipeline_queue_try_pop(pipeline_queue_t* queue, void** data);
+
+
+/*
+ * Engine
+ */
+
+
+/**
+ * Parses and prints every path in order, like calling parse_mpls() on each.
+ * If a playlist is invalid, everything before it is written and the process
+ * then exits via DIE(), just as the sequential loop would.
+ * @param paths
+ * @param path_count
+ * @param fields FIELD_* flags
+ * @param jobs number of parse workers (formatters get half as many, at least one)
+ */
+void
+pipeline_run(char** paths, int path_count, int fields, int jobs);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* PIPELINE_H */
@@ -0,0 +1,162 @@
+/*
+ * File:   playlist_index.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "playlist_index.h"
+
+
+/*
+ * Private functions
+ */
+
+
+/**
+ * Returns the number of elements of the ascending array that are <= value.
+ */
+static size_t
+upper_bound(const double* sorted, size_t count, double value)
+{
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (sorted[mid] <= value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+
+/*
+ * Lifecycle
+ */
+
+
+void
+init_playlist_index_t(playlist_index_t* index, const playlist_t* playlist)
+{
+    size_t i = 0;
+    stream_clip_t* clip;
+
+    // chapter_stream_clip_list holds only the primary clips, which are the ones
+    // laid end to end on the playlist timeline.
+    index->clip_count = playlist->chapter_stream_clip_list.count;
+    index->clips = (stream_clip_t**) calloc(index->clip_count + 1, sizeof(stream_clip_t*));
+    index->clip_starts = (double*) calloc(index->clip_count + 1, sizeof(double));
+    index->clip_ends = (double*) calloc(index->clip_count + 1, sizeof(double));
+
+    for (clip = playlist->chapter_stream_clip_list.first; clip != NULL; clip = clip->next)
+    {
+        index->clips[i] = clip;
+        index->clip_starts[i] = clip->relative_time_in_sec;
+        index->clip_ends[i] = clip->relative_time_out_sec;
+        i++;
+    }
+
+    index->chapter_count = playlist->chapter_count;
+    index->chapters = playlist->chapters;
+    index->duration_sec = playlist->duration_sec;
+}
+
+void
+free_playlist_index_members(playlist_index_t* index)
+{
+    free(index->clips); index->clips = NULL;
+    free(index->clip_starts); index->clip_starts = NULL;
+    free(index->clip_ends); index->clip_ends = NULL;
+    index->clip_count = 0;
+    index->chapters = NULL;
+    index->chapter_count = 0;
+}
+
+
+/*
+ * Single lookups
+ */
+
+
+size_t
+playlist_index_find_clip(const playlist_index_t* index, double time_sec, double* offset_sec)
+{
+    size_t n = upper_bound(index->clip_starts, index->clip_count, time_sec);
+
+    if (n == 0 || time_sec >= index->clip_ends[n - 1])
+        return PLAYLIST_INDEX_NONE;
+
+    if (offset_sec != NULL)
+        *offset_sec = time_sec - index->clip_starts[n - 1];
+
+    return n - 1;
+}
+
+size_t
+playlist_index_find_chapter(const playlist_index_t* index, double time_sec)
+{
+    size_t n;
+
+    if (time_sec >= index->duration_sec)
+        return PLAYLIST_INDEX_NONE;
+
+    n = upper_bound(index->chapters, index->chapter_count, time_sec);
+    return n == 0 ? PLAYLIST_INDEX_NONE : n - 1;
+}
+
+
+/*
+ * Batched lookups
+ */
+
+
+void
+playlist_index_find_clips_sorted(const playlist_index_t* index, const double* times_sec, size_t count,
+                                 size_t* clip_indexes, double* offsets_sec)
+{
+    size_t q;
+    size_t n = 0; /* number of clip starts <= the current query time */
+
+    for (q = 0; q < count; q++)
+    {
+        double t = times_sec[q];
+
+        while (n < index->clip_count && index->clip_starts[n] <= t)
+            n++;
+
+        if (n == 0 || t >= index->clip_ends[n - 1])
+        {
+            clip_indexes[q] = PLAYLIST_INDEX_NONE;
+            if (offsets_sec != NULL)
+                offsets_sec[q] = 0;
+        }
+        else
+        {
+            clip_indexes[q] = n - 1;
+            if (offsets_sec != NULL)
+                offsets_sec[q] = t - index->clip_starts[n - 1];
+        }
+    }
+}
+
+void
+playlist_index_find_chapters_sorted(const playlist_index_t* index, const double* times_sec, size_t count,
+                                    size_t* chapter_indexes)
+{
+    size_t q;
+    size_t n = 0; /* number of chapter starts <= the current query time */
+
+    for (q = 0; q < count; q++)
+    {
+        double t = times_sec[q];
+
+        while (n < index->chapter_count && index->chapters[n] <= t)
+            n++;
+
+        chapter_indexes[q] = (n == 0 || t >= index->duration_sec) ? PLAYLIST_INDEX_NONE : n - 1;
+    }
+}
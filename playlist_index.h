@@ -0,0 +1,112 @@
+/*
+ * File:   playlist_index.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Sorted interval index over the stream clips and chapters of a parsed
+ * playlist, for mapping a playlist time to (clip, offset) and to the chapter
+ * that contains it in O(log n).
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef PLAYLIST_INDEX_H
+#define	PLAYLIST_INDEX_H
+
+#include "parse_mpls.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+#define PLAYLIST_INDEX_NONE ((size_t) -1) /* returned when a time is outside of the playlist */
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    size_t clip_count;
+    stream_clip_t** clips;       /* primary (non-angle) clips in playlist order */
+    double* clip_starts;         /* relative_time_in_sec of each clip (ascending) */
+    double* clip_ends;           /* relative_time_out_sec of each clip */
+    size_t chapter_count;
+    const double* chapters;      /* borrowed from playlist_t.chapters (ascending) */
+    double duration_sec;
+} playlist_index_t;
+
+
+/*
+ * Lifecycle
+ */
+
+
+/**
+ * Builds the index.  The playlist must outlive the index.
+ * @param index
+ * @param playlist
+ */
+void
+init_playlist_index_t(playlist_index_t* index, const playlist_t* playlist);
+
+void
+free_playlist_index_members(playlist_index_t* index);
+
+
+/*
+ * Single lookups
+ */
+
+
+/**
+ * Finds the clip that is playing at the given playlist time.
+ * @param index
+ * @param time_sec playlist-relative time
+ * @param offset_sec if not NULL, receives the time within the clip
+ *                   (i.e., seconds after the clip's time_in_sec)
+ * @return Index of the clip in index->clips, or PLAYLIST_INDEX_NONE.
+ */
+size_t
+playlist_index_find_clip(const playlist_index_t* index, double time_sec, double* offset_sec);
+
+/**
+ * Finds the chapter that contains the given playlist time.
+ * @param index
+ * @param time_sec playlist-relative time
+ * @return Index into playlist_t.chapters, or PLAYLIST_INDEX_NONE if the time is
+ *         before the first chapter or past the end of the playlist.
+ */
+size_t
+playlist_index_find_chapter(const playlist_index_t* index, double time_sec);
+
+
+/*
+ * Batched lookups
+ *
+ * Both functions take query times sorted in ascending order and answer all of
+ * them in a single merge pass over the index (O(n + m) instead of O(m log n)).
+ */
+
+
+void
+playlist_index_find_clips_sorted(const playlist_index_t* index, const double* times_sec, size_t count,
+                                 size_t* clip_indexes, double* offsets_sec);
+
+void
+playlist_index_find_chapters_sorted(const playlist_index_t* index, const double* times_sec, size_t count,
+                                    size_t* chapter_indexes);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* PLAYLIST_INDEX_H */
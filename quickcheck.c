@@ -0,0 +1,518 @@
+/*
+ * File:   quickcheck.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "quickcheck.h"
+#include "disc.h"
+#include "m2ts.h"
+#include "scheduler.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+/*
+ * Private types
+ */
+
+
+typedef struct {
+    int64_t offset;              /* of the packet carrying the PCR */
+    int64_t time;                /* PCR in 45 kHz ticks */
+    int sequence;                /* STC sequence it belongs to; -1 without clip info */
+} pcr_sample_t;
+
+
+/*
+ * Private functions
+ */
+
+
+static void
+add_reason(quick_check_clip_t* clip, const char* format, ...)
+{
+    size_t len = strlen(clip->reasons);
+    va_list args;
+
+    if (clip->suspect_count++ > 0 && len + 2 < sizeof(clip->reasons))
+    {
+        strcpy(clip->reasons + len, "; ");
+        len += 2;
+    }
+
+    va_start(args, format);
+    vsnprintf(clip->reasons + len, sizeof(clip->reasons) - len, format, args);
+    va_end(args);
+}
+
+static int
+compare_clip_paths(const void* a, const void* b)
+{
+    return strcmp(((const quick_check_clip_t*) a)->path, ((const quick_check_clip_t*) b)->path);
+}
+
+static int
+compare_samples(const void* a, const void* b)
+{
+    const pcr_sample_t* x = (const pcr_sample_t*) a;
+    const pcr_sample_t* y = (const pcr_sample_t*) b;
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+static double
+ticks_to_sec(int64_t ticks)
+{
+    return ticks / TIMECODE_DIV;
+}
+
+/**
+ * @return Index of the STC sequence that source packet spn belongs to, or -1.
+ */
+static int
+find_stc_sequence(const clpi_info_t* info, int64_t spn)
+{
+    int i;
+
+    for (i = info->stc_sequence_count - 1; i >= 0; i--)
+    {
+        if (info->stc_sequences[i].spn_start <= spn)
+            return i;
+    }
+    return info->stc_sequence_count > 0 ? 0 : -1;
+}
+
+/**
+ * @return false if the unit could not be read in full; errno is set (EIO at the end of the file).
+ */
+static bool
+read_unit(int fd, uint8_t* buffer, int64_t offset)
+{
+    size_t got = 0;
+
+    while (got < M2TS_ALIGNED_UNIT_SIZE)
+    {
+        ssize_t n = pread(fd, buffer + got, M2TS_ALIGNED_UNIT_SIZE - got, offset + got);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            if (n == 0)
+                errno = EIO;
+            return false;
+        }
+        got += n;
+    }
+    STATS_ADD(STATS_BYTES_READ, M2TS_ALIGNED_UNIT_SIZE);
+    return true;
+}
+
+/**
+ * Looks for the PCRs of an aligned unit; PCRs on PIDs other than the PCR_PID
+ * of their STC sequence are ignored.
+ * @param want_last take the unit's last PCR instead of its first
+ * @return false if the unit has no PCR.
+ */
+static bool
+find_unit_pcr(const uint8_t* buffer, int64_t offset, const clpi_info_t* info, bool want_last, pcr_sample_t* sample)
+{
+    bool found = false;
+    int p;
+
+    for (p = 0; p < M2TS_ALIGNED_UNIT_SIZE / M2TS_PACKET_SIZE; p++)
+    {
+        const uint8_t* packet = buffer + p * M2TS_PACKET_SIZE;
+        int64_t packet_offset = offset + p * M2TS_PACKET_SIZE;
+        int sequence = info != NULL ? find_stc_sequence(info, packet_offset / M2TS_PACKET_SIZE) : -1;
+        int64_t pcr;
+
+        if (packet[4] != TS_SYNC_BYTE || !m2ts_packet_pcr(packet, &pcr))
+            continue;
+        if (sequence >= 0 && m2ts_packet_pid(packet) != info->stc_sequences[sequence].pcr_pid)
+            continue;
+
+        sample->offset = packet_offset;
+        sample->time = pcr / M2TS_TICKS_PER_TIMECODE;
+        sample->sequence = sequence;
+        found = true;
+        if (!want_last)
+            break;
+    }
+    return found;
+}
+
+static void
+check_size(quick_check_clip_t* clip, int64_t size, const clpi_info_t* info)
+{
+    double span_sec = ticks_to_sec(clip->time_out - clip->time_in);
+
+    if (size % M2TS_ALIGNED_UNIT_SIZE != 0)
+        add_reason(clip, "size %lli is not a whole number of aligned units", (long long) size);
+
+    if (info == NULL)
+        return;
+
+    if (size != (int64_t) info->source_packet_count * M2TS_PACKET_SIZE)
+    {
+        add_reason(clip, "size %lli, clip info says %lli", (long long) size,
+                   (long long) info->source_packet_count * M2TS_PACKET_SIZE);
+    }
+    else if (info->application_type == CLPI_APPLICATION_MAIN_MOVIE && info->ts_recording_rate > 0 && span_sec > 0)
+    {
+        // TS_recording_rate is the maximum mux rate in TS bytes; the file adds a 4-byte header to every packet
+        double limit = (double) info->ts_recording_rate * M2TS_PACKET_SIZE / TS_PACKET_SIZE * span_sec;
+
+        if (size < limit * QUICK_CHECK_MIN_FILL)
+        {
+            add_reason(clip, "size %lli is far below the %.0f bytes %.3f s at TS_recording_rate take",
+                       (long long) size, limit, span_sec);
+        }
+    }
+}
+
+/**
+ * Checks the PCRs of the samples, sorted by offset.  end is the last PCR of
+ * the file, or NULL if none was found.
+ */
+static void
+check_samples(quick_check_clip_t* clip, pcr_sample_t* samples, int sample_count, const pcr_sample_t* end,
+              const clpi_info_t* info)
+{
+    int64_t slack = sec_to_timecode(QUICK_CHECK_SLACK_SEC);
+    int64_t expected_end = clip->time_out;
+    const char* expected_by = "playlists need";
+    int i;
+
+    qsort(samples, sample_count, sizeof(pcr_sample_t), compare_samples);
+
+    for (i = 0; i < sample_count; i++)
+    {
+        const pcr_sample_t* sample = &samples[i];
+        int64_t first = clip->time_in;
+        int64_t last = clip->time_out;
+
+        if (sample->sequence >= 0)
+        {
+            first = info->stc_sequences[sample->sequence].presentation_start;
+            last = info->stc_sequences[sample->sequence].presentation_end;
+        }
+        if (sample->time < first - slack || sample->time > last + slack)
+        {
+            add_reason(clip, "PCR %.3f s at byte %lli is outside %.3f - %.3f s", ticks_to_sec(sample->time),
+                       (long long) sample->offset, ticks_to_sec(first), ticks_to_sec(last));
+            break;
+        }
+    }
+
+    for (i = 1; i < sample_count; i++)
+    {
+        const pcr_sample_t* a = &samples[i - 1];
+        const pcr_sample_t* b = &samples[i];
+
+        if (a->sequence == b->sequence && b->time < a->time - slack)
+        {
+            add_reason(clip, "PCR goes back from %.3f s at byte %lli to %.3f s at byte %lli",
+                       ticks_to_sec(a->time), (long long) a->offset, ticks_to_sec(b->time), (long long) b->offset);
+            break;
+        }
+    }
+
+    if (end == NULL)
+        return;
+
+    if (info != NULL && info->stc_sequence_count > 0)
+    {
+        if (end->sequence != info->stc_sequence_count - 1)
+        {
+            add_reason(clip, "stream ends in STC sequence %i of %i", end->sequence + 1, info->stc_sequence_count);
+            return;
+        }
+        expected_end = info->stc_sequences[end->sequence].presentation_end;
+        expected_by = "clip info says";
+    }
+
+    if (end->time < expected_end - slack)
+    {
+        add_reason(clip, "stream ends at %.3f s, %s %.3f s", ticks_to_sec(end->time), expected_by,
+                   ticks_to_sec(expected_end));
+    }
+}
+
+static void
+check_task(sched_t* sched, void* arg)
+{
+    quick_check_clip_t* clip = (quick_check_clip_t*) arg;
+    uint8_t buffer[M2TS_ALIGNED_UNIT_SIZE];
+    pcr_sample_t samples[QUICK_CHECK_SAMPLES];
+    pcr_sample_t end;
+    int sample_count = 0;
+    bool has_end = false;
+    bool sync_reported = false;
+    bool pcr_reported = false;
+    clpi_info_t info;
+    clpi_info_t* info_ptr = NULL;
+    char info_path[PATH_MAX];
+    char error[256];
+    struct stat st;
+    int64_t unit_count;
+    int points;
+    int i;
+    int fd;
+
+    if (!disc_find_clip_file(clip->playlist_path, clip->clip_filename, "CLIPINF", "clpi",
+                             info_path, sizeof(info_path), NULL))
+        add_reason(clip, "clip info file missing");
+    else if (!clpi_read(info_path, &info, error, sizeof(error)))
+        add_reason(clip, "invalid clip info file");
+    else
+        info_ptr = &info;
+
+    fd = open(clip->path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        add_reason(clip, "read error: %s", strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    check_size(clip, st.st_size, info_ptr);
+
+    unit_count = st.st_size / M2TS_ALIGNED_UNIT_SIZE;
+    if (unit_count == 0)
+    {
+        add_reason(clip, "no complete aligned unit");
+        close(fd);
+        return;
+    }
+
+    // Sample points spread evenly from the first unit to the last; the last
+    // one scans backwards from the end of the file for its final PCR
+    points = unit_count < QUICK_CHECK_SAMPLES ? (int) unit_count : QUICK_CHECK_SAMPLES;
+    for (i = 0; i < points; i++)
+    {
+        bool backwards = i == points - 1;
+        int64_t start = backwards ? unit_count - 1 : i * (unit_count - 1) / (points - 1);
+        int64_t step = backwards ? -1 : 1;
+        int64_t unit;
+        int scanned;
+        pcr_sample_t sample;
+        bool found = false;
+
+        for (unit = start, scanned = 0; unit >= 0 && unit < unit_count && scanned < QUICK_CHECK_SCAN_UNITS && !found;
+             unit += step, scanned++)
+        {
+            int64_t offset = unit * M2TS_ALIGNED_UNIT_SIZE;
+            int64_t sync;
+
+            if (!read_unit(fd, buffer, offset))
+            {
+                add_reason(clip, "read error at byte %lli: %s", (long long) offset, strerror(errno));
+                close(fd);
+                return;
+            }
+
+            sync = m2ts_find_sync_error(buffer, M2TS_ALIGNED_UNIT_SIZE);
+            if (sync >= 0 && !sync_reported)
+            {
+                add_reason(clip, "TS packet out of sync at byte %lli", (long long) (offset + sync));
+                sync_reported = true;
+            }
+
+            found = find_unit_pcr(buffer, offset, info_ptr, backwards, &sample);
+        }
+
+        if (!found)
+        {
+            if (!pcr_reported && !sync_reported)
+            {
+                add_reason(clip, "no PCR within %i aligned units %s byte %lli", QUICK_CHECK_SCAN_UNITS,
+                           backwards ? "before" : "from", (long long) (start + (backwards ? 1 : 0)) * M2TS_ALIGNED_UNIT_SIZE);
+            }
+            pcr_reported = true;
+            continue;
+        }
+
+        samples[sample_count++] = sample;
+        if (backwards)
+        {
+            end = sample;
+            has_end = true;
+        }
+    }
+    close(fd);
+
+    check_samples(clip, samples, sample_count, has_end ? &end : NULL, info_ptr);
+}
+
+static bool
+add_playlist(const char* path, void* check)
+{
+    return quick_check_add_playlist((quick_check_t*) check, path);
+}
+
+
+/*
+ * Functions
+ */
+
+
+void
+init_quick_check_t(quick_check_t* check)
+{
+    memset(check, 0, sizeof(*check));
+}
+
+void
+free_quick_check_members(quick_check_t* check)
+{
+    size_t i;
+
+    for (i = 0; i < check->clip_count; i++)
+    {
+        free(check->clips[i].path);
+        free(check->clips[i].playlist_path);
+    }
+    free(check->clips);
+    check->clips = NULL;
+    check->clip_count = check->clip_capacity = 0;
+}
+
+bool
+quick_check_add_playlist(quick_check_t* check, const char* path)
+{
+    mpls_file_t mpls_file = create_mpls_file_t();
+    playlist_t playlist = create_playlist_t();
+    size_t bdmv_len = disc_bdmv_length(path);
+    stream_clip_t* stream_clip;
+    char error[256];
+
+    if (!load_mpls(&mpls_file, (char*) path, error, sizeof(error)) ||
+        !check_mpls(&mpls_file, error, sizeof(error)))
+    {
+        fprintf(stderr, "%s\n", error);
+        free_mpls_file_members(&mpls_file);
+        check->failed = true;
+        return false;
+    }
+
+    parse_playlist(&mpls_file, &playlist, FIELD_CLIPS);
+    for (stream_clip = playlist.stream_clip_list.first; stream_clip != NULL; stream_clip = stream_clip->next)
+    {
+        quick_check_clip_t* clip;
+        char stream_path[PATH_MAX];
+        bool found = disc_find_clip_file(path, stream_clip->filename, "STREAM", "m2ts",
+                                         stream_path, sizeof(stream_path), NULL);
+
+        if (!found && bdmv_len > 0)
+            snprintf(stream_path, sizeof(stream_path), "%.*s/STREAM/%.5s.m2ts", (int) bdmv_len, path, stream_clip->filename);
+        else if (!found)
+            snprintf(stream_path, sizeof(stream_path), "%.5s.m2ts", stream_clip->filename);
+
+        if (check->clip_count == check->clip_capacity)
+        {
+            check->clip_capacity = check->clip_capacity ? check->clip_capacity * 2 : 64;
+            check->clips = (quick_check_clip_t*) realloc(check->clips, check->clip_capacity * sizeof(quick_check_clip_t));
+            if (check->clips == NULL)
+            {
+                DIE("Out of memory.");
+            }
+        }
+
+        clip = &check->clips[check->clip_count++];
+        memset(clip, 0, sizeof(*clip));
+        clip->path = strdup(stream_path);
+        clip->playlist_path = strdup(path);
+        memcpy(clip->clip_filename, stream_clip->filename, sizeof(clip->clip_filename));
+        clip->missing = !found;
+        clip->time_in = sec_to_timecode(stream_clip->time_in_sec);
+        clip->time_out = sec_to_timecode(stream_clip->time_out_sec);
+    }
+
+    free_playlist_members(&playlist);
+    free_mpls_file_members(&mpls_file);
+    return true;
+}
+
+void
+quick_check_clips(quick_check_t* check, int jobs)
+{
+    sched_t sched;
+    size_t kept = 0;
+    size_t i;
+
+    // One entry per stream file, covering the IN/OUT times of all its PlayItems
+    qsort(check->clips, check->clip_count, sizeof(quick_check_clip_t), compare_clip_paths);
+    for (i = 0; i < check->clip_count; i++)
+    {
+        quick_check_clip_t* clip = &check->clips[i];
+        quick_check_clip_t* previous = kept > 0 ? &check->clips[kept - 1] : NULL;
+
+        if (previous != NULL && strcmp(previous->path, clip->path) == 0)
+        {
+            if (clip->time_in < previous->time_in)
+                previous->time_in = clip->time_in;
+            if (clip->time_out > previous->time_out)
+                previous->time_out = clip->time_out;
+            free(clip->path);
+            free(clip->playlist_path);
+        }
+        else
+            check->clips[kept++] = *clip;
+    }
+    check->clip_count = kept;
+
+    init_sched_t(&sched, jobs);
+    for (i = 0; i < check->clip_count; i++)
+    {
+        if (check->clips[i].missing)
+            add_reason(&check->clips[i], "missing");
+        else
+            sched_spawn(&sched, check_task, &check->clips[i]);
+    }
+    sched_run(&sched);
+    free_sched_members(&sched);
+}
+
+bool
+quick_check_run(char** paths, int path_count, int jobs)
+{
+    quick_check_t check;
+    size_t suspects = 0;
+    size_t i;
+    int p;
+
+    init_quick_check_t(&check);
+    for (p = 0; p < path_count; p++)
+    {
+        if (!disc_for_each_playlist(paths[p], add_playlist, &check))
+            check.failed = true;
+    }
+    quick_check_clips(&check, jobs);
+
+    for (i = 0; i < check.clip_count; i++)
+    {
+        quick_check_clip_t* clip = &check.clips[i];
+
+        if (clip->suspect_count > 0)
+        {
+            printf("%s: SUSPECT (%s)\n", clip->path, clip->reasons);
+            suspects++;
+        }
+        else
+            printf("%s: OK\n", clip->path);
+    }
+    fflush(stdout);
+
+    if (suspects > 0)
+        fprintf(stderr, "WARNING: %zu of %zu clips SUSPECT\n", suspects, check.clip_count);
+
+    suspects += check.failed;
+    free_quick_check_members(&check);
+    return suspects == 0;
+}
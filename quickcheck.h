@@ -0,0 +1,121 @@
+/*
+ * File:   quickcheck.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Quick damage check (--quick-check): flags truncated or corrupt stream
+ * files from their sizes and a few sampled aligned units, without reading
+ * them in full like --verify.
+ *
+ * Every stream file referenced by the given playlists is checked once:
+ *
+ *  - its size must be a whole number of aligned units and match the source
+ *    packet count of its clip info file (.clpi).  A movie clip must also not
+ *    be far below the TS_recording_rate times the time span the playlists
+ *    use; the rate is a maximum, so this is only a loose lower bound, and
+ *    slideshow and menu clips, which may stay far below it, are exempt;
+ *  - QUICK_CHECK_SAMPLES aligned units spread across the file are read.
+ *    Every packet read must be in sync, and from each sample point the
+ *    units are read on until a PCR turns up (backwards from the end for the
+ *    last sample).  Each PCR must lie within its STC sequence as listed by
+ *    the clip info file (or within the PlayItems' IN/OUT times if that file
+ *    is missing), PCRs must not go backwards from sample to sample, and the
+ *    last one must reach the end of the last STC sequence.
+ *
+ * Clips are checked in parallel, one scheduler task per file.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef QUICKCHECK_H
+#define	QUICKCHECK_H
+
+#include "parse_mpls.h"
+#include "clpi.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+#define QUICK_CHECK_SAMPLES        16
+#define QUICK_CHECK_SCAN_UNITS     128  /* aligned units read per sample while looking for a PCR */
+#define QUICK_CHECK_MIN_FILL       0.10 /* of TS_recording_rate x duration */
+#define QUICK_CHECK_SLACK_SEC      2.0  /* PCRs run ahead of presentation times by up to the decoder delay */
+#define QUICK_CHECK_REASONS_SIZE   512
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    char* path;                  /* stream file */
+    char* playlist_path;         /* a playlist that references it, to locate the clip info file */
+    char clip_filename[11];      /* e.g., "00800.M2TS" */
+    bool missing;
+    int64_t time_in;             /* earliest IN_time of the PlayItems using it (45 kHz) */
+    int64_t time_out;            /* latest OUT_time */
+    int suspect_count;
+    char reasons[QUICK_CHECK_REASONS_SIZE]; /* "; "-separated */
+} quick_check_clip_t;
+
+typedef struct {
+    quick_check_clip_t* clips;
+    size_t clip_count;
+    size_t clip_capacity;
+    bool failed;                 /* a playlist could not be read */
+} quick_check_t;
+
+
+/*
+ * Functions
+ */
+
+
+void
+init_quick_check_t(quick_check_t* check);
+
+void
+free_quick_check_members(quick_check_t* check);
+
+/**
+ * Adds the stream files of a playlist.
+ * @param check
+ * @param path .mpls file
+ * @return false if the playlist could not be read (reported on stderr).
+ */
+bool
+quick_check_add_playlist(quick_check_t* check, const char* path);
+
+/**
+ * Checks every added stream file once, then sorts them by path.
+ * @param check
+ * @param jobs number of worker threads
+ */
+void
+quick_check_clips(quick_check_t* check, int jobs);
+
+/**
+ * Prints "PATH: OK" or "PATH: SUSPECT (reasons)" for every stream file of
+ * the given discs (or playlists).
+ * @param paths
+ * @param path_count
+ * @param jobs
+ * @return false if a clip is suspect or a playlist could not be read.
+ */
+bool
+quick_check_run(char** paths, int path_count, int jobs);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* QUICKCHECK_H */
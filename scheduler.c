@@ -0,0 +1,445 @@
+/*
+ * File:   scheduler.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#define _GNU_SOURCE /* O_DIRECT */
+
+#include "scheduler.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/* The worker running on the current thread (NULL outside of sched_run()) */
+static __thread sched_worker_t* current_worker = NULL;
+
+
+/*
+ * Chase-Lev deque
+ *
+ * "Correct and Efficient Work-Stealing for Weak Memory Models"
+ * (Le, Pop, Cohen, Zappa Nardelli, PPoPP 2013), fixed-size variant.
+ */
+
+
+static bool
+deque_push(sched_deque_t* deque, sched_task_t* task)
+{
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+
+    if (b - t >= SCHED_DEQUE_CAPACITY)
+        return false;
+
+    // The release store of bottom publishes the task to thieves
+    atomic_store_explicit(&deque->tasks[b & (SCHED_DEQUE_CAPACITY - 1)], task, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_release);
+    return true;
+}
+
+static sched_task_t*
+deque_pop(sched_deque_t* deque)
+{
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    long t;
+    sched_task_t* task = NULL;
+
+    // seq_cst store/load pair (instead of the paper's standalone fence) so the
+    // reservation of bottom is ordered before reading top
+    atomic_store_explicit(&deque->bottom, b, memory_order_seq_cst);
+    t = atomic_load_explicit(&deque->top, memory_order_seq_cst);
+
+    if (t <= b)
+    {
+        task = atomic_load_explicit(&deque->tasks[b & (SCHED_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+        if (t == b)
+        {
+            // Last task: race against thieves for it
+            if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+                                                         memory_order_seq_cst, memory_order_relaxed))
+                task = NULL;
+            atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        }
+    }
+    else
+    {
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    }
+
+    return task;
+}
+
+static sched_task_t*
+deque_steal(sched_deque_t* deque)
+{
+    long t = atomic_load_explicit(&deque->top, memory_order_seq_cst);
+    long b = atomic_load_explicit(&deque->bottom, memory_order_seq_cst);
+    sched_task_t* task;
+
+    if (t >= b)
+        return NULL;
+
+    task = atomic_load_explicit(&deque->tasks[t & (SCHED_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed))
+        return NULL; /* lost the race to another thief or the owner */
+
+    return task;
+}
+
+
+/*
+ * Private functions
+ */
+
+
+typedef struct {
+    void* data;
+    size_t size;
+    size_t alignment;
+} thread_buffer_t;
+
+static pthread_key_t buffer_key;
+static pthread_once_t buffer_key_once = PTHREAD_ONCE_INIT;
+
+static void
+free_thread_buffer(void* arg)
+{
+    thread_buffer_t* buffer = (thread_buffer_t*) arg;
+
+    free(buffer->data);
+    free(buffer);
+}
+
+static void
+create_buffer_key()
+{
+    pthread_key_create(&buffer_key, free_thread_buffer);
+}
+
+static void
+run_task(sched_t* sched, sched_task_t* task)
+{
+    task->fn(sched, task->arg);
+    free(task);
+    atomic_fetch_sub(&sched->pending, 1);
+}
+
+static uint32_t
+next_random(uint32_t* state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static sched_task_t*
+steal_any(sched_worker_t* self)
+{
+    sched_t* sched = self->sched;
+    int n = sched->worker_count;
+    int start = (int) (next_random(&self->rng) % (uint32_t) n);
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        sched_worker_t* victim = &sched->workers[(start + i) % n];
+        sched_task_t* task;
+
+        if (victim == self)
+            continue;
+
+        task = deque_steal(&victim->deque);
+        if (task != NULL)
+        {
+            atomic_fetch_add_explicit(&sched->steals, 1, memory_order_relaxed);
+            return task;
+        }
+    }
+
+    return NULL;
+}
+
+static void*
+worker_main(void* arg)
+{
+    sched_worker_t* self = (sched_worker_t*) arg;
+    sched_t* sched = self->sched;
+    unsigned idle = 0;
+
+    current_worker = self;
+
+    for (;;)
+    {
+        sched_task_t* task = deque_pop(&self->deque);
+        if (task == NULL)
+            task = steal_any(self);
+
+        if (task != NULL)
+        {
+            idle = 0;
+            run_task(sched, task);
+            continue;
+        }
+
+        if (atomic_load(&sched->pending) == 0)
+            break;
+
+        // Nothing to steal right now; another worker is still busy and may spawn more
+        if (idle++ < 64)
+        {
+            sched_yield();
+        }
+        else
+        {
+            struct timespec ts = { 0, 50000 };
+            nanosleep(&ts, NULL);
+        }
+    }
+
+    current_worker = NULL;
+    return NULL;
+}
+
+
+/*
+ * Chunked file reads
+ */
+
+
+static void
+record_read_error(sched_file_t* file, int error)
+{
+    int expected = 0;
+    atomic_compare_exchange_strong(&file->read_errno, &expected, error);
+}
+
+/**
+ * Called once by the open task and once by each chunk task; the last one to
+ * finish closes the file.
+ */
+static void
+finish_file_ref(sched_file_t* file)
+{
+    if (atomic_fetch_sub(&file->pending, 1) != 1)
+        return;
+
+    if (file->fd >= 0)
+    {
+        close(file->fd);
+        file->fd = -1;
+    }
+    if (file->done_fn != NULL)
+        file->done_fn(file);
+}
+
+static void
+chunk_task(sched_t* sched, void* arg)
+{
+    sched_file_t* file = (sched_file_t*) arg;
+    size_t index = atomic_fetch_add(&file->next_chunk, 1);
+    int64_t offset = (int64_t) index * file->chunk_size;
+    size_t want = file->size - offset < (int64_t) file->chunk_size ? (size_t) (file->size - offset) : file->chunk_size;
+    // O_DIRECT needs whole blocks; the last read then simply stops at the end of the file
+    size_t request = file->direct ? (want + file->alignment - 1) & ~(file->alignment - 1) : want;
+    uint8_t* buffer;
+    size_t got = 0;
+
+    // Hand the next chunk to an idle worker before reading this one
+    if (index + 1 < file->chunk_count)
+        sched_spawn(sched, chunk_task, file);
+
+    if (atomic_load(&file->read_errno) != 0)
+    {
+        finish_file_ref(file);
+        return;
+    }
+
+    buffer = (uint8_t*) sched_thread_buffer(file->chunk_size, file->alignment);
+    while (got < want)
+    {
+        ssize_t n = pread(file->fd, buffer + got, request - got, offset + got);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            // n == 0: the file shrank while it was being read
+            record_read_error(file, n < 0 ? errno : EIO);
+            break;
+        }
+        got += n;
+    }
+    STATS_ADD(STATS_BYTES_READ, got < want ? got : want);
+
+    if (got >= want)
+        file->chunk_fn(file, index, buffer, want);
+
+    finish_file_ref(file);
+}
+
+static void
+open_task(sched_t* sched, void* arg)
+{
+    sched_file_t* file = (sched_file_t*) arg;
+    struct stat st;
+
+    file->fd = open(file->path, O_RDONLY | (file->direct ? O_DIRECT : 0));
+    // File systems without O_DIRECT support (e.g., tmpfs) refuse it with EINVAL
+    if (file->fd < 0 && file->direct && errno == EINVAL)
+    {
+        file->direct = false;
+        file->fd = open(file->path, O_RDONLY);
+    }
+    if (file->fd < 0 || fstat(file->fd, &st) != 0)
+    {
+        record_read_error(file, errno);
+        finish_file_ref(file);
+        return;
+    }
+
+    if (!file->direct)
+        posix_fadvise(file->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    file->size = st.st_size;
+    file->chunk_count = (file->size + file->chunk_size - 1) / file->chunk_size;
+    if (file->opened_fn != NULL)
+        file->opened_fn(file);
+    atomic_fetch_add(&file->pending, file->chunk_count);
+    if (file->chunk_count > 0)
+        sched_spawn(sched, chunk_task, file);
+
+    finish_file_ref(file);
+}
+
+
+/*
+ * Functions
+ */
+
+
+void
+init_sched_t(sched_t* sched, int worker_count)
+{
+    int i;
+
+    if (worker_count < 1)
+        worker_count = 1;
+
+    sched->worker_count = worker_count;
+    sched->workers = (sched_worker_t*) calloc(worker_count, sizeof(sched_worker_t));
+    atomic_init(&sched->pending, 0);
+    atomic_init(&sched->steals, 0);
+
+    for (i = 0; i < worker_count; i++)
+    {
+        sched->workers[i].sched = sched;
+        sched->workers[i].id = i;
+        sched->workers[i].rng = 0x9E3779B9u * (uint32_t) (i + 1);
+        atomic_init(&sched->workers[i].deque.top, 0);
+        atomic_init(&sched->workers[i].deque.bottom, 0);
+    }
+}
+
+void
+free_sched_members(sched_t* sched)
+{
+    free(sched->workers); sched->workers = NULL;
+    sched->worker_count = 0;
+}
+
+void
+sched_spawn(sched_t* sched, sched_task_fn fn, void* arg)
+{
+    static int next_worker = 0;
+    sched_worker_t* worker = current_worker;
+    sched_task_t* task = (sched_task_t*) calloc(1, sizeof(sched_task_t));
+
+    task->fn = fn;
+    task->arg = arg;
+    atomic_fetch_add(&sched->pending, 1);
+
+    // Before sched_run() (single-threaded), deal the initial tasks out round-robin
+    if (worker == NULL || worker->sched != sched)
+        worker = &sched->workers[next_worker++ % sched->worker_count];
+
+    if (!deque_push(&worker->deque, task))
+        run_task(sched, task);
+}
+
+void
+sched_run(sched_t* sched)
+{
+    int i;
+
+    for (i = 0; i < sched->worker_count; i++)
+        pthread_create(&sched->workers[i].thread, NULL, worker_main, &sched->workers[i]);
+
+    for (i = 0; i < sched->worker_count; i++)
+        pthread_join(sched->workers[i].thread, NULL);
+}
+
+void*
+sched_thread_buffer(size_t size, size_t alignment)
+{
+    thread_buffer_t* buffer;
+
+    pthread_once(&buffer_key_once, create_buffer_key);
+    buffer = (thread_buffer_t*) pthread_getspecific(buffer_key);
+    if (buffer == NULL)
+    {
+        buffer = (thread_buffer_t*) calloc(1, sizeof(thread_buffer_t));
+        if (buffer == NULL)
+        {
+            DIE("Out of memory.");
+        }
+        pthread_setspecific(buffer_key, buffer);
+    }
+
+    if (buffer->size < size || buffer->alignment < alignment)
+    {
+        free(buffer->data);
+        buffer->data = NULL;
+        buffer->size = buffer->alignment = 0;
+        if (posix_memalign(&buffer->data, alignment, size) != 0)
+        {
+            DIE("Out of memory.");
+        }
+        buffer->size = size;
+        buffer->alignment = alignment;
+    }
+    return buffer->data;
+}
+
+void
+init_sched_file_t(sched_file_t* file, const char* path, size_t chunk_size, size_t alignment,
+                  sched_chunk_fn chunk_fn, void* arg)
+{
+    memset(file, 0, sizeof(*file));
+    file->path = path;
+    file->chunk_size = chunk_size;
+    file->alignment = alignment;
+    file->chunk_fn = chunk_fn;
+    file->arg = arg;
+    file->fd = -1;
+    atomic_init(&file->next_chunk, 0);
+    atomic_init(&file->pending, 1);
+    atomic_init(&file->read_errno, 0);
+}
+
+void
+sched_read_file(sched_t* sched, sched_file_t* file)
+{
+    sched_spawn(sched, open_task, file);
+}
@@ -0,0 +1,175 @@
+/*
+ * File:   scheduler.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Work-stealing task scheduler.
+ *
+ * Each worker owns a Chase-Lev deque: it pushes and pops tasks at the bottom
+ * (LIFO, cache-friendly for freshly spawned subtasks) while idle workers steal
+ * from the top (FIFO, i.e. the oldest and usually biggest pieces of work).
+ * Tasks may spawn further tasks, so uneven trees of work (a disc with 3000
+ * playlists next to one with 3) spread across all workers on their own.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef SCHEDULER_H
+#define	SCHEDULER_H
+
+#include "parse_mpls.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+#define SCHED_DEQUE_CAPACITY 4096 /* tasks per worker deque (power of two) */
+
+
+/*
+ * Structs
+ */
+
+
+struct sched_s;
+
+typedef void (*sched_task_fn)(struct sched_s* sched, void* arg);
+
+typedef struct {
+    sched_task_fn fn;
+    void* arg;
+} sched_task_t;
+
+typedef struct {
+    atomic_long top;             /* thieves take from here */
+    char pad0[64];
+    atomic_long bottom;          /* the owner pushes and pops here */
+    char pad1[64];
+    _Atomic(sched_task_t*) tasks[SCHED_DEQUE_CAPACITY];
+} sched_deque_t;
+
+typedef struct {
+    struct sched_s* sched;
+    int id;
+    uint32_t rng;                /* xorshift state for picking victims */
+    pthread_t thread;
+    sched_deque_t deque;
+} sched_worker_t;
+
+typedef struct sched_s {
+    int worker_count;
+    sched_worker_t* workers;
+    atomic_long pending;         /* spawned tasks that have not finished yet */
+    atomic_long steals;          /* successful steals */
+} sched_t;
+
+struct sched_file_s;
+
+typedef void (*sched_file_fn)(struct sched_file_s* file);
+typedef void (*sched_chunk_fn)(struct sched_file_s* file, size_t index, const uint8_t* data, size_t size);
+
+/* A file read in chunks by scheduler tasks; see sched_read_file() */
+typedef struct sched_file_s {
+    const char* path;
+    size_t chunk_size;           /* a multiple of alignment */
+    size_t alignment;            /* of the read buffers; O_DIRECT needs the logical block size */
+    bool direct;                 /* read with O_DIRECT; cleared if the file system refuses it */
+    sched_file_fn opened_fn;     /* if not NULL, called once size and chunk_count are known */
+    sched_chunk_fn chunk_fn;     /* called for every chunk read completely, on any worker */
+    sched_file_fn done_fn;       /* if not NULL, called once, by the task that finishes last */
+    void* arg;
+    int fd;
+    int64_t size;
+    size_t chunk_count;
+    atomic_size_t next_chunk;    /* next chunk to claim */
+    atomic_size_t pending;       /* chunks not handled yet, +1 for the open task */
+    atomic_int read_errno;       /* first open or read error, or 0 */
+} sched_file_t;
+
+
+/*
+ * Functions
+ */
+
+
+/**
+ * @param sched
+ * @param worker_count number of worker threads (the calling thread is not one of them)
+ */
+void
+init_sched_t(sched_t* sched, int worker_count);
+
+void
+free_sched_members(sched_t* sched);
+
+/**
+ * Queues a task.  From inside a task, the new task goes to the bottom of the
+ * current worker's deque; before sched_run() it is dealt round-robin to the
+ * workers.  If the deque is full the task runs immediately instead.
+ * @param sched
+ * @param fn
+ * @param arg
+ */
+void
+sched_spawn(sched_t* sched, sched_task_fn fn, void* arg);
+
+/**
+ * Starts the workers and blocks until every task, including all tasks they
+ * spawned, has finished.
+ * @param sched
+ */
+void
+sched_run(sched_t* sched);
+
+/**
+ * Scratch buffer of the calling thread for tasks that read files, allocated
+ * on first use, grown when a larger one is asked for, and freed when the
+ * thread exits.
+ * @param size
+ * @param alignment power of two, at least sizeof(void*)
+ * @return At least size bytes, aligned to alignment.
+ */
+void*
+sched_thread_buffer(size_t size, size_t alignment);
+
+/**
+ * Prepares a file for sched_read_file().  Set direct, opened_fn and done_fn
+ * afterwards where needed.
+ * @param file
+ * @param path must outlive the read
+ * @param chunk_size
+ * @param alignment power of two, at least sizeof(void*)
+ * @param chunk_fn
+ * @param arg for the callbacks
+ */
+void
+init_sched_file_t(sched_file_t* file, const char* path, size_t chunk_size, size_t alignment,
+                  sched_chunk_fn chunk_fn, void* arg);
+
+/**
+ * Reads a file in chunks, one task each, into sched_thread_buffer()s.  The
+ * task for a chunk spawns the task for the next one before reading its own,
+ * so idle workers pick up the following chunks and the file is read front
+ * to back by all workers at once.  Once a read fails, later chunks are
+ * skipped; the first error is kept in read_errno.
+ * @param sched
+ * @param file
+ */
+void
+sched_read_file(sched_t* sched, sched_file_t* file);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SCHEDULER_H */
@@ -0,0 +1,204 @@
+/*
+ * File:   stats.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "stats.h"
+
+#include <pthread.h>
+#include <time.h>
+
+
+bool stats_enabled = false;
+
+
+/*
+ * Private types and state
+ */
+
+
+typedef struct stats_thread_s {
+    uint64_t wall_ns[STATS_PHASE_COUNT];
+    uint64_t cpu_ns[STATS_PHASE_COUNT];
+    uint64_t calls[STATS_PHASE_COUNT];
+    uint64_t counters[STATS_COUNTER_COUNT];
+    struct stats_thread_s* next;
+} stats_thread_t;
+
+static const char* phase_names[STATS_PHASE_COUNT] = {
+    "open",
+    "load",
+    "validate",
+    "stream_clips",
+    "chapters",
+    "format",
+    "output"
+};
+
+static const char* phase_labels[STATS_PHASE_COUNT] = {
+    "realpath/open",
+    "load",
+    "validate",
+    "parse_stream_clips",
+    "parse_chapters",
+    "formatting",
+    "output"
+};
+
+static stats_format_t report_format = STATS_FORMAT_TEXT;
+static uint64_t start_ns = 0;
+
+/* Every thread that recorded anything; records outlive their threads */
+static stats_thread_t* threads = NULL;
+static pthread_mutex_t threads_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread stats_thread_t* this_thread = NULL;
+
+
+/*
+ * Private functions
+ */
+
+
+static uint64_t
+clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static stats_thread_t*
+get_thread_stats()
+{
+    if (this_thread == NULL)
+    {
+        this_thread = (stats_thread_t*) calloc(1, sizeof(stats_thread_t));
+        pthread_mutex_lock(&threads_lock);
+        this_thread->next = threads;
+        threads = this_thread;
+        pthread_mutex_unlock(&threads_lock);
+    }
+    return this_thread;
+}
+
+static void
+report_at_exit()
+{
+    fflush(stdout);
+    stats_report(stderr);
+}
+
+
+/*
+ * Functions
+ */
+
+
+void
+stats_enable(stats_format_t format)
+{
+    // Repeated --stats options only change the format; the report is printed once
+    report_format = format;
+    if (stats_enabled)
+        return;
+
+    start_ns = clock_ns(CLOCK_MONOTONIC);
+    stats_enabled = true;
+    atexit(report_at_exit);
+}
+
+void
+stats_now(stats_mark_t* mark)
+{
+    mark->wall_ns = clock_ns(CLOCK_MONOTONIC);
+    mark->cpu_ns = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void
+stats_record(stats_phase_t phase, const stats_mark_t* mark)
+{
+    stats_thread_t* stats = get_thread_stats();
+    stats->wall_ns[phase] += clock_ns(CLOCK_MONOTONIC) - mark->wall_ns;
+    stats->cpu_ns[phase] += clock_ns(CLOCK_THREAD_CPUTIME_ID) - mark->cpu_ns;
+    stats->calls[phase]++;
+}
+
+void
+stats_add(stats_counter_t counter, uint64_t n)
+{
+    get_thread_stats()->counters[counter] += n;
+}
+
+void
+stats_report(FILE* out)
+{
+    stats_thread_t total;
+    stats_thread_t* stats;
+    int thread_count = 0;
+    int i;
+
+    memset(&total, 0, sizeof(total));
+
+    pthread_mutex_lock(&threads_lock);
+    for (stats = threads; stats != NULL; stats = stats->next)
+    {
+        for (i = 0; i < STATS_PHASE_COUNT; i++)
+        {
+            total.wall_ns[i] += stats->wall_ns[i];
+            total.cpu_ns[i] += stats->cpu_ns[i];
+            total.calls[i] += stats->calls[i];
+        }
+        for (i = 0; i < STATS_COUNTER_COUNT; i++)
+            total.counters[i] += stats->counters[i];
+        thread_count++;
+    }
+    pthread_mutex_unlock(&threads_lock);
+
+    double elapsed_sec = (clock_ns(CLOCK_MONOTONIC) - start_ns) / 1e9;
+    double files_per_sec = elapsed_sec > 0 ? total.counters[STATS_FILES] / elapsed_sec : 0;
+
+    if (report_format == STATS_FORMAT_JSON)
+    {
+        fprintf(out, "{\"elapsed_ms\":%.3f,\"files\":%llu,\"files_per_sec\":%.1f,"
+                     "\"bytes_read\":%llu,\"allocations\":%llu,\"allocated_bytes\":%llu,"
+                     "\"threads\":%i,\"phases\":{",
+                elapsed_sec * 1e3,
+                (unsigned long long) total.counters[STATS_FILES], files_per_sec,
+                (unsigned long long) total.counters[STATS_BYTES_READ],
+                (unsigned long long) total.counters[STATS_ALLOCS],
+                (unsigned long long) total.counters[STATS_ALLOC_BYTES],
+                thread_count);
+        for (i = 0; i < STATS_PHASE_COUNT; i++)
+        {
+            fprintf(out, "%s\"%s\":{\"wall_ms\":%.3f,\"cpu_ms\":%.3f,\"calls\":%llu}",
+                    i ? "," : "", phase_names[i],
+                    total.wall_ns[i] / 1e6, total.cpu_ns[i] / 1e6,
+                    (unsigned long long) total.calls[i]);
+        }
+        fprintf(out, "}}\n");
+        return;
+    }
+
+    fprintf(out, "Statistics:\n");
+    fprintf(out, "\n");
+    fprintf(out, "\t phase                    wall (ms)     cpu (ms)       calls\n");
+    fprintf(out, "\t ------------------    -----------  -----------  ----------\n");
+    for (i = 0; i < STATS_PHASE_COUNT; i++)
+    {
+        fprintf(out, "\t %-18s    %11.3f  %11.3f  %10llu\n", phase_labels[i],
+                total.wall_ns[i] / 1e6, total.cpu_ns[i] / 1e6,
+                (unsigned long long) total.calls[i]);
+    }
+    fprintf(out, "\n");
+    fprintf(out, "\t Elapsed:          %11.3f ms (%i threads)\n", elapsed_sec * 1e3, thread_count);
+    fprintf(out, "\t Files:            %11llu (%.1f files/sec)\n", (unsigned long long) total.counters[STATS_FILES], files_per_sec);
+    fprintf(out, "\t Bytes read:       %11llu\n", (unsigned long long) total.counters[STATS_BYTES_READ]);
+    fprintf(out, "\t Allocations:      %11llu (%llu bytes)\n",
+            (unsigned long long) total.counters[STATS_ALLOCS],
+            (unsigned long long) total.counters[STATS_ALLOC_BYTES]);
+    fprintf(out, "\n");
+}
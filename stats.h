@@ -0,0 +1,122 @@
+/*
+ * File:   stats.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Phase timing and counters (--stats).
+ *
+ * Always compiled in; when disabled every probe is a single predictable
+ * branch on stats_enabled.  Each thread accumulates into its own record
+ * (no atomics or locks on the hot path); the records are summed when the
+ * report is printed at exit.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef STATS_H
+#define	STATS_H
+
+#include "parse_mpls.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Enums
+ */
+
+
+typedef enum {
+    STATS_PHASE_OPEN,            /* realpath() + fopen() */
+    STATS_PHASE_LOAD,            /* reading the file into memory */
+    STATS_PHASE_VALIDATE,        /* header + section extent checks */
+    STATS_PHASE_STREAM_CLIPS,    /* parse_stream_clips() */
+    STATS_PHASE_CHAPTERS,        /* parse_chapters() */
+    STATS_PHASE_FORMAT,          /* rendering the report */
+    STATS_PHASE_OUTPUT,          /* writing the report to stdout */
+    STATS_PHASE_COUNT
+} stats_phase_t;
+
+typedef enum {
+    STATS_FILES,                 /* playlists parsed */
+    STATS_BYTES_READ,
+    STATS_ALLOCS,                /* allocations made by the parser */
+    STATS_ALLOC_BYTES,
+    STATS_COUNTER_COUNT
+} stats_counter_t;
+
+typedef enum {
+    STATS_FORMAT_TEXT,
+    STATS_FORMAT_JSON
+} stats_format_t;
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    uint64_t wall_ns;
+    uint64_t cpu_ns;
+} stats_mark_t;
+
+
+/*
+ * Macros
+ */
+
+
+extern bool stats_enabled;
+
+#define STATS_BEGIN(mark) \
+    stats_mark_t mark = { 0, 0 }; \
+    if (stats_enabled) stats_now(&mark)
+
+#define STATS_END(mark, phase) \
+    if (stats_enabled) stats_record(phase, &mark)
+
+#define STATS_ADD(counter, n) \
+    if (stats_enabled) stats_add(counter, n)
+
+
+/*
+ * Functions
+ */
+
+
+/**
+ * Turns collection on and registers an atexit() handler that prints the
+ * report to stderr (so it is printed even when the run ends in DIE()).
+ * @param format
+ */
+void
+stats_enable(stats_format_t format);
+
+void
+stats_now(stats_mark_t* mark);
+
+/**
+ * Adds the time elapsed since mark to the given phase of the calling thread.
+ */
+void
+stats_record(stats_phase_t phase, const stats_mark_t* mark);
+
+void
+stats_add(stats_counter_t counter, uint64_t n);
+
+/**
+ * Sums the per-thread records and prints them.
+ * @param out
+ */
+void
+stats_report(FILE* out);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* STATS_H */
@@ -0,0 +1,457 @@
+/*
+ * File:   verify.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "verify.h"
+#include "disc.h"
+#include "mpls_view.h"
+#include "xxh64.h"
+
+
+/*
+ * Private types
+ */
+
+
+typedef struct {
+    char* path;
+    uint64_t hash;
+} checksum_entry_t;
+
+
+/*
+ * Private functions
+ */
+
+
+static void
+add_clip(verify_t* verify, const char* playlist_path, size_t bdmv_len, const char* clip_id)
+{
+    verify_clip_t* clip;
+
+    if (verify->clip_count == verify->clip_capacity)
+    {
+        verify->clip_capacity = verify->clip_capacity ? verify->clip_capacity * 2 : 64;
+        verify->clips = (verify_clip_t*) realloc(verify->clips, verify->clip_capacity * sizeof(verify_clip_t));
+        if (verify->clips == NULL)
+        {
+            DIE("Out of memory.");
+        }
+    }
+
+    clip = &verify->clips[verify->clip_count++];
+    memset(clip, 0, sizeof(*clip));
+    clip->playlist_path = strdup(playlist_path);
+    clip->bdmv_len = bdmv_len;
+    memcpy(clip->clip_id, clip_id, 5);
+    clip->clip_id[5] = '\0';
+}
+
+/* Orders clip references by BDMV directory, then clip ID */
+static int
+compare_clip_refs(const void* a, const void* b)
+{
+    const verify_clip_t* x = (const verify_clip_t*) a;
+    const verify_clip_t* y = (const verify_clip_t*) b;
+    size_t len = x->bdmv_len < y->bdmv_len ? x->bdmv_len : y->bdmv_len;
+    int c = memcmp(x->playlist_path, y->playlist_path, len);
+
+    if (c == 0)
+        c = (x->bdmv_len > y->bdmv_len) - (x->bdmv_len < y->bdmv_len);
+    if (c == 0)
+        c = strcmp(x->clip_id, y->clip_id);
+    return c;
+}
+
+static int
+compare_clip_paths(const void* a, const void* b)
+{
+    return strcmp(((const verify_clip_t*) a)->path, ((const verify_clip_t*) b)->path);
+}
+
+/* Orders found files by identity, then path; missing ones last */
+static int
+compare_clip_files(const void* a, const void* b)
+{
+    const verify_clip_t* x = (const verify_clip_t*) a;
+    const verify_clip_t* y = (const verify_clip_t*) b;
+
+    if (x->missing != y->missing)
+        return x->missing - y->missing;
+    if (x->dev != y->dev)
+        return (x->dev > y->dev) - (x->dev < y->dev);
+    if (x->ino != y->ino)
+        return (x->ino > y->ino) - (x->ino < y->ino);
+    return compare_clip_paths(a, b);
+}
+
+static bool
+same_file(const verify_clip_t* x, const verify_clip_t* y)
+{
+    return !x->missing && !y->missing && x->dev == y->dev && x->ino == y->ino;
+}
+
+static int
+compare_checksum_entries(const void* a, const void* b)
+{
+    return strcmp(((const checksum_entry_t*) a)->path, ((const checksum_entry_t*) b)->path);
+}
+
+static void
+free_clip(verify_clip_t* clip)
+{
+    free(clip->path);
+    free(clip->playlist_path);
+    free(clip->chunk_hashes);
+}
+
+static bool
+same_clip_ref(const verify_clip_t* x, const verify_clip_t* y)
+{
+    return compare_clip_refs(x, y) == 0;
+}
+
+/**
+ * Keeps the first of each run of equal clips in the sorted array and frees the rest.
+ */
+static void
+remove_duplicates(verify_t* verify, bool (*equal)(const verify_clip_t*, const verify_clip_t*))
+{
+    size_t kept = 0;
+    size_t i;
+
+    for (i = 0; i < verify->clip_count; i++)
+    {
+        verify_clip_t* clip = &verify->clips[i];
+
+        if (kept > 0 && equal(&verify->clips[kept - 1], clip))
+            free_clip(clip);
+        else
+            verify->clips[kept++] = *clip;
+    }
+    verify->clip_count = kept;
+}
+
+static void
+record_sync_error(verify_clip_t* clip, int64_t offset)
+{
+    long long current = atomic_load(&clip->sync_error);
+
+    while ((current < 0 || offset < current) &&
+           !atomic_compare_exchange_weak(&clip->sync_error, &current, offset))
+        ;
+}
+
+static void
+clip_opened(sched_file_t* file)
+{
+    verify_clip_t* clip = (verify_clip_t*) file->arg;
+    clip->chunk_hashes = (uint64_t*) calloc(file->chunk_count + 1, sizeof(uint64_t));
+}
+
+static void
+check_chunk(sched_file_t* file, size_t index, const uint8_t* data, size_t size)
+{
+    verify_clip_t* clip = (verify_clip_t*) file->arg;
+    int64_t sync;
+
+    clip->chunk_hashes[index] = xxh64(data, size, 0);
+    sync = m2ts_find_sync_error(data, size);
+    if (sync >= 0)
+        record_sync_error(clip, (int64_t) index * VERIFY_CHUNK_SIZE + sync);
+}
+
+/**
+ * Combines the chunk hashes once the whole clip was read.
+ */
+static void
+clip_read(sched_file_t* file)
+{
+    verify_clip_t* clip = (verify_clip_t*) file->arg;
+    xxh64_state_t state;
+    uint8_t le[8];
+    size_t i;
+    int b;
+
+    init_xxh64_state_t(&state, 0);
+    for (i = 0; i < file->chunk_count; i++)
+    {
+        for (b = 0; b < 8; b++)
+            le[b] = (uint8_t) (clip->chunk_hashes[i] >> (8 * b));
+        xxh64_update(&state, le, sizeof(le));
+    }
+    clip->hash = xxh64_digest(&state);
+}
+
+/**
+ * Reads a sha256sum-style checksum file: "HASH  PATH" (or "HASH *PATH") per
+ * line, with blank lines and "#" comments ignored.
+ * @return Number of entries, sorted by path.
+ */
+static size_t
+load_checksums(const char* path, checksum_entry_t** entries)
+{
+    FILE* file = fopen(path, "r");
+    size_t count = 0;
+    size_t capacity = 0;
+    size_t line_number = 0;
+    char* line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+
+    if (file == NULL)
+    {
+        DIE("Unable to open \"%s\" for reading.", path);
+    }
+
+    *entries = NULL;
+    while ((len = getline(&line, &line_size, file)) != -1)
+    {
+        char* end;
+        uint64_t hash;
+
+        line_number++;
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+            line[--len] = '\0';
+        if (len == 0 || line[0] == '#')
+            continue;
+
+        hash = strtoull(line, &end, 16);
+        if (end != line + 16 || end[0] != ' ' || (end[1] != ' ' && end[1] != '*') || end[2] == '\0')
+        {
+            DIE("Invalid checksum on line %zu of \"%s\".", line_number, path);
+        }
+
+        if (count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            *entries = (checksum_entry_t*) realloc(*entries, capacity * sizeof(checksum_entry_t));
+            if (*entries == NULL)
+            {
+                DIE("Out of memory.");
+            }
+        }
+        (*entries)[count].path = strdup(end + 2);
+        (*entries)[count].hash = hash;
+        count++;
+    }
+
+    free(line);
+    fclose(file);
+
+    qsort(*entries, count, sizeof(checksum_entry_t), compare_checksum_entries);
+    return count;
+}
+
+/**
+ * @return Why a clip failed, or NULL if it was read and in sync.
+ */
+static const char*
+describe_failure(const verify_clip_t* clip, char* dest, size_t dest_size)
+{
+    int read_errno = atomic_load(&clip->file.read_errno);
+    long long sync_error = atomic_load(&clip->sync_error);
+
+    if (clip->missing)
+        snprintf(dest, dest_size, "missing");
+    else if (read_errno != 0)
+        snprintf(dest, dest_size, "read error: %s", strerror(read_errno));
+    else if (sync_error >= 0)
+        snprintf(dest, dest_size, "TS packet out of sync at byte %lli", sync_error);
+    else
+        return NULL;
+    return dest;
+}
+
+static bool
+add_playlist(const char* path, void* verify)
+{
+    return verify_add_playlist((verify_t*) verify, path);
+}
+
+
+/*
+ * Functions
+ */
+
+
+void
+init_verify_t(verify_t* verify, bool direct)
+{
+    memset(verify, 0, sizeof(*verify));
+    verify->direct = direct;
+}
+
+void
+free_verify_members(verify_t* verify)
+{
+    size_t i;
+
+    for (i = 0; i < verify->clip_count; i++)
+        free_clip(&verify->clips[i]);
+    free(verify->clips);
+    verify->clips = NULL;
+    verify->clip_count = verify->clip_capacity = 0;
+}
+
+bool
+verify_add_playlist(verify_t* verify, const char* path)
+{
+    mpls_file_t mpls_file = create_mpls_file_t();
+    size_t bdmv_len = disc_bdmv_length(path);
+    char error[256];
+    mpls_view_t view;
+    mpls_play_item_iter_t item;
+    mpls_angle_iter_t angle;
+    bool has_item;
+    bool has_angle;
+
+    if (!load_mpls(&mpls_file, (char*) path, error, sizeof(error)) ||
+        !check_mpls(&mpls_file, error, sizeof(error)))
+    {
+        fprintf(stderr, "%s\n", error);
+        free_mpls_file_members(&mpls_file);
+        verify->failed = true;
+        return false;
+    }
+
+    mpls_view_init(&view, &mpls_file);
+    for (has_item = mpls_view_play_items(&view, &item); has_item; has_item = mpls_play_item_next(&item))
+    {
+        add_clip(verify, path, bdmv_len, mpls_play_item_clip_id(&item));
+        for (has_angle = mpls_play_item_angles(&item, &angle); has_angle; has_angle = mpls_angle_next(&angle))
+            add_clip(verify, path, bdmv_len, mpls_angle_clip_id(&angle));
+    }
+
+    free_mpls_file_members(&mpls_file);
+    return true;
+}
+
+void
+verify_read_clips(verify_t* verify, int jobs)
+{
+    sched_t sched;
+    size_t i;
+
+    // One entry per clip of each disc...
+    qsort(verify->clips, verify->clip_count, sizeof(verify_clip_t), compare_clip_refs);
+    remove_duplicates(verify, same_clip_ref);
+
+    for (i = 0; i < verify->clip_count; i++)
+    {
+        verify_clip_t* clip = &verify->clips[i];
+        char path[PATH_MAX];
+        struct stat st;
+
+        clip->missing = !disc_find_clip_file(clip->playlist_path, clip->clip_id, "STREAM", "m2ts",
+                                             path, sizeof(path), &st);
+        if (clip->missing && clip->bdmv_len > 0)
+            snprintf(path, sizeof(path), "%.*s/STREAM/%s.m2ts", (int) clip->bdmv_len, clip->playlist_path, clip->clip_id);
+        else if (clip->missing)
+            snprintf(path, sizeof(path), "%s.m2ts", clip->clip_id);
+        clip->path = strdup(path);
+        if (!clip->missing)
+        {
+            clip->dev = st.st_dev;
+            clip->ino = st.st_ino;
+        }
+        free(clip->playlist_path);
+        clip->playlist_path = NULL;
+    }
+
+    // ...and one per file, for discs given twice or clips linked between discs
+    qsort(verify->clips, verify->clip_count, sizeof(verify_clip_t), compare_clip_files);
+    remove_duplicates(verify, same_file);
+
+    init_sched_t(&sched, jobs);
+    for (i = 0; i < verify->clip_count; i++)
+    {
+        verify_clip_t* clip = &verify->clips[i];
+
+        init_sched_file_t(&clip->file, clip->path, VERIFY_CHUNK_SIZE, VERIFY_ALIGNMENT, check_chunk, clip);
+        clip->file.direct = verify->direct;
+        clip->file.opened_fn = clip_opened;
+        clip->file.done_fn = clip_read;
+        atomic_init(&clip->sync_error, -1);
+        if (!clip->missing)
+            sched_read_file(&sched, &clip->file);
+    }
+    sched_run(&sched);
+    free_sched_members(&sched);
+
+    qsort(verify->clips, verify->clip_count, sizeof(verify_clip_t), compare_clip_paths);
+}
+
+bool
+verify_run(char** paths, int path_count, const char* checksum_path, bool direct, int jobs)
+{
+    verify_t verify;
+    checksum_entry_t* expected = NULL;
+    size_t expected_count = 0;
+    size_t failures = 0;
+    char reason[128];
+    size_t i;
+    int p;
+
+    if (checksum_path != NULL)
+        expected_count = load_checksums(checksum_path, &expected);
+
+    init_verify_t(&verify, direct);
+    for (p = 0; p < path_count; p++)
+    {
+        if (!disc_for_each_playlist(paths[p], add_playlist, &verify))
+            verify.failed = true;
+    }
+    verify_read_clips(&verify, jobs);
+
+    for (i = 0; i < verify.clip_count; i++)
+    {
+        verify_clip_t* clip = &verify.clips[i];
+        const char* failure = describe_failure(clip, reason, sizeof(reason));
+        checksum_entry_t key = { clip->path, 0 };
+        checksum_entry_t* entry;
+
+        if (checksum_path == NULL)
+        {
+            // Only good clips go to stdout, so the output can be kept as a checksum file
+            if (failure != NULL)
+                fprintf(stderr, "%s: %s\n", clip->path, failure);
+            else
+                printf("%016llx  %s\n", (unsigned long long) clip->hash, clip->path);
+        }
+        else
+        {
+            entry = (checksum_entry_t*) bsearch(&key, expected, expected_count, sizeof(checksum_entry_t),
+                                                compare_checksum_entries);
+            if (failure == NULL && entry == NULL)
+                failure = "not in the checksum file";
+
+            if (failure == NULL && entry->hash != clip->hash)
+                failure = "checksum mismatch";
+
+            if (failure != NULL)
+                printf("%s: FAILED (%s)\n", clip->path, failure);
+            else
+                printf("%s: OK\n", clip->path);
+        }
+
+        if (failure != NULL)
+            failures++;
+    }
+    fflush(stdout);
+
+    if (failures > 0)
+        fprintf(stderr, "WARNING: %zu of %zu clips FAILED\n", failures, verify.clip_count);
+
+    for (i = 0; i < expected_count; i++)
+        free(expected[i].path);
+    free(expected);
+
+    failures += verify.failed;
+    free_verify_members(&verify);
+    return failures == 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * File:   verify.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Integrity verification (--verify): reads every stream file (.m2ts)
+ * referenced by the given playlists once, checksums it and checks the sync
+ * byte of every TS packet in the same pass.
+ *
+ * Clips referenced by several playlists (or angles) are read once.  Each
+ * clip is read in VERIFY_CHUNK_SIZE pieces by sched_read_file(), so all
+ * workers read it front to back at once.  Reads are into page-aligned
+ * buffers, optionally with O_DIRECT to bypass the page cache.
+ *
+ * The checksum of a clip is the XXH64 (seed 0) of the little-endian XXH64s
+ * of its chunks, so it does not depend on the number of workers.  Checksums
+ * are printed like sha256sum ("HASH  PATH"); with a checksum file they are
+ * compared instead, like sha256sum -c.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef VERIFY_H
+#define	VERIFY_H
+
+#include "parse_mpls.h"
+#include "m2ts.h"
+#include "scheduler.h"
+
+#include <stdatomic.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+/* Whole packets and whole pages; part of the checksum definition, so changing it changes every checksum */
+#define VERIFY_CHUNK_SIZE  (M2TS_PACKET_SIZE * 4096 * 4) /* 3 MiB */
+#define VERIFY_ALIGNMENT   4096
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    char* path;                  /* stream file, next to the first playlist that references it */
+    char* playlist_path;         /* that playlist; only used until the file is found */
+    size_t bdmv_len;             /* length of the playlist's BDMV directory prefix */
+    char clip_id[6];
+    bool missing;
+    uint64_t dev;                /* identity of the file, to catch one reached by two paths */
+    uint64_t ino;
+    sched_file_t file;           /* the read of path */
+    uint64_t* chunk_hashes;
+    atomic_llong sync_error;     /* offset of the first packet out of sync, or -1 */
+    uint64_t hash;
+} verify_clip_t;
+
+typedef struct {
+    verify_clip_t* clips;
+    size_t clip_count;
+    size_t clip_capacity;
+    bool direct;                 /* try O_DIRECT */
+    bool failed;                 /* a playlist could not be read */
+} verify_t;
+
+
+/*
+ * Functions
+ */
+
+
+/**
+ * @param verify
+ * @param direct read with O_DIRECT where the file system supports it
+ */
+void
+init_verify_t(verify_t* verify, bool direct);
+
+void
+free_verify_members(verify_t* verify);
+
+/**
+ * Adds the clips (including angles) of a playlist.  Errors are reported on
+ * stderr and set verify->failed.
+ * @param verify
+ * @param path .mpls file
+ * @return false if the playlist could not be read.
+ */
+bool
+verify_add_playlist(verify_t* verify, const char* path);
+
+/**
+ * Locates the unique stream files of the added clips, then reads and
+ * checks them all.  Afterwards clips are sorted by path.
+ * @param verify
+ * @param jobs number of worker threads
+ */
+void
+verify_read_clips(verify_t* verify, int jobs);
+
+/**
+ * Verifies every clip of the given discs (or playlists), printing
+ * checksums or comparing them with a checksum file.
+ * @param paths disc roots or .mpls files
+ * @param path_count
+ * @param checksum_path NULL to print checksums
+ * @param direct
+ * @param jobs
+ * @return true if every clip was read, in sync and (with a checksum file) matched.
+ */
+bool
+verify_run(char** paths, int path_count, const char* checksum_path, bool direct, int jobs);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* VERIFY_H */
@@ -0,0 +1,619 @@
+/*
+ * File:   watch.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "watch.h"
+#include "disc.h"
+#include "mpls_view.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/*
+ * Constants
+ */
+
+
+#define WATCH_DIR_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_ONLYDIR)
+#define WATCH_EVENT_BUFFER_SIZE 65536
+
+
+/*
+ * Private functions
+ */
+
+
+static int64_t
+now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void*
+grow(void* array, size_t* capacity, size_t needed, size_t size)
+{
+    size_t new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+    if (new_capacity != *capacity)
+    {
+        array = realloc(array, new_capacity * size);
+        if (array == NULL)
+        {
+            DIE("Out of memory.");
+        }
+        *capacity = new_capacity;
+    }
+    return array;
+}
+
+static char*
+join_path(const char* dir, const char* name)
+{
+    size_t len = strlen(dir) + strlen(name) + 2;
+    char* path = (char*) calloc(len, sizeof(char));
+    snprintf(path, len, "%s/%s", dir, name);
+    return path;
+}
+
+static const char*
+entry_path(const void* entries, size_t entry_size, size_t i)
+{
+    return *(char* const*) ((const char*) entries + i * entry_size);
+}
+
+/**
+ * @return The slot holding path, or the free slot where it belongs.
+ */
+static size_t
+index_slot(const watch_index_t* index, const void* entries, size_t entry_size, const char* path)
+{
+    size_t mask = index->slot_count - 1;
+    size_t slot = hash_string(path) & mask;
+
+    while (index->slots[slot] != 0 && strcmp(entry_path(entries, entry_size, index->slots[slot] - 1), path) != 0)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+/**
+ * @return Index of the entry with this path, or -1.
+ */
+static ssize_t
+index_find(const watch_index_t* index, const void* entries, size_t entry_size, const char* path)
+{
+    if (index->slot_count == 0)
+        return -1;
+    return (ssize_t) index->slots[index_slot(index, entries, entry_size, path)] - 1;
+}
+
+/**
+ * Adds the last of count entries, which was just appended.
+ */
+static void
+index_add(watch_index_t* index, const void* entries, size_t entry_size, size_t count)
+{
+    size_t i;
+
+    if (count * 2 <= index->slot_count)
+    {
+        index->slots[index_slot(index, entries, entry_size, entry_path(entries, entry_size, count - 1))] = (uint32_t) count;
+        return;
+    }
+
+    free(index->slots);
+    index->slot_count = index->slot_count ? index->slot_count * 2 : 64;
+    index->slots = (uint32_t*) calloc(index->slot_count, sizeof(uint32_t));
+    if (index->slots == NULL)
+    {
+        DIE("Out of memory.");
+    }
+    for (i = 0; i < count; i++)
+    {
+        size_t slot = hash_string(entry_path(entries, entry_size, i)) & (index->slot_count - 1);
+        while (index->slots[slot] != 0)
+            slot = (slot + 1) & (index->slot_count - 1);
+        index->slots[slot] = (uint32_t) (i + 1);
+    }
+}
+
+/**
+ * Removes entry i, before the caller moves the last of count entries into its place.
+ */
+static void
+index_remove(watch_index_t* index, const void* entries, size_t entry_size, size_t count, size_t i)
+{
+    size_t mask = index->slot_count - 1;
+    size_t hole = index_slot(index, entries, entry_size, entry_path(entries, entry_size, i));
+    size_t slot = hole;
+
+    // Shift later entries of the probe run back into the hole, so no lookup stops early
+    index->slots[hole] = 0;
+    for (;;)
+    {
+        size_t home;
+
+        slot = (slot + 1) & mask;
+        if (index->slots[slot] == 0)
+            break;
+        home = hash_string(entry_path(entries, entry_size, index->slots[slot] - 1)) & mask;
+        if (((slot - home) & mask) >= ((slot - hole) & mask))
+        {
+            index->slots[hole] = index->slots[slot];
+            index->slots[slot] = 0;
+            hole = slot;
+        }
+    }
+
+    if (i != count - 1)
+        index->slots[index_slot(index, entries, entry_size, entry_path(entries, entry_size, count - 1))] = (uint32_t) (i + 1);
+}
+
+static void
+queue_file(watch_t* watch, const char* path, int64_t deadline_ms)
+{
+    ssize_t i = index_find(&watch->pending_index, watch->pending, sizeof(watch_pending_t), path);
+
+    // Every event restarts the file's debounce interval
+    if (i >= 0)
+    {
+        watch->pending[i].deadline_ms = deadline_ms;
+        return;
+    }
+
+    watch->pending = (watch_pending_t*) grow(watch->pending, &watch->pending_capacity,
+                                             watch->pending_count + 1, sizeof(watch_pending_t));
+    watch->pending[watch->pending_count].path = strdup(path);
+    watch->pending[watch->pending_count].deadline_ms = deadline_ms;
+    watch->pending_count++;
+    index_add(&watch->pending_index, watch->pending, sizeof(watch_pending_t), watch->pending_count);
+}
+
+static watch_playlist_t*
+find_playlist(watch_t* watch, const char* path)
+{
+    ssize_t i = index_find(&watch->playlist_index, watch->playlists, sizeof(watch_playlist_t), path);
+    return i >= 0 ? &watch->playlists[i] : NULL;
+}
+
+static void
+forget_playlist(watch_t* watch, const char* path)
+{
+    ssize_t i = index_find(&watch->playlist_index, watch->playlists, sizeof(watch_playlist_t), path);
+
+    if (i < 0)
+        return;
+
+    index_remove(&watch->playlist_index, watch->playlists, sizeof(watch_playlist_t), watch->playlist_count, i);
+    free(watch->playlists[i].path);
+    free(watch->playlists[i].clip_ids);
+    watch->playlists[i] = watch->playlists[--watch->playlist_count];
+}
+
+/**
+ * Records which clips a playlist references, read straight from the file.
+ */
+static void
+remember_playlist(watch_t* watch, const char* path, const mpls_file_t* mpls_file)
+{
+    watch_playlist_t* playlist = find_playlist(watch, path);
+    mpls_view_t view;
+    mpls_play_item_iter_t item;
+    mpls_angle_iter_t angle;
+    size_t capacity = 0;
+    bool has_item;
+    bool has_angle;
+
+    if (playlist == NULL)
+    {
+        watch->playlists = (watch_playlist_t*) grow(watch->playlists, &watch->playlist_capacity,
+                                                    watch->playlist_count + 1, sizeof(watch_playlist_t));
+        playlist = &watch->playlists[watch->playlist_count++];
+        playlist->path = strdup(path);
+        playlist->bdmv_len = disc_bdmv_length(path);
+        index_add(&watch->playlist_index, watch->playlists, sizeof(watch_playlist_t), watch->playlist_count);
+    }
+    else
+    {
+        free(playlist->clip_ids);
+    }
+    playlist->clip_ids = NULL;
+    playlist->clip_count = 0;
+
+    mpls_view_init(&view, mpls_file);
+    for (has_item = mpls_view_play_items(&view, &item); has_item; has_item = mpls_play_item_next(&item))
+    {
+        playlist->clip_ids = (char (*)[6]) grow(playlist->clip_ids, &capacity, playlist->clip_count + 1 + mpls_play_item_angle_count(&item), 6);
+        snprintf(playlist->clip_ids[playlist->clip_count++], 6, "%.5s", mpls_play_item_clip_id(&item));
+
+        for (has_angle = mpls_play_item_angles(&item, &angle); has_angle; has_angle = mpls_angle_next(&angle))
+            snprintf(playlist->clip_ids[playlist->clip_count++], 6, "%.5s", mpls_angle_clip_id(&angle));
+    }
+}
+
+static void
+publish_playlist(watch_t* watch, const char* path)
+{
+    mpls_file_t mpls_file = create_mpls_file_t();
+    playlist_t playlist = create_playlist_t();
+    char error[256];
+
+    // Deleted or renamed away since the event: nothing to print
+    if (access(path, F_OK) != 0)
+    {
+        forget_playlist(watch, path);
+        free_mpls_file_members(&mpls_file);
+        return;
+    }
+
+    // Unlike one-shot runs, a bad playlist must not stop the watch
+    if (!load_mpls(&mpls_file, (char*) path, error, sizeof(error)) ||
+        !check_mpls(&mpls_file, error, sizeof(error)))
+    {
+        fprintf(stderr, "%s\n", error);
+        forget_playlist(watch, path);
+        free_mpls_file_members(&mpls_file);
+        return;
+    }
+
+    remember_playlist(watch, path, &mpls_file);
+
+    parse_playlist(&mpls_file, &playlist, watch->fields);
+    disc_find_clip_sizes(mpls_file.path, &playlist);
+    output_playlist(&mpls_file, &playlist);
+    fflush(stdout);
+
+    free_playlist_members(&playlist);
+    free_mpls_file_members(&mpls_file);
+}
+
+/**
+ * Re-prints the playlists of the same disc that reference a changed clip info file.
+ */
+static void
+publish_clip(watch_t* watch, const char* path)
+{
+    const char* file = strrchr(path, '/') + 1;
+    size_t bdmv_len = disc_bdmv_length(path);
+    size_t i;
+    int c;
+
+    // Collect first: publishing may forget (and so move) playlists
+    char** matches = (char**) calloc(watch->playlist_count + 1, sizeof(char*));
+    size_t match_count = 0;
+
+    for (i = 0; i < watch->playlist_count; i++)
+    {
+        watch_playlist_t* playlist = &watch->playlists[i];
+        if (playlist->bdmv_len != bdmv_len || strncmp(playlist->path, path, bdmv_len) != 0)
+            continue;
+        for (c = 0; c < playlist->clip_count; c++)
+        {
+            if (strncmp(playlist->clip_ids[c], file, 5) == 0)
+            {
+                matches[match_count++] = strdup(playlist->path);
+                break;
+            }
+        }
+    }
+
+    for (i = 0; i < match_count; i++)
+    {
+        publish_playlist(watch, matches[i]);
+        free(matches[i]);
+    }
+    free(matches);
+}
+
+/**
+ * Watches a directory and everything below it, and queues the playlists
+ * already in it (an event for a file written before the watch existed is
+ * never delivered).
+ */
+static void
+watch_tree(watch_t* watch, const char* path, int64_t deadline_ms)
+{
+    DIR* dir;
+    struct dirent* entry;
+    int wd = inotify_add_watch(watch->fd, path, WATCH_DIR_EVENTS);
+
+    if (wd < 0)
+    {
+        fprintf(stderr, "Unable to watch \"%s\": %s.\n", path, strerror(errno));
+        return;
+    }
+
+    if (wd >= watch->dir_capacity)
+    {
+        int capacity = watch->dir_capacity ? watch->dir_capacity : 64;
+        while (capacity <= wd)
+            capacity *= 2;
+        watch->dirs = (char**) realloc(watch->dirs, capacity * sizeof(char*));
+        memset(watch->dirs + watch->dir_capacity, 0, (capacity - watch->dir_capacity) * sizeof(char*));
+        watch->dir_capacity = capacity;
+    }
+    free(watch->dirs[wd]);
+    watch->dirs[wd] = strdup(path);
+
+    dir = opendir(path);
+    if (dir == NULL)
+        return;
+
+    while ((entry = readdir(dir)) != NULL)
+    {
+        char* child;
+        bool is_dir;
+        bool is_file;
+
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        child = join_path(path, entry->d_name);
+        is_dir = entry->d_type == DT_DIR;
+        is_file = entry->d_type == DT_REG;
+        if (entry->d_type == DT_UNKNOWN)
+        {
+            struct stat st;
+            if (lstat(child, &st) == 0)
+            {
+                is_dir = S_ISDIR(st.st_mode);
+                is_file = S_ISREG(st.st_mode);
+            }
+        }
+
+        // Symlinks are not followed, so a link cannot make the tree cyclic
+        if (is_dir)
+            watch_tree(watch, child, deadline_ms);
+        else if (is_file && disc_is_disc_file(child, "PLAYLIST", ".mpls"))
+            queue_file(watch, child, deadline_ms);
+        free(child);
+    }
+
+    closedir(dir);
+}
+
+static void
+handle_event(watch_t* watch, const struct inotify_event* event)
+{
+    const char* dir;
+    char* path;
+
+    if (event->mask & IN_Q_OVERFLOW)
+    {
+        // Events were lost: the only case that needs a scan
+        int i;
+        fprintf(stderr, "inotify event queue overflowed; rescanning.\n");
+        for (i = 0; i < watch->root_count; i++)
+            watch_tree(watch, watch->roots[i], now_ms() + watch->debounce_ms);
+        return;
+    }
+
+    if (event->wd < 0 || event->wd >= watch->dir_capacity || watch->dirs[event->wd] == NULL)
+        return;
+
+    if (event->mask & IN_IGNORED)
+    {
+        // The directory was deleted or unmounted
+        free(watch->dirs[event->wd]); watch->dirs[event->wd] = NULL;
+        return;
+    }
+
+    if (event->len == 0)
+        return;
+
+    dir = watch->dirs[event->wd];
+    path = join_path(dir, event->name);
+
+    if (event->mask & IN_ISDIR)
+    {
+        if (event->mask & (IN_CREATE | IN_MOVED_TO))
+            watch_tree(watch, path, now_ms() + watch->debounce_ms);
+    }
+    else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+    {
+        forget_playlist(watch, path);
+    }
+    else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+    {
+        if (disc_is_disc_file(path, "PLAYLIST", ".mpls") || disc_is_disc_file(path, "CLIPINF", ".clpi"))
+            queue_file(watch, path, now_ms() + watch->debounce_ms);
+    }
+
+    free(path);
+}
+
+static int
+compare_pending(const void* a, const void* b)
+{
+    return strcmp(((const watch_pending_t*) a)->path, ((const watch_pending_t*) b)->path);
+}
+
+/**
+ * Parses every file whose debounce interval has passed, in path order.
+ */
+static void
+flush_pending(watch_t* watch)
+{
+    int64_t now = now_ms();
+    watch_pending_t* due;
+    size_t due_count = 0;
+    size_t i = 0;
+
+    due = (watch_pending_t*) calloc(watch->pending_count + 1, sizeof(watch_pending_t));
+    while (i < watch->pending_count)
+    {
+        if (watch->pending[i].deadline_ms <= now)
+        {
+            index_remove(&watch->pending_index, watch->pending, sizeof(watch_pending_t), watch->pending_count, i);
+            due[due_count++] = watch->pending[i];
+            watch->pending[i] = watch->pending[--watch->pending_count];
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    qsort(due, due_count, sizeof(watch_pending_t), compare_pending);
+
+    for (i = 0; i < due_count; i++)
+    {
+        if (disc_is_disc_file(due[i].path, "CLIPINF", ".clpi"))
+            publish_clip(watch, due[i].path);
+        else
+            publish_playlist(watch, due[i].path);
+        free(due[i].path);
+    }
+    free(due);
+}
+
+/**
+ * @return Milliseconds until the next debounce deadline, or -1 if nothing is pending.
+ */
+static int
+next_timeout(watch_t* watch)
+{
+    int64_t now = now_ms();
+    int64_t timeout = -1;
+    size_t i;
+
+    for (i = 0; i < watch->pending_count; i++)
+    {
+        int64_t wait = watch->pending[i].deadline_ms - now;
+        if (wait < 0)
+            wait = 0;
+        if (timeout < 0 || wait < timeout)
+            timeout = wait;
+    }
+    return (int) timeout;
+}
+
+
+/*
+ * Functions
+ */
+
+
+bool
+init_watch_t(watch_t* watch, char** roots, int root_count, int fields, int debounce_ms)
+{
+    memset(watch, 0, sizeof(*watch));
+    watch->roots = roots;
+    watch->root_count = root_count;
+    watch->fields = fields;
+    watch->debounce_ms = debounce_ms;
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    return watch->fd >= 0;
+}
+
+void
+free_watch_members(watch_t* watch)
+{
+    size_t i;
+    int wd;
+
+    if (watch->fd >= 0)
+    {
+        close(watch->fd); watch->fd = -1;
+    }
+    for (wd = 0; wd < watch->dir_capacity; wd++)
+        free(watch->dirs[wd]);
+    free(watch->dirs); watch->dirs = NULL;
+    watch->dir_capacity = 0;
+    for (i = 0; i < watch->pending_count; i++)
+        free(watch->pending[i].path);
+    free(watch->pending); watch->pending = NULL;
+    watch->pending_count = watch->pending_capacity = 0;
+    free(watch->pending_index.slots); watch->pending_index.slots = NULL;
+    watch->pending_index.slot_count = 0;
+    for (i = 0; i < watch->playlist_count; i++)
+    {
+        free(watch->playlists[i].path);
+        free(watch->playlists[i].clip_ids);
+    }
+    free(watch->playlists); watch->playlists = NULL;
+    watch->playlist_count = watch->playlist_capacity = 0;
+    free(watch->playlist_index.slots); watch->playlist_index.slots = NULL;
+    watch->playlist_index.slot_count = 0;
+}
+
+void
+watch_loop(watch_t* watch)
+{
+    static char buffer[WATCH_EVENT_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int i;
+
+    // Existing playlists are printed right away, without waiting out the debounce
+    for (i = 0; i < watch->root_count; i++)
+        watch_tree(watch, watch->roots[i], 0);
+
+    for (;;)
+    {
+        struct pollfd pfd = { watch->fd, POLLIN, 0 };
+        ssize_t len;
+        ssize_t pos;
+
+        flush_pending(watch);
+
+        if (poll(&pfd, 1, next_timeout(watch)) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "poll() failed: %s.\n", strerror(errno));
+            return;
+        }
+
+        while ((len = read(watch->fd, buffer, sizeof(buffer))) > 0)
+        {
+            for (pos = 0; pos < len; )
+            {
+                const struct inotify_event* event = (const struct inotify_event*) (buffer + pos);
+                handle_event(watch, event);
+                pos += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if (len < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            fprintf(stderr, "Error reading inotify events: %s.\n", strerror(errno));
+            return;
+        }
+    }
+}
+
+void
+watch_run(char** roots, int root_count, int fields, int debounce_ms)
+{
+    watch_t watch;
+    int i;
+
+    for (i = 0; i < root_count; i++)
+    {
+        struct stat st;
+        if (stat(roots[i], &st) != 0 || !S_ISDIR(st.st_mode))
+        {
+            DIE("--watch needs directories; \"%s\" is not one.", roots[i]);
+        }
+    }
+
+    if (!init_watch_t(&watch, roots, root_count, fields, debounce_ms))
+    {
+        DIE("Unable to initialize inotify: %s.", strerror(errno));
+    }
+
+    watch_loop(&watch);
+
+    free_watch_members(&watch);
+    exit(EXIT_FAILURE);
+}
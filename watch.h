@@ -0,0 +1,125 @@
+/*
+ * File:   watch.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Watch mode (--watch): follows directory trees that discs are being ripped
+ * into and prints a playlist again whenever it changes, without rescanning.
+ *
+ * Every directory under the given roots is watched with inotify, and new
+ * directories are watched as they appear.  A .mpls file in a PLAYLIST
+ * directory is re-parsed when it is closed after writing or moved into
+ * place; a .clpi file in a CLIPINF directory re-parses the playlists of the
+ * same disc that reference its clip.  Events for a file are debounced: it
+ * is parsed once no event has arrived for it in the debounce interval, so
+ * a file written in several passes is printed once.
+ *
+ * Existing playlists are printed once at startup.  Only if the kernel's
+ * event queue overflows are the roots scanned again.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef WATCH_H
+#define	WATCH_H
+
+#include "parse_mpls.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Constants
+ */
+
+
+#define WATCH_DEFAULT_DEBOUNCE_MS 50
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    char* path;
+    int64_t deadline_ms;         /* parse once the monotonic clock reaches this */
+} watch_pending_t;
+
+typedef struct {
+    char* path;                  /* .mpls path, as found under a root */
+    size_t bdmv_len;             /* length of its BDMV directory prefix in path */
+    char (*clip_ids)[6];         /* clip IDs (e.g., "00800") of its PlayItems and angles */
+    int clip_count;
+} watch_playlist_t;
+
+/* Open-addressing hash of an entry array by path (the first member of every entry) */
+typedef struct {
+    uint32_t* slots;             /* entry index + 1; 0 marks a free slot */
+    size_t slot_count;           /* a power of 2, at least twice the entry count */
+} watch_index_t;
+
+typedef struct {
+    int fd;                      /* inotify instance */
+    char** dirs;                 /* watched directory paths, indexed by watch descriptor */
+    int dir_capacity;
+    watch_pending_t* pending;
+    size_t pending_count;
+    size_t pending_capacity;
+    watch_index_t pending_index;
+    watch_playlist_t* playlists; /* every playlist printed so far, for .clpi lookups */
+    size_t playlist_count;
+    size_t playlist_capacity;
+    watch_index_t playlist_index;
+    char** roots;
+    int root_count;
+    int fields;
+    int debounce_ms;
+} watch_t;
+
+
+/*
+ * Functions
+ */
+
+
+/**
+ * @param watch
+ * @param roots directories to watch; must outlive the watch
+ * @param root_count
+ * @param fields FIELD_* flags
+ * @param debounce_ms
+ * @return false (with errno set) if inotify is unavailable.
+ */
+bool
+init_watch_t(watch_t* watch, char** roots, int root_count, int fields, int debounce_ms);
+
+void
+free_watch_members(watch_t* watch);
+
+/**
+ * Watches the roots and prints the playlists below them, then waits for
+ * and handles events.  Only returns on an error.
+ * @param watch
+ */
+void
+watch_loop(watch_t* watch);
+
+/**
+ * Watches the given directories until the process is killed.
+ * @param roots
+ * @param root_count
+ * @param fields FIELD_* flags
+ * @param debounce_ms
+ */
+void
+watch_run(char** roots, int root_count, int fields, int debounce_ms);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* WATCH_H */
@@ -0,0 +1,221 @@
+/*
+ * File:   xxh64.c
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * Created on October 18, 2026
+ */
+
+
+#include "xxh64.h"
+
+
+/*
+ * Constants
+ */
+
+
+#define PRIME1 0x9E3779B185EBCA87ULL
+#define PRIME2 0xC2B2AE3D27D4EB4FULL
+#define PRIME3 0x165667B19E3779F9ULL
+#define PRIME4 0x85EBCA77C2B2AE63ULL
+#define PRIME5 0x27D4EB2F165667C5ULL
+
+
+/*
+ * Private functions
+ */
+
+
+static inline uint64_t
+rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+// Input is little-endian regardless of the host
+static inline uint64_t
+read64(const uint8_t* p)
+{
+    return (uint64_t) p[0]         | (uint64_t) p[1] << 8  | (uint64_t) p[2] << 16 | (uint64_t) p[3] << 24 |
+           (uint64_t) p[4] << 32   | (uint64_t) p[5] << 40 | (uint64_t) p[6] << 48 | (uint64_t) p[7] << 56;
+}
+
+static inline uint32_t
+read32(const uint8_t* p)
+{
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static inline uint64_t
+round64(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME1;
+}
+
+static inline uint64_t
+merge_round(uint64_t hash, uint64_t acc)
+{
+    hash ^= round64(0, acc);
+    return hash * PRIME1 + PRIME4;
+}
+
+/**
+ * Consumes as many whole 32-byte stripes as fit in len.
+ * @return Number of bytes consumed.
+ */
+static size_t
+consume_stripes(uint64_t acc[4], const uint8_t* p, size_t len)
+{
+    const uint8_t* start = p;
+    const uint8_t* limit = p + (len & ~(size_t) 31);
+
+    while (p < limit)
+    {
+        acc[0] = round64(acc[0], read64(p));
+        acc[1] = round64(acc[1], read64(p + 8));
+        acc[2] = round64(acc[2], read64(p + 16));
+        acc[3] = round64(acc[3], read64(p + 24));
+        p += 32;
+    }
+
+    return p - start;
+}
+
+/**
+ * Mixes in the final (fewer than 32) bytes and avalanches.
+ */
+static uint64_t
+finalize(uint64_t hash, const uint8_t* p, size_t len)
+{
+    while (len >= 8)
+    {
+        hash ^= round64(0, read64(p));
+        hash = rotl64(hash, 27) * PRIME1 + PRIME4;
+        p += 8;
+        len -= 8;
+    }
+    if (len >= 4)
+    {
+        hash ^= (uint64_t) read32(p) * PRIME1;
+        hash = rotl64(hash, 23) * PRIME2 + PRIME3;
+        p += 4;
+        len -= 4;
+    }
+    while (len > 0)
+    {
+        hash ^= *p * PRIME5;
+        hash = rotl64(hash, 11) * PRIME1;
+        p++;
+        len--;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+static uint64_t
+converge(const uint64_t acc[4])
+{
+    uint64_t hash = rotl64(acc[0], 1) + rotl64(acc[1], 7) + rotl64(acc[2], 12) + rotl64(acc[3], 18);
+    int i;
+
+    for (i = 0; i < 4; i++)
+        hash = merge_round(hash, acc[i]);
+    return hash;
+}
+
+static void
+init_accumulators(uint64_t acc[4], uint64_t seed)
+{
+    acc[0] = seed + PRIME1 + PRIME2;
+    acc[1] = seed + PRIME2;
+    acc[2] = seed;
+    acc[3] = seed - PRIME1;
+}
+
+
+/*
+ * Functions
+ */
+
+
+uint64_t
+xxh64(const void* data, size_t len, uint64_t seed)
+{
+    const uint8_t* p = (const uint8_t*) data;
+    uint64_t hash;
+
+    if (len >= 32)
+    {
+        uint64_t acc[4];
+        size_t consumed;
+
+        init_accumulators(acc, seed);
+        consumed = consume_stripes(acc, p, len);
+        hash = converge(acc);
+        p += consumed;
+    }
+    else
+        hash = seed + PRIME5;
+
+    hash += len;
+    return finalize(hash, p, len & 31);
+}
+
+void
+init_xxh64_state_t(xxh64_state_t* state, uint64_t seed)
+{
+    memset(state, 0, sizeof(*state));
+    state->seed = seed;
+    init_accumulators(state->acc, seed);
+}
+
+void
+xxh64_update(xxh64_state_t* state, const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*) data;
+
+    state->total_len += len;
+
+    // Top up a partial stripe first
+    if (state->buffered > 0)
+    {
+        size_t fill = 32 - state->buffered;
+        if (fill > len)
+            fill = len;
+        memcpy(state->buffer + state->buffered, p, fill);
+        state->buffered += fill;
+        p += fill;
+        len -= fill;
+        if (state->buffered < 32)
+            return;
+        consume_stripes(state->acc, state->buffer, 32);
+        state->buffered = 0;
+    }
+
+    p += consume_stripes(state->acc, p, len);
+    len &= 31;
+
+    memcpy(state->buffer, p, len);
+    state->buffered = len;
+}
+
+uint64_t
+xxh64_digest(const xxh64_state_t* state)
+{
+    uint64_t hash;
+
+    if (state->total_len >= 32)
+        hash = converge(state->acc);
+    else
+        hash = state->seed + PRIME5;
+
+    hash += state->total_len;
+    return finalize(hash, state->buffer, state->buffered);
+}
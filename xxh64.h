@@ -0,0 +1,70 @@
+/*
+ * File:   xxh64.h
+ * Author: Andrew C. Dvorak <andy@andydvorak.net>
+ *
+ * XXH64 (xxHash, 64-bit variant): a fast non-cryptographic hash, used to
+ * checksum stream files at disk bandwidth.  Output matches the reference
+ * implementation (e.g., xxhsum -H1) for the same input and seed.
+ *
+ * Created on October 18, 2026
+ */
+
+#ifndef XXH64_H
+#define	XXH64_H
+
+#include "parse_mpls.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Structs
+ */
+
+
+typedef struct {
+    uint64_t total_len;
+    uint64_t acc[4];
+    uint8_t buffer[32];          /* input not yet consumed as a whole stripe */
+    size_t buffered;
+    uint64_t seed;
+} xxh64_state_t;
+
+
+/*
+ * Functions
+ */
+
+
+/**
+ * @param data
+ * @param len
+ * @param seed
+ * @return XXH64 of the buffer.
+ */
+uint64_t
+xxh64(const void* data, size_t len, uint64_t seed);
+
+void
+init_xxh64_state_t(xxh64_state_t* state, uint64_t seed);
+
+void
+xxh64_update(xxh64_state_t* state, const void* data, size_t len);
+
+/**
+ * @param state
+ * @return XXH64 of everything passed to xxh64_update() so far; the state
+ *         may still be updated afterwards.
+ */
+uint64_t
+xxh64_digest(const xxh64_state_t* state);
+
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* XXH64_H */